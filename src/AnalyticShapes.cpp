@@ -0,0 +1,156 @@
+#include "imgui_internal.h"
+#include <cmath>
+#include <cstring>
+#include "AnalyticShapes.h"
+#include "AndroidImgui.h"
+#include "my_imgui.h"
+
+// Extra pixels around every shape for the anti-aliased edge
+static constexpr float kAAMargin = 1.0f;
+
+AnalyticShapes::~AnalyticShapes() {
+    Detach();
+}
+
+void AnalyticShapes::Attach() {
+    Detach();
+    ImGuiContextHook hook;
+    hook.Type = ImGuiContextHookType_NewFramePre;
+    hook.Callback = NewFrameHook;
+    hook.UserData = this;
+    m_Context = ImGui::GetCurrentContext();
+    m_HookId = ImGui::AddContextHook(m_Context, &hook);
+}
+
+void AnalyticShapes::Detach() {
+    if (!m_Context)
+        return;
+    ImGui::RemoveContextHook(m_Context, m_HookId);
+    m_Context = nullptr;
+    m_HookId = 0;
+}
+
+AnalyticShapes *AnalyticShapes::Get() {
+    ImGuiContext *ctx = ImGui::GetCurrentContext();
+    if (!ctx)
+        return nullptr;
+    for (const ImGuiContextHook &hook: ctx->Hooks) {
+        if (hook.Callback == NewFrameHook && hook.Type == ImGuiContextHookType_NewFramePre)
+            return (AnalyticShapes *) hook.UserData;
+    }
+    return nullptr;
+}
+
+void AnalyticShapes::NewFrameHook(ImGuiContext *ctx, ImGuiContextHook *hook) {
+    auto *shapes = (AnalyticShapes *) hook->UserData;
+    shapes->m_Frame.Vertices.clear();
+    shapes->m_Frame.Generation++;
+    shapes->m_Batches.clear();
+    shapes->m_Thread = std::this_thread::get_id();
+}
+
+void AnalyticShapes::AddShape(ImDrawList *drawList, const ShapeVertex quad[4]) {
+    IM_ASSERT(std::this_thread::get_id() == m_Thread && "Analytic shapes are recorded on the UI thread only");
+    int shape = (int) (m_Frame.Vertices.size() / 4);
+    m_Frame.Vertices.insert(m_Frame.Vertices.end(), quad, quad + 4);
+
+    // Grow the previous batch when nothing else was drawn into this list since, under the same clip rect
+    const ImVector<ImDrawCmd> &cmds = drawList->CmdBuffer;
+    if (cmds.Size >= 3) {
+        const ImDrawCmd &shapes = cmds[cmds.Size - 3];
+        const ImDrawCmd &reset = cmds[cmds.Size - 2];
+        const ImDrawCmd &tail = cmds[cmds.Size - 1];
+        if (shapes.UserCallback == DrawCallback && reset.UserCallback == ImDrawCallback_ResetRenderState &&
+            tail.UserCallback == nullptr && tail.ElemCount == 0 &&
+            memcmp(&tail.ClipRect, &shapes.ClipRect, sizeof(ImVec4)) == 0) {
+            Batch &batch = m_Batches[(intptr_t) shapes.UserCallbackData];
+            if (batch.First + batch.Count == shape) {
+                batch.Count++;
+                return;
+            }
+        }
+    }
+
+    m_Batches.push_back({shape, 1});
+    drawList->AddCallback(DrawCallback, (void *) (intptr_t) (m_Batches.size() - 1));
+    drawList->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+// Draw data is rendered under the context that built it
+void AnalyticShapes::DrawCallback(const ImDrawList *parentList, const ImDrawCmd *cmd) {
+    AnalyticShapes *shapes = Get();
+    if (!shapes)
+        return;
+    const Batch &batch = shapes->m_Batches[(intptr_t) cmd->UserCallbackData];
+    shapes->m_Owner.RenderShapes(shapes->m_Frame, batch.First, batch.Count, cmd->ClipRect);
+}
+
+static AnalyticShapes *GetSupported() {
+    AnalyticShapes *shapes = AnalyticShapes::Get();
+    return shapes && shapes->IsSupported() ? shapes : nullptr;
+}
+
+// Box centered at (cx, cy) whose local x axis points along (ax, ay)
+static void AddBox(AnalyticShapes *shapes, ImDrawList *drawList, float cx, float cy, float ax, float ay,
+                   float halfWidth, float halfHeight, float radius, float stroke, ImU32 col) {
+    if ((col & IM_COL32_A_MASK) == 0)
+        return;
+    const float ex = halfWidth + stroke * 0.5f + kAAMargin;
+    const float ey = halfHeight + stroke * 0.5f + kAAMargin;
+    const float sx[4] = {-1.0f, 1.0f, 1.0f, -1.0f};
+    const float sy[4] = {-1.0f, -1.0f, 1.0f, 1.0f};
+    ShapeVertex quad[4];
+    for (int i = 0; i < 4; i++) {
+        float lx = sx[i] * ex;
+        float ly = sy[i] * ey;
+        quad[i] = {cx + lx * ax - ly * ay, cy + lx * ay + ly * ax, lx, ly,
+                   halfWidth, halfHeight, radius, stroke, col};
+    }
+    shapes->AddShape(drawList, quad);
+}
+
+namespace ImGui {
+    void Android_AddRectSDF(ImDrawList *drawList, const ImVec2 &pMin, const ImVec2 &pMax, ImU32 col,
+                            float rounding, float thickness) {
+        float halfWidth = (pMax.x - pMin.x) * 0.5f;
+        float halfHeight = (pMax.y - pMin.y) * 0.5f;
+        float radius = std::fmin(rounding, std::fmin(halfWidth, halfHeight));
+        AnalyticShapes *shapes = GetSupported();
+        if (!shapes) {
+            if (thickness > 0.0f)
+                drawList->AddRect(pMin, pMax, col, rounding, 0, thickness);
+            else
+                drawList->AddRectFilled(pMin, pMax, col, rounding);
+            return;
+        }
+        AddBox(shapes, drawList, pMin.x + halfWidth, pMin.y + halfHeight, 1.0f, 0.0f, halfWidth, halfHeight,
+               std::fmax(radius, 0.0f), thickness, col);
+    }
+
+    void Android_AddCircleSDF(ImDrawList *drawList, const ImVec2 &center, float radius, ImU32 col, float thickness) {
+        AnalyticShapes *shapes = GetSupported();
+        if (!shapes) {
+            if (thickness > 0.0f)
+                drawList->AddCircle(center, radius, col, 0, thickness);
+            else
+                drawList->AddCircleFilled(center, radius, col);
+            return;
+        }
+        AddBox(shapes, drawList, center.x, center.y, 1.0f, 0.0f, radius, radius, radius, thickness, col);
+    }
+
+    void Android_AddLineSDF(ImDrawList *drawList, const ImVec2 &p1, const ImVec2 &p2, ImU32 col, float thickness) {
+        float dx = p2.x - p1.x;
+        float dy = p2.y - p1.y;
+        float length = std::sqrt(dx * dx + dy * dy);
+        if (length <= 0.0f)
+            return;
+        AnalyticShapes *shapes = GetSupported();
+        if (!shapes) {
+            drawList->AddLine(p1, p2, col, thickness);
+            return;
+        }
+        AddBox(shapes, drawList, (p1.x + p2.x) * 0.5f, (p1.y + p2.y) * 0.5f, dx / length, dy / length,
+               length * 0.5f, thickness * 0.5f, 0.0f, 0.0f, col);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef ANDROIDIMGUI_ANALYTICSHAPES_H
+#define ANDROIDIMGUI_ANALYTICSHAPES_H
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "imgui.h"
+
+class AndroidImgui;
+struct ImGuiContextHook;
+
+// One corner of a shape quad. Local is the position in the shape's own centered, axis-aligned frame; the
+// fragment stage turns it into a rounded-box signed distance (circles and lines are rounded boxes too).
+struct ShapeVertex {
+    float X, Y;
+    float LocalX, LocalY;
+    float HalfWidth, HalfHeight;
+    float Radius;
+    float Stroke; // 0 = filled
+    ImU32 Col;
+};
+
+// Shapes recorded since the last NewFrame, 4 vertices per shape, indexed as (0,1,2)(0,2,3)
+struct ShapeFrame {
+    std::vector<ShapeVertex> Vertices;
+    uint32_t Generation = 0;
+};
+
+// Records analytic shapes into draw lists as callback commands; backends draw each batch with one quad per shape.
+// One per AndroidImgui, found through a hook on its ImGui context. UI thread only, ParallelDrawLists builders
+// draw plain ImDrawList shapes
+class AnalyticShapes {
+public:
+    explicit AnalyticShapes(AndroidImgui &owner) : m_Owner(owner) {}
+
+    ~AnalyticShapes();
+
+    // Hooks into the current context, whose ImGui::NewFrame starts a new shape frame from then on
+    void Attach();
+
+    void Detach();
+
+    // Of the current context, nullptr when none is attached
+    static AnalyticShapes *Get();
+
+    // Cleared by a backend that failed to build its shape pipeline, the helpers then draw plain ImDrawList shapes
+    void SetSupported(bool supported) { m_Supported = supported; }
+
+    bool IsSupported() const { return m_Supported; }
+
+    void AddShape(ImDrawList *drawList, const ShapeVertex quad[4]);
+
+private:
+    struct Batch {
+        int First;
+        int Count;
+    };
+
+    static void NewFrameHook(ImGuiContext *ctx, ImGuiContextHook *hook);
+
+    static void DrawCallback(const ImDrawList *parentList, const ImDrawCmd *cmd);
+
+    AndroidImgui &m_Owner;
+    ImGuiContext *m_Context = nullptr;
+    ImGuiID m_HookId = 0;
+    std::thread::id m_Thread;
+    bool m_Supported = true;
+    ShapeFrame m_Frame;
+    std::vector<Batch> m_Batches;
+};
+
+#endif //ANDROIDIMGUI_ANALYTICSHAPES_H
@@ -1,59 +1,392 @@
+#ifdef __ANDROID__
 #include <android/native_window.h>
+#include "my_imgui_impl_android.h"
+#endif
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <malloc.h>
 #include "AndroidImgui.h"
 #include "imgui.h"
-#include "my_imgui_impl_android.h"
+#include "my_imgui_impl_host.h"
 #include "stb_image.h"
+#include "WindowRenderCache.h"
+#include "AnalyticShapes.h"
+#include "DrawDataCapture.h"
+#include "DrawCommandQueue.h"
+#include "FrameTask.h"
+#include "ParallelDrawLists.h"
+#include "StartupPipeline.h"
+#include "TextLayoutCache.h"
+#include "TextureAtlas.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+void *BaseTexData::operator new(size_t size) {
+    void *ptr = MemoryAllocator::Get().Allocate(size, MemoryAllocator::TEXTURE);
+    if (!ptr)
+        abort();
+    return ptr;
+}
+
+void BaseTexData::operator delete(void *ptr) {
+    MemoryAllocator::Release(ptr);
+}
+
+static void *AllocatorAlloc(size_t size, void *user_data) {
+    return ((MemoryAllocator *) user_data)->Allocate(size, MemoryAllocator::IMGUI);
+}
+
+static void AllocatorFree(void *ptr, void *user_data) {
+    MemoryAllocator::Release(ptr);
+}
+
+// Without an installed allocator ImGui keeps malloc, only counted. Blocks allocated before Init stay valid
+static void *CountingAlloc(size_t size, void *user_data) {
+    void *ptr = malloc(size);
+    if (ptr)
+        MemoryAllocator::CountHeapAllocation(malloc_usable_size(ptr), true);
+    return ptr;
+}
+
+static void CountingFree(void *ptr, void *user_data) {
+    if (!ptr)
+        return;
+    MemoryAllocator::CountHeapAllocation(malloc_usable_size(ptr), false);
+    free(ptr);
+}
+
+AndroidImgui::AndroidImgui() : m_DrawQueue(std::make_unique<DrawCommandQueue>()),
+                               m_TextCache(std::make_unique<TextLayoutCache>()),
+                               m_Tasks(std::make_unique<TaskScheduler>()),
+                               m_TextureLoader(std::make_unique<TextureLoader>(*this)),
+                               m_TextureAtlas(std::make_unique<TextureAtlas>(*this)),
+                               m_Shapes(std::make_unique<AnalyticShapes>(*this)) {
+}
+
+AndroidImgui::~AndroidImgui() {
+    FlushCaptures();
+}
+
+static void SetImGuiAllocator() {
+    if (MemoryAllocator *allocator = MemoryAllocator::GetInstalled())
+        ImGui::SetAllocatorFunctions(AllocatorAlloc, AllocatorFree, allocator);
+    else
+        ImGui::SetAllocatorFunctions(CountingAlloc, CountingFree);
+}
+
+static constexpr float kFontGlobalScale = 1.3f;
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void AndroidImgui::StartInit(StartupOptions options) {
+    m_StartupBegin = std::chrono::steady_clock::now();
+    m_StartupTimings = StartupTimings();
+    // The atlas is allocated on a worker before the context exists
+    SetImGuiAllocator();
+    m_Startup = std::make_unique<StartupPipeline>(this, std::move(options), kFontGlobalScale);
+}
 
 bool AndroidImgui::Init(ANativeWindow *window, float width, float height) {
     m_Window = window;
     m_Width = width;
     m_Height = height;
 
-    ANativeWindow_acquire(window);
-    Create();
+    auto phaseStart = std::chrono::steady_clock::now();
+    if (m_Startup) {
+        m_StartupTimings.CallerMs = MillisecondsSince(m_StartupBegin);
+        // Create makes its own attempt when the worker's failed
+        m_Startup->WaitDevice();
+        m_StartupTimings.InitWaitMs = MillisecondsSince(phaseStart);
+        phaseStart = std::chrono::steady_clock::now();
+    } else {
+        m_StartupBegin = phaseStart;
+        m_StartupTimings = StartupTimings();
+    }
+    m_StartupPending = true;
+
+#ifdef __ANDROID__
+    if (window)
+        ANativeWindow_acquire(window);
+#endif
+    if (!Create()) {
+#ifdef __ANDROID__
+        if (window)
+            ANativeWindow_release(window);
+#endif
+        return false;
+    }
+    m_StartupTimings.SurfaceMs = MillisecondsSince(phaseStart);
+
+    ImFont *startupFont = nullptr;
+    ImFontAtlas *startupAtlas = nullptr;
+    if (m_Startup) {
+        phaseStart = std::chrono::steady_clock::now();
+        startupAtlas = m_Startup->WaitFontAtlas(&startupFont);
+        m_StartupTimings.InitWaitMs += MillisecondsSince(phaseStart);
+    }
+    phaseStart = std::chrono::steady_clock::now();
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
+    SetImGuiAllocator();
+    // A prebuilt atlas stays owned by m_Startup
+    ImGui::CreateContext(startupAtlas);
     ImGuiIO &io = ImGui::GetIO();
+    if (startupFont)
+        io.FontDefault = startupFont;
 
     io.IniFilename = nullptr;
     io.LogFilename = nullptr;
     io.DisplaySize = {width, height};
-    io.FontGlobalScale = 1.3f;
+    io.FontGlobalScale = kFontGlobalScale;
     // Setup Dear ImGui style
     //ImGui::StyleColorsDark();
     ImGui::StyleColorsLight();
     ImGuiStyle &style = ImGui::GetStyle();
     style.ScaleAllSizes(3);
     style.WindowRounding = 3.f;
-    My_ImGui_ImplAndroid_Init(window);
+    // Without a window (headless) input and time come from the host platform layer
+#ifdef __ANDROID__
+    if (window)
+        My_ImGui_ImplAndroid_Init(window);
+    else
+#endif
+        My_ImGui_ImplHost_Init(width, height);
+    m_StartupTimings.ContextMs = MillisecondsSince(phaseStart);
 
+    phaseStart = std::chrono::steady_clock::now();
     Setup();
+    m_StartupTimings.SetupMs = MillisecondsSince(phaseStart);
+    m_Shapes->Attach();
     return true;
 }
 
+void AndroidImgui::JoinStartup() {
+    m_StartupPending = false;
+    auto joinStart = std::chrono::steady_clock::now();
+    if (m_Startup) {
+        m_StartupTextures = m_Startup->UploadTextures();
+        m_Startup->GetTimings(m_StartupTimings);
+    }
+    m_StartupTimings.FrameWaitMs = MillisecondsSince(joinStart);
+    m_StartupTimings.TotalMs = MillisecondsSince(m_StartupBegin);
+}
+
 void AndroidImgui::NewFrame(bool resize) {
+    if (m_StartupPending)
+        JoinStartup();
+    m_TextureLoader->Upload();
+    m_TextureAtlas->Compact();
+    if (m_RenderPolicyPending.exchange(false)) {
+        std::lock_guard<std::mutex> lock(m_PolicyLock);
+        ThreadTuning::Apply(0, m_RenderPolicy);
+    }
+    auto frameStart = std::chrono::steady_clock::now();
+    if (m_HasFrameStart) {
+        // Welford's running mean and variance
+        double interval = std::chrono::duration<double, std::milli>(frameStart - m_LastFrameStart).count();
+        m_FrameCount++;
+        double delta = interval - m_FrameMean;
+        m_FrameMean += delta / m_FrameCount;
+        m_FrameM2 += delta * (interval - m_FrameMean);
+        m_FrameMax = std::max(m_FrameMax, interval);
+    }
+    m_LastFrameStart = frameStart;
+    m_HasFrameStart = true;
+
+    if (m_AllocationCheckWarmup >= 0) {
+        for (int i = 0; i < MemoryAllocator::CATEGORY_COUNT; i++)
+            m_FrameAllocations[i] = MemoryAllocator::Get().GetStats((MemoryAllocator::Category) i).Allocations;
+    }
     PrepareFrame(resize);
-    My_ImGui_ImplAndroid_NewFrame(resize);
+    m_TextureAtlas->Update();
+#ifdef __ANDROID__
+    if (m_Window)
+        My_ImGui_ImplAndroid_NewFrame(resize);
+    else
+#endif
+        My_ImGui_ImplHost_NewFrame();
     ImGui::NewFrame();
+    m_DrawQueue->Render(ImGui::GetBackgroundDrawList(), ImGui::GetForegroundDrawList(), *m_TextCache);
+    m_Tasks->ResumeFrame();
 }
 
 void AndroidImgui::EndFrame() {
+    // Images added during the frame, before the window cache renders them
+    m_TextureAtlas->Update();
     ImGui::Render();
-    Render(ImGui::GetDrawData());
+    ImDrawData *drawData = ImGui::GetDrawData();
+    if (m_ParallelLists) {
+        m_ParallelLists->Attach(drawData);
+    }
+    // Before the window cache: its render targets don't exist at replay time, and RenderToTarget handles ImGui's
+    // texture requests, which the capture has to see pending
+    if (m_Recorder) {
+        m_Recorder->Record(drawData);
+    }
+    if (m_WindowCache) {
+        m_WindowCache->Update(drawData);
+    }
+    m_DrawCallStats = m_MergeDrawCalls ? MergeDrawCalls(drawData) : CountDrawCalls(drawData);
+    Render(drawData);
+    if (!CanCapture() && IsCaptureRequested()) {
+        BeginCapture();
+        FinishCapture(CapturedImage(), false, false);
+    }
+
+    if (m_AllocationCheckWarmup >= 0 && m_AllocationCheckFrame++ >= m_AllocationCheckWarmup) {
+        static const char *names[] = {"imgui", "texture", "pixels"};
+        uint64_t total = 0;
+        for (int i = 0; i < MemoryAllocator::CATEGORY_COUNT; i++) {
+            uint64_t count = MemoryAllocator::Get().GetStats((MemoryAllocator::Category) i).Allocations -
+                             m_FrameAllocations[i];
+            if (count)
+                fprintf(stderr, "AndroidImgui: frame %d made %llu %s allocations\n", m_AllocationCheckFrame - 1,
+                        (unsigned long long) count, names[i]);
+            total += count;
+        }
+        IM_ASSERT(total == 0 && "Allocation in a steady-state frame");
+    }
+}
+
+ParallelDrawLists &AndroidImgui::GetParallelDrawLists() {
+    if (!m_ParallelLists)
+        m_ParallelLists = std::make_unique<ParallelDrawLists>();
+    return *m_ParallelLists;
+}
+
+void AndroidImgui::RequestCapture(CaptureCallback callback) {
+    std::lock_guard<std::mutex> lock(m_CaptureLock);
+    m_CaptureRequests.push_back(std::move(callback));
+}
+
+bool AndroidImgui::IsCaptureRequested() {
+    std::lock_guard<std::mutex> lock(m_CaptureLock);
+    return !m_CaptureRequests.empty();
+}
+
+void AndroidImgui::BeginCapture() {
+    std::lock_guard<std::mutex> lock(m_CaptureLock);
+    m_CapturesInFlight.push_back(std::move(m_CaptureRequests));
+    m_CaptureRequests.clear();
+}
+
+static void NormalizeImage(CapturedImage &image, bool bottomUp, bool bgra) {
+    if (bottomUp) {
+        for (int y = 0; y < image.Height / 2; y++)
+            std::swap_ranges(image.Pixels.begin() + (size_t) y * image.Width,
+                             image.Pixels.begin() + (size_t) (y + 1) * image.Width,
+                             image.Pixels.begin() + (size_t) (image.Height - 1 - y) * image.Width);
+    }
+    if (bgra) {
+        for (uint32_t &pixel: image.Pixels)
+            pixel = (pixel & 0xFF00FF00) | ((pixel & 0xFF) << 16) | ((pixel >> 16) & 0xFF);
+    }
+}
+
+void AndroidImgui::FinishCapture(CapturedImage image, bool bottomUp, bool bgra) {
+    std::vector<CaptureCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(m_CaptureLock);
+        if (m_CapturesInFlight.empty())
+            return;
+        callbacks = std::move(m_CapturesInFlight.front());
+        m_CapturesInFlight.pop_front();
+    }
+    if (!m_CaptureWorker)
+        m_CaptureWorker = std::make_unique<ThreadPool>(1);
+    m_CaptureWorker->Post([callbacks = std::move(callbacks), image = std::move(image), bottomUp, bgra]() mutable {
+        if (image.Pixels.size() != (size_t) image.Width * image.Height)
+            image = CapturedImage();
+        NormalizeImage(image, bottomUp, bgra);
+        for (const CaptureCallback &callback: callbacks)
+            callback(image);
+    });
+}
+
+void AndroidImgui::FlushCaptures() {
+    if (IsCaptureRequested())
+        BeginCapture();
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(m_CaptureLock);
+            if (m_CapturesInFlight.empty())
+                break;
+        }
+        FinishCapture(CapturedImage(), false, false);
+    }
+    // Joins once the queued callbacks ran
+    m_CaptureWorker.reset();
+}
+
+void AndroidImgui::SetRenderThreadPolicy(const ThreadPolicy &policy) {
+    std::lock_guard<std::mutex> lock(m_PolicyLock);
+    m_RenderPolicy = policy;
+    m_RenderPolicyPending = true;
+}
+
+bool AndroidImgui::SetWorkerThreadPolicy(const ThreadPolicy &policy) {
+    return ThreadPool::SetDefaultPolicy(policy);
+}
+
+FrameTimeStats AndroidImgui::GetFrameTimeStats() const {
+    FrameTimeStats stats;
+    stats.Frames = m_FrameCount;
+    stats.MeanMs = m_FrameMean;
+    stats.StdDevMs = m_FrameCount > 1 ? std::sqrt(m_FrameM2 / (m_FrameCount - 1)) : 0.0;
+    stats.MaxMs = m_FrameMax;
+    return stats;
+}
+
+void AndroidImgui::ResetFrameTimeStats() {
+    m_HasFrameStart = false;
+    m_FrameCount = 0;
+    m_FrameMean = 0.0;
+    m_FrameM2 = 0.0;
+    m_FrameMax = 0.0;
+}
+
+void AndroidImgui::SetZeroAllocationCheck(int warmupFrames) {
+    m_AllocationCheckWarmup = warmupFrames;
+    m_AllocationCheckFrame = 0;
 }
 
 void AndroidImgui::Shutdown() {
+    m_Tasks->Clear();
+    m_TextureLoader->Cancel();
+    StopCapture();
+    if (m_WindowCache) {
+        m_WindowCache->Clear();
+    }
+    m_TextureAtlas->Clear();
     for (auto &texture: m_Textures) {
         RemoveTexture(texture);
     }
     m_Textures.clear();
+    m_TextureSources.clear();
+    m_Shapes->Detach();
+    m_ParallelLists.reset();
+    m_TextCache->Clear();
     PrepareShutdown();
-    My_ImGui_ImplAndroid_Shutdown();
+    FlushCaptures();
+#ifdef __ANDROID__
+    if (m_Window)
+        My_ImGui_ImplAndroid_Shutdown();
+    else
+#endif
+        My_ImGui_ImplHost_Shutdown();
     ImGui::DestroyContext();
+    // Workers and the atlas, if the context used it
+    m_Startup.reset();
+    m_StartupTextures.clear();
     Cleanup();
-    ANativeWindow_release(m_Window);
+#ifdef __ANDROID__
+    if (m_Window)
+        ANativeWindow_release(m_Window);
+#endif
 }
 
 BaseTexData *AndroidImgui::LoadTextureData(const std::function<unsigned char *(BaseTexData *)> &loadFunc) {
@@ -64,6 +397,10 @@ BaseTexData *AndroidImgui::LoadTextureData(const std::function<unsigned char *(B
     if (image_data == nullptr)
         return nullptr;
 
+    if (BaseTexData *packed = m_TextureAtlas->Add(tex_data.Width, tex_data.Height, image_data)) {
+        stbi_image_free(image_data);
+        return packed;
+    }
     auto result = LoadTexture(&tex_data, image_data);
 
     stbi_image_free(image_data);
@@ -75,9 +412,12 @@ BaseTexData *AndroidImgui::LoadTextureData(const std::function<unsigned char *(B
 }
 
 BaseTexData *AndroidImgui::LoadTextureFromFile(const char *filepath) {
-    return LoadTextureData([filepath](BaseTexData *tex_data) {
+    auto result = LoadTextureData([filepath](BaseTexData *tex_data) {
         return stbi_load(filepath, &tex_data->Width, &tex_data->Height, nullptr, tex_data->Channels);
     });
+    if (result)
+        m_TextureSources[result] = filepath;
+    return result;
 }
 
 BaseTexData *AndroidImgui::LoadTextureFromMemory(void *data, int len) {
@@ -87,10 +427,167 @@ BaseTexData *AndroidImgui::LoadTextureFromMemory(void *data, int len) {
     });
 }
 
+Async<BaseTexData *> AndroidImgui::LoadTextureAsync(const char *filepath) {
+    struct Decoded {
+        std::string Path;
+        int Width = 0;
+        int Height = 0;
+        unsigned char *Pixels = nullptr;
+
+        ~Decoded() {
+            if (Pixels)
+                stbi_image_free(Pixels);
+        }
+    };
+    auto decoded = std::make_shared<Decoded>();
+    decoded->Path = filepath;
+    return {*m_Tasks, [decoded] {
+        decoded->Pixels = stbi_load(decoded->Path.c_str(), &decoded->Width, &decoded->Height, nullptr, 4);
+    }, [this, decoded]() -> BaseTexData * {
+        if (!decoded->Pixels) {
+            fprintf(stderr, "AndroidImgui: can't load %s\n", decoded->Path.c_str());
+            return nullptr;
+        }
+        auto result = LoadTextureData([&decoded](BaseTexData *tex_data) {
+            tex_data->Width = decoded->Width;
+            tex_data->Height = decoded->Height;
+            return std::exchange(decoded->Pixels, nullptr);
+        });
+        if (result)
+            m_TextureSources[result] = decoded->Path;
+        return result;
+    }};
+}
+
 void AndroidImgui::DeleteTexture(BaseTexData *tex_data) {
+    // Shared by every async texture still loading
+    if (m_TextureLoader->IsPlaceholder(tex_data))
+        return;
+    if (m_TextureAtlas->Owns(tex_data)) {
+        m_TextureSources.erase(tex_data);
+        m_TextureAtlas->Remove(tex_data);
+        return;
+    }
     RemoveTexture(tex_data);
+    m_TextureSources.erase(tex_data);
     auto it = std::find(m_Textures.begin(), m_Textures.end(), tex_data);
     if (it != m_Textures.end()) {
         m_Textures.erase(it);
     }
 }
+
+std::shared_ptr<AsyncTexture> AndroidImgui::LoadTextureInBackground(const char *filepath, TextureCallback callback) {
+    return m_TextureLoader->Load(filepath, std::move(callback));
+}
+
+std::vector<std::shared_ptr<AsyncTexture>> AndroidImgui::LoadTexturesInBackground(const std::vector<std::string> &paths,
+                                                                                  const TextureCallback &callback) {
+    std::vector<std::shared_ptr<AsyncTexture>> textures;
+    textures.reserve(paths.size());
+    for (const std::string &path: paths)
+        textures.push_back(m_TextureLoader->Load(path, callback));
+    return textures;
+}
+
+void AndroidImgui::SetTextureUploadBudget(float milliseconds) {
+    m_TextureLoader->SetUploadBudget(milliseconds);
+}
+
+int AndroidImgui::GetPendingTextureCount() const {
+    return m_TextureLoader->GetPendingCount();
+}
+
+void AndroidImgui::SetTextureAtlas(bool enable, int maxImageSize, int pageSize) {
+    m_TextureAtlas->SetEnabled(enable, maxImageSize, pageSize);
+}
+
+TextureAtlasStats AndroidImgui::GetTextureAtlasStats() const {
+    return m_TextureAtlas->GetStats();
+}
+
+void AndroidImgui::SetWindowCached(const char *name, bool cached) {
+    if (!m_WindowCache) {
+        m_WindowCache = std::make_unique<WindowRenderCache>(*this);
+    }
+    m_WindowCache->SetCached(name, cached);
+}
+
+bool AndroidImgui::StartCapture(const char *path) {
+    auto recorder = std::make_unique<DrawDataRecorder>();
+    if (!recorder->Open(path))
+        return false;
+    m_Recorder = std::move(recorder);
+    return true;
+}
+
+void AndroidImgui::StopCapture() {
+    m_Recorder.reset();
+}
+
+void AndroidImgui::RenderDrawData(ImDrawData *drawData) {
+    PrepareFrame(false);
+    Render(drawData);
+}
+
+MemoryReport AndroidImgui::GetMemoryReport(int largestTextures) {
+    MemoryReport report;
+    for (BaseTexData *texture: m_Textures) {
+        TextureMemory memory = GetTextureMemory(texture);
+        report.Bytes[MemoryReport::TEXTURE_CPU] += memory.Cpu;
+        report.Bytes[MemoryReport::TEXTURE_GPU] += memory.Gpu;
+        report.Bytes[MemoryReport::STAGING] += memory.Staging;
+        auto source = m_TextureSources.find(texture);
+        report.LargestTextures.push_back({texture, source != m_TextureSources.end() ? source->second : std::string(),
+                                          memory.Total()});
+    }
+    // Pages themselves are among m_Textures
+    report.Bytes[MemoryReport::TEXTURE_CPU] += m_TextureAtlas->GetCpuBytes();
+    std::sort(report.LargestTextures.begin(), report.LargestTextures.end(),
+              [](const MemoryReport::Texture &a, const MemoryReport::Texture &b) { return a.Bytes > b.Bytes; });
+    if ((int) report.LargestTextures.size() > largestTextures)
+        report.LargestTextures.resize(std::max(largestTextures, 0));
+
+    if (m_WindowCache) {
+        std::vector<BaseTexData *> targets;
+        m_WindowCache->CollectTargets(targets);
+        for (BaseTexData *target: targets)
+            report.Bytes[MemoryReport::FRAMEBUFFER] += GetTextureMemory(target).Total();
+    }
+
+    if (ImGui::GetCurrentContext()) {
+        // ImGui's own pixels, plus the backend's copy once created (every backend stores RGBA8)
+        for (ImTextureData *tex: ImGui::GetPlatformIO().Textures) {
+            if (tex->Pixels)
+                report.Bytes[MemoryReport::FONT_ATLAS] += (size_t) tex->GetSizeInBytes();
+            if (tex->TexID != ImTextureID_Invalid)
+                report.Bytes[MemoryReport::FONT_ATLAS] += (size_t) tex->Width * tex->Height * 4;
+        }
+        if (ImDrawData *drawData = ImGui::GetDrawData()) {
+            for (ImDrawList *drawList: drawData->CmdLists)
+                report.Bytes[MemoryReport::GEOMETRY] += (size_t) drawList->VtxBuffer.Capacity * sizeof(ImDrawVert) +
+                                                        (size_t) drawList->IdxBuffer.Capacity * sizeof(ImDrawIdx) +
+                                                        (size_t) drawList->CmdBuffer.Capacity * sizeof(ImDrawCmd);
+        }
+        report.Bytes[MemoryReport::GEOMETRY] += m_TextCache->GetStats().Bytes;
+    }
+
+    ReportMemory(report);
+    return report;
+}
+
+MemoryReport AndroidImgui::Trim(TrimLevel level) {
+    MemoryReport before = GetMemoryReport(0);
+    if (m_WindowCache)
+        m_WindowCache->Clear();
+    m_TextCache->Clear();
+    if (level == TRIM_COMPLETE && ImGui::GetCurrentContext())
+        ImGui::GetIO().Fonts->CompactCache();
+    m_TextureAtlas->Compact();
+    TrimMemory(level, m_Textures);
+    MemoryReport after = GetMemoryReport(0);
+
+    MemoryReport freed;
+    for (int i = 0; i < MemoryReport::CATEGORY_COUNT; i++)
+        freed.Bytes[i] = before.Bytes[i] > after.Bytes[i] ? before.Bytes[i] - after.Bytes[i] : 0;
+    return freed;
+}
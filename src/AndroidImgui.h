@@ -1,24 +1,82 @@
-
-
 #ifndef ANDROIDIMGUI_ANDROIDIMGUI_H
 #define ANDROIDIMGUI_ANDROIDIMGUI_H
 
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
+#include "DrawCallMerger.h"
+#include "MemoryAllocator.h"
+#include "MemoryReport.h"
+#include "StartupTimings.h"
+#include "ThreadPolicy.h"
 
 struct ANativeWindow;
 struct ImDrawData;
+struct ImVec4;
+struct ShapeFrame;
+struct StartupOptions;
+struct TextureAtlasStats;
+
+class AnalyticShapes;
+class AsyncTexture;
+class WindowRenderCache;
+class DrawDataRecorder;
+class DrawCommandQueue;
+class ParallelDrawLists;
+class StartupPipeline;
+class TaskScheduler;
+class TextLayoutCache;
+class TextureAtlas;
+class TextureLoader;
+class ThreadPool;
+
+template<typename T> class Async;
 
 struct BaseTexData {
     void *DS = nullptr;
     int Width = 0;
     int Height = 0;
     int Channels = 0;
+    // UV rect of the image inside DS
+    float U0 = 0.0f;
+    float V0 = 0.0f;
+    float U1 = 1.0f;
+    float V1 = 1.0f;
 
     BaseTexData() = default;
 
     BaseTexData(BaseTexData &other) = default;
+
+    // Backend texture objects come from MemoryAllocator (TEXTURE)
+    static void *operator new(size_t size);
+
+    static void operator delete(void *ptr);
+};
+
+// RGBA8, top row first. Empty when the backend couldn't capture the frame
+struct CapturedImage {
+    int Width = 0;
+    int Height = 0;
+    PixelBuffer Pixels;
+};
+
+using CaptureCallback = std::function<void(const CapturedImage &image)>;
+
+// UI thread, inside NewFrame before the frame starts. nullptr when the file couldn't be decoded
+using TextureCallback = std::function<void(BaseTexData *texture)>;
+
+// NewFrame-to-NewFrame intervals since the last reset
+struct FrameTimeStats {
+    int Frames = 0;
+    double MeanMs = 0.0;
+    double StdDevMs = 0.0;
+    double MaxMs = 0.0;
 };
 
 class AndroidImgui {
@@ -28,10 +86,70 @@ protected:
     float m_Height;
 
     std::vector<BaseTexData *> m_Textures;
+    std::unordered_map<BaseTexData *, std::string> m_TextureSources;
+
+    std::unique_ptr<WindowRenderCache> m_WindowCache;
+
+    bool m_MergeDrawCalls = false;
+    DrawCallStats m_DrawCallStats;
+
+    std::unique_ptr<DrawDataRecorder> m_Recorder;
+
+    std::unique_ptr<DrawCommandQueue> m_DrawQueue;
+
+    std::unique_ptr<ParallelDrawLists> m_ParallelLists;
+
+    std::unique_ptr<TextLayoutCache> m_TextCache;
+
+    std::unique_ptr<TaskScheduler> m_Tasks;
+
+    std::unique_ptr<TextureLoader> m_TextureLoader;
+
+    std::unique_ptr<TextureAtlas> m_TextureAtlas;
+
+    std::unique_ptr<AnalyticShapes> m_Shapes;
+
+    std::mutex m_CaptureLock;
+    std::vector<CaptureCallback> m_CaptureRequests;
+    std::deque<std::vector<CaptureCallback>> m_CapturesInFlight;
+    std::unique_ptr<ThreadPool> m_CaptureWorker;
+
+    std::unique_ptr<StartupPipeline> m_Startup;
+    std::chrono::steady_clock::time_point m_StartupBegin;
+    bool m_StartupPending = false;
+    StartupTimings m_StartupTimings;
+    std::vector<BaseTexData *> m_StartupTextures;
+
+    std::mutex m_PolicyLock;
+    ThreadPolicy m_RenderPolicy;
+    std::atomic<bool> m_RenderPolicyPending{false};
+
+    std::chrono::steady_clock::time_point m_LastFrameStart;
+    bool m_HasFrameStart = false;
+    int m_FrameCount = 0;
+    double m_FrameMean = 0.0;
+    double m_FrameM2 = 0.0;
+    double m_FrameMax = 0.0;
+
+    int m_AllocationCheckWarmup = -1;
+    int m_AllocationCheckFrame = 0;
+    uint64_t m_FrameAllocations[MemoryAllocator::CATEGORY_COUNT] = {};
 public:
-    AndroidImgui() = default;
+    enum TrimLevel {
+        // What comes back within a few frames: cached windows, upload buffers, spare capacity
+        TRIM_MODERATE,
+        // Also idle glyphs (the atlas is repacked next frame), shape buffers and restorable pixel copies
+        TRIM_COMPLETE
+    };
+
+    AndroidImgui();
 
-    virtual ~AndroidImgui() = default;
+    virtual ~AndroidImgui();
+
+    // Optional, before Init and on its thread: creates the device, builds the font atlas and decodes the textures
+    // on workers while the caller does its own setup (JNI, the window). Init joins the device and the atlas,
+    // the first NewFrame uploads the textures
+    void StartInit(StartupOptions options);
 
     bool Init(ANativeWindow *window, float width, float height);
 
@@ -47,9 +165,115 @@ public:
 
     void DeleteTexture(BaseTexData *tex_data);
 
+    // co_await from a FrameTask: decodes on the task pool, uploads when the task continues in NewFrame
+    Async<BaseTexData *> LoadTextureAsync(const char *filepath);
+
+    // Returns at once; decoded on a worker pool and uploaded by a later NewFrame within the upload budget. The handle
+    // shows a placeholder until then, callback (may be nullptr) runs once the texture is uploaded or failed
+    std::shared_ptr<AsyncTexture> LoadTextureInBackground(const char *filepath, TextureCallback callback);
+
+    // Decoded in parallel, callback runs for each
+    std::vector<std::shared_ptr<AsyncTexture>> LoadTexturesInBackground(const std::vector<std::string> &paths,
+                                                                        const TextureCallback &callback = nullptr);
+
+    // Upload time NewFrame spends on async textures, at least one texture per frame. 2 ms by default
+    void SetTextureUploadBudget(float milliseconds);
+
+    int GetPendingTextureCount() const;
+
+    // Opt-in: images loaded from now on with both sides up to maxImageSize share atlas pages of at most pageSize
+    // (see TextureAtlas.h). Their handles cover the whole page, draw them with their U0/V0/U1/V1
+    void SetTextureAtlas(bool enable, int maxImageSize = 128, int pageSize = 1024);
+
+    // Compare the draw calls of GetDrawCallStats with the atlas off and on for the other half of the gain
+    TextureAtlasStats GetTextureAtlasStats() const;
+
+    // StartupOptions::Textures in order once the first NewFrame ran, nullptr for those that failed to load
+    const std::vector<BaseTexData *> &GetStartupTextures() const { return m_StartupTextures; }
+
+    // Complete after the first NewFrame
+    const StartupTimings &GetStartupTimings() const { return m_StartupTimings; }
+
+    // Opt-in: render the window once into an offscreen texture and draw it as a single quad while it stays unchanged
+    void SetWindowCached(const char *name, bool cached = true);
+
+    void SetDrawCallMerging(bool enable) { m_MergeDrawCalls = enable; }
+
+    // Draw calls of the last frame before and after merging
+    const DrawCallStats &GetDrawCallStats() const { return m_DrawCallStats; }
+
+    // Appends every frame's draw data to a capture file until StopCapture (see DrawDataCapture.h)
+    bool StartCapture(const char *path);
+
+    void StopCapture();
+
+    // Renders draw data built outside NewFrame/EndFrame, e.g. a frame from DrawDataReplay
+    void RenderDrawData(ImDrawData *drawData);
+
+    // Bytes per category held by ImGui and the backend, plus the largest loaded textures. Call between frames
+    MemoryReport GetMemoryReport(int largestTextures = 8);
+
+    // Releases reclaimable memory between frames, everything is recreated on demand. Returns the bytes freed per
+    // category (LargestTextures stays empty); the atlas shrinks only after the next frame
+    MemoryReport Trim(TrimLevel level);
+
+    // Lock-free draw commands from any thread, drawn behind or above the windows from the next NewFrame on
+    DrawCommandQueue &GetDrawQueue() { return *m_DrawQueue; }
+
+    // Draw lists built on worker threads and added to the frame at EndFrame (see ParallelDrawLists.h). UI thread
+    ParallelDrawLists &GetParallelDrawLists();
+
+    // Layouts of recently drawn strings, used for the draw queue's text (see TextLayoutCache.h). UI thread
+    TextLayoutCache &GetTextCache() { return *m_TextCache; }
+
+    // Coroutines continued inside NewFrame (see FrameTask.h); unfinished ones are destroyed at Shutdown
+    TaskScheduler &GetTasks() { return *m_Tasks; }
+
+    // Reads the next rendered frame back without stalling it; callback runs on a worker thread once the pixels
+    // arrived, a few frames later on GPU backends. Any thread
+    void RequestCapture(CaptureCallback callback);
+
+    // Applied by the next NewFrame to the thread calling it. Any thread
+    void SetRenderThreadPolicy(const ThreadPolicy &policy);
+
+    // Every worker pool: draw lists, tasks, captures (ThreadPool::SetDefaultPolicy)
+    bool SetWorkerThreadPolicy(const ThreadPolicy &policy);
+
+    // Frame pacing as the render thread sees it, e.g. to compare policies
+    FrameTimeStats GetFrameTimeStats() const;
+
+    void ResetFrameTimeStats();
+
+    // Debug aid: after warmupFrames frames, every frame (NewFrame to EndFrame) that still allocates through
+    // MemoryAllocator is logged per category and trips IM_ASSERT. -1 turns the check off. Covers ImGui's own
+    // allocations, BaseTexData objects and PixelBuffers only: the std containers of the queues, caches and atlas,
+    // backend bookkeeping and driver memory aren't seen
+    void SetZeroAllocationCheck(int warmupFrames);
+
+protected:
+    // Backends, in Render: a capture waits for this frame. BeginCapture when its readback started, FinishCapture
+    // with the pixels in the order captures began; rows may come bottom-up and in BGRA, the worker converts them
+    bool IsCaptureRequested();
+
+    void BeginCapture();
+
+    void FinishCapture(CapturedImage image, bool bottomUp, bool bgra);
+
 private:
+    friend class WindowRenderCache;
+    friend class AnalyticShapes;
+    friend class SwitchableGraphics;
+    friend class StartupPipeline;
+    friend class TextureLoader;
+    friend class TextureAtlas;
+
+    void JoinStartup();
+
     BaseTexData *LoadTextureData(const std::function<unsigned char *(BaseTexData *)> &loadFunc);
 
+    // Window-independent part of Create, callable from any thread before Init. Create runs it when it was skipped.
+    virtual bool CreateDevice() { return true; }
+
     virtual bool Create() = 0;
 
     virtual void Setup() = 0;
@@ -64,7 +288,44 @@ private:
 
     virtual BaseTexData *LoadTexture(BaseTexData *tex_data, void *pixel_data) = 0;
 
+    // Replaces the pixels of a rect of a loaded texture in place, DS stays the same. pixel_data is the whole image,
+    // rows Width pixels apart. Between frames or before the main pass; false when the backend can't
+    virtual bool UpdateTexture(BaseTexData *tex_data, const void *pixel_data, int x, int y, int width, int height) {
+        return false;
+    }
+
+    // Also while submitted frames still sample it, the GPU copy goes once they completed
     virtual void RemoveTexture(BaseTexData *tex_data) = 0;
+
+    virtual BaseTexData *CreateRenderTarget(int width, int height) = 0;
+
+    // drawData->DisplayPos maps to the top-left corner of the target
+    virtual bool RenderToTarget(BaseTexData *target, ImDrawData *drawData) = 0;
+
+    virtual void RemoveRenderTarget(BaseTexData *target) = 0;
+
+    // Whether Render serves capture requests, the others get an empty image
+    virtual bool CanCapture() { return false; }
+
+    // Hands requests and readbacks still in flight to their callbacks with an empty image, then waits for them
+    void FlushCaptures();
+
+    // Blocks until everything submitted so far, render targets included, has executed
+    virtual void WaitIdle() {}
+
+    virtual TextureMemory GetTextureMemory(BaseTexData *tex_data) = 0;
+
+    // Backend-wide memory: window buffers, descriptor pools, vertex/index buffers
+    virtual void ReportMemory(MemoryReport &report) = 0;
+
+    virtual void TrimMemory(TrimLevel level, const std::vector<BaseTexData *> &textures) = 0;
+
+    // Draws shapes [firstShape, firstShape + shapeCount) of the frame, the vertices change once per Generation
+    virtual void RenderShapes(const ShapeFrame &frame, int firstShape, int shapeCount, const ImVec4 &clipRect) = 0;
+
+    // From a draw callback: commands up to the next ImDrawCallback_ResetRenderState blend premultiplied colour
+    // (ONE, ONE_MINUS_SRC_ALPHA)
+    virtual void BlendPremultiplied() {}
 };
 
 
@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <cstring>
+#ifdef __ANDROID__
+#include <sys/system_properties.h>
+#else
+#include <sys/utsname.h>
+#endif
+#include "BackendProbe.h"
+#include "imgui.h"
+
+std::string BackendProbe::DeviceFingerprint() {
+    std::string fingerprint;
+#ifdef __ANDROID__
+    const char *properties[] = {
+        "ro.build.fingerprint", "ro.board.platform", "ro.hardware", "ro.hardware.egl", "ro.hardware.vulkan"
+    };
+    char value[PROP_VALUE_MAX];
+    for (const char *name: properties) {
+        value[0] = '\0';
+        __system_property_get(name, value);
+        fingerprint += value;
+        fingerprint += '|';
+    }
+#else
+    utsname name{};
+    if (uname(&name) == 0) {
+        fingerprint += name.sysname;
+        fingerprint += '|';
+        fingerprint += name.release;
+        fingerprint += '|';
+        fingerprint += name.machine;
+    }
+#endif
+    return fingerprint;
+}
+
+// Two lines: the fingerprint, then the GraphicsAPI value
+bool BackendProbe::LoadDecision(const char *path, GraphicsManager::GraphicsAPI &api) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return false;
+    char line[1024];
+    bool matched = fgets(line, sizeof(line), file) != nullptr;
+    if (matched) {
+        line[strcspn(line, "\n")] = '\0';
+        matched = DeviceFingerprint() == line;
+    }
+    int value = -1;
+    if (matched)
+        matched = fscanf(file, "%d", &value) == 1;
+    fclose(file);
+
+    if (!matched || (value != GraphicsManager::OPENGL && value != GraphicsManager::VULKAN &&
+                     value != GraphicsManager::SOFTWARE))
+        return false;
+    api = (GraphicsManager::GraphicsAPI) value;
+    return true;
+}
+
+bool BackendProbe::SaveDecision(const char *path, GraphicsManager::GraphicsAPI api) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "BackendProbe: can't write %s\n", path);
+        return false;
+    }
+    fprintf(file, "%s\n%d\n", DeviceFingerprint().c_str(), (int) api);
+    fclose(file);
+    return true;
+}
+
+void BackendProbe::BuildWorkload(ImDrawList *drawList, float width, float height) {
+    drawList->_ResetForNewFrame();
+    drawList->PushClipRect(ImVec2(0.0f, 0.0f), ImVec2(width, height));
+    drawList->PushTexture(ImGui::GetIO().Fonts->TexRef);
+
+    // Fixed sequence so every backend and every device draws the same frame
+    uint32_t seed = 0x12345678u;
+    auto next = [&seed](float range) {
+        seed = seed * 1664525u + 1013904223u;
+        return (float) (seed >> 8) / (float) (1u << 24) * range;
+    };
+
+    for (int i = 0; i < 300; i++) {
+        ImVec2 a(next(width), next(height));
+        ImVec2 b(next(width), next(height));
+        drawList->AddLine(a, b, IM_COL32(255, 64 + i % 192, 32, 200), 1.0f + (float) (i % 3));
+    }
+    for (int i = 0; i < 150; i++) {
+        float x = next(width), y = next(height);
+        float w = 20.0f + next(200.0f), h = 20.0f + next(120.0f);
+        drawList->AddRectFilled(ImVec2(x, y), ImVec2(x + w, y + h), IM_COL32(32, 32, 32, 160), 6.0f);
+        drawList->AddRect(ImVec2(x, y), ImVec2(x + w, y + h), IM_COL32(0, 255, 128, 255), 6.0f, 0, 1.5f);
+    }
+    for (int i = 0; i < 100; i++) {
+        ImVec2 center(next(width), next(height));
+        drawList->AddCircleFilled(center, 4.0f + next(40.0f), IM_COL32(255, 255, 0, 120));
+        drawList->AddCircle(center, 8.0f + next(60.0f), IM_COL32(255, 0, 0, 255), 0, 2.0f);
+    }
+    // Stand-in for text: small quads sampling the atlas
+    for (int i = 0; i < 2000; i++) {
+        float x = next(width), y = next(height);
+        drawList->AddImage(ImGui::GetIO().Fonts->TexRef, ImVec2(x, y), ImVec2(x + 8.0f, y + 14.0f),
+                           ImVec2(0.0f, 0.0f), ImVec2(0.05f, 0.05f), IM_COL32_WHITE);
+    }
+
+    drawList->PopTexture();
+    drawList->PopClipRect();
+}
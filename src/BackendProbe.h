@@ -0,0 +1,24 @@
+#ifndef ANDROIDIMGUI_BACKENDPROBE_H
+#define ANDROIDIMGUI_BACKENDPROBE_H
+
+#include <string>
+#include "GraphicsManager.h"
+
+struct ImDrawList;
+
+// Helpers for GraphicsManager::AUTO: which device we run on, the decision made for it last time and the synthetic
+// frame every candidate backend is timed with
+class BackendProbe {
+public:
+    // Build fingerprint, SoC and driver properties; changes with OS or driver updates
+    static std::string DeviceFingerprint();
+
+    static bool LoadDecision(const char *path, GraphicsManager::GraphicsAPI &api);
+
+    static bool SaveDecision(const char *path, GraphicsManager::GraphicsAPI api);
+
+    // Overlay-like content covering width x height: AA lines and outlines, fills, circles and atlas-sampled quads
+    static void BuildWorkload(ImDrawList *drawList, float width, float height);
+};
+
+#endif //ANDROIDIMGUI_BACKENDPROBE_H
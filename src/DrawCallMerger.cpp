@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cfloat>
+#include "imgui.h"
+#include "DrawCallMerger.h"
+
+static inline bool RectContains(const ImVec4 &outer, const ImVec4 &inner) {
+    return inner.x >= outer.x && inner.y >= outer.y && inner.z <= outer.z && inner.w <= outer.w;
+}
+
+static inline ImVec4 RectUnion(const ImVec4 &a, const ImVec4 &b) {
+    return {std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.z, b.z), std::max(a.w, b.w)};
+}
+
+static ImVec4 CommandBounds(const ImDrawList *drawList, const ImDrawCmd &cmd) {
+    ImVec4 bounds(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+    const ImDrawVert *vtx = drawList->VtxBuffer.Data + cmd.VtxOffset;
+    const ImDrawIdx *idx = drawList->IdxBuffer.Data + cmd.IdxOffset;
+    for (unsigned int i = 0; i < cmd.ElemCount; i++) {
+        const ImVec2 &pos = vtx[idx[i]].pos;
+        bounds.x = std::min(bounds.x, pos.x);
+        bounds.y = std::min(bounds.y, pos.y);
+        bounds.z = std::max(bounds.z, pos.x);
+        bounds.w = std::max(bounds.w, pos.y);
+    }
+    return bounds;
+}
+
+DrawCallStats CountDrawCalls(const ImDrawData *drawData) {
+    DrawCallStats stats;
+    for (const ImDrawList *drawList: drawData->CmdLists)
+        for (const ImDrawCmd &cmd: drawList->CmdBuffer)
+            if (cmd.UserCallback == nullptr)
+                stats.Before++;
+    stats.After = stats.Before;
+    return stats;
+}
+
+DrawCallStats MergeDrawCalls(ImDrawData *drawData) {
+    DrawCallStats stats;
+    for (ImDrawList *drawList: drawData->CmdLists) {
+        ImVector<ImDrawCmd> &cmds = drawList->CmdBuffer;
+        int out = -1;
+        // Whether the run's geometry lies inside its clip rect, -1 until a merge candidate asks. A run of one
+        // command that nothing can join is never scanned
+        int runContained = 0;
+        for (int n = 0; n < cmds.Size; n++) {
+            const ImDrawCmd cmd = cmds[n];
+            if (cmd.UserCallback != nullptr) {
+                cmds[++out] = cmd;
+                runContained = 0;
+                continue;
+            }
+            stats.Before++;
+            if (cmd.ElemCount == 0)
+                continue;
+
+            if (out >= 0) {
+                ImDrawCmd &prev = cmds[out];
+                bool compatible = prev.UserCallback == nullptr && prev.TexRef == cmd.TexRef &&
+                                  prev.VtxOffset == cmd.VtxOffset &&
+                                  prev.IdxOffset + prev.ElemCount == cmd.IdxOffset;
+                if (compatible) {
+                    ImVec4 bounds = CommandBounds(drawList, cmd);
+                    bool contained = RectContains(cmd.ClipRect, bounds);
+                    if (contained && runContained < 0)
+                        runContained = RectContains(prev.ClipRect, CommandBounds(drawList, prev));
+                    if (contained && (runContained || RectContains(prev.ClipRect, bounds))) {
+                        // Either both sides clip nothing (grow to the union) or cmd fits the run's rect as is
+                        if (runContained)
+                            prev.ClipRect = RectUnion(prev.ClipRect, cmd.ClipRect);
+                        prev.ElemCount += cmd.ElemCount;
+                        continue;
+                    }
+                    cmds[++out] = cmd;
+                    runContained = contained;
+                    continue;
+                }
+            }
+            cmds[++out] = cmd;
+            runContained = -1;
+        }
+        cmds.resize(out + 1);
+        for (const ImDrawCmd &cmd: cmds)
+            if (cmd.UserCallback == nullptr)
+                stats.After++;
+    }
+    return stats;
+}
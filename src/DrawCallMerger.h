@@ -0,0 +1,22 @@
+#ifndef ANDROIDIMGUI_DRAWCALLMERGER_H
+#define ANDROIDIMGUI_DRAWCALLMERGER_H
+
+struct ImDrawData;
+
+struct DrawCallStats {
+    int Before = 0; // draw commands produced by ImGui (callbacks excluded)
+    int After = 0;  // draw commands handed to the backend
+};
+
+// Merges adjacent ImDrawCmds of a draw list that share texture and vertex offset. ImGui starts a new command for
+// every clip rect change, but most of them clip nothing: their geometry already lies inside the rect. Such
+// commands are merged under the union of their rects, so the result is pixel-identical to the original.
+// Clipping stays with the scissor rather than moving into the shaders: the GL and Vulkan backends draw with
+// ImGui's own pipelines and ImDrawVert layout, which have no room for a per-vertex clip rect. The CPU cost is one
+// read of every index of a command that could join its predecessor (same texture, contiguous indices), plus the
+// run's first command once; other commands aren't scanned.
+DrawCallStats MergeDrawCalls(ImDrawData *drawData);
+
+DrawCallStats CountDrawCalls(const ImDrawData *drawData);
+
+#endif //ANDROIDIMGUI_DRAWCALLMERGER_H
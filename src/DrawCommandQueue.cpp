@@ -0,0 +1,372 @@
+#include "imgui_internal.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+#include "DrawCommandQueue.h"
+#include "AndroidImgui.h"
+#include "TextLayoutCache.h"
+
+// 16-bit indices: every reservation has to stay below 65536 vertices
+static constexpr int kMaxChunkVertices = 60000;
+
+static std::atomic<uint64_t> s_NextQueueId{1};
+
+// Queues alive, for exiting threads. Taken when a queue comes or goes and when a thread that claimed a slot exits
+static std::mutex s_LiveQueuesLock;
+static std::unordered_set<uint64_t> s_LiveQueues;
+
+thread_local uint64_t DrawCommandQueue::t_QueueId = 0;
+thread_local DrawCommandQueue::ThreadSlot *DrawCommandQueue::t_Slot = nullptr;
+thread_local DrawCommandQueue::ThreadExitGuard DrawCommandQueue::t_ExitGuard;
+
+DrawCommandQueue::DrawCommandQueue() : m_Id(s_NextQueueId.fetch_add(1)) {
+    std::lock_guard<std::mutex> lock(s_LiveQueuesLock);
+    s_LiveQueues.insert(m_Id);
+}
+
+DrawCommandQueue::~DrawCommandQueue() {
+    std::lock_guard<std::mutex> lock(s_LiveQueuesLock);
+    s_LiveQueues.erase(m_Id);
+}
+
+DrawCommandQueue::ThreadExitGuard::~ThreadExitGuard() {
+    std::lock_guard<std::mutex> lock(s_LiveQueuesLock);
+    for (auto &[queueId, slot]: Claimed) {
+        if (s_LiveQueues.count(queueId))
+            ReleaseSlot(slot);
+    }
+}
+
+DrawCommandQueue::ThreadSlot *DrawCommandQueue::GetSlot() {
+    if (t_QueueId == m_Id)
+        return t_Slot;
+
+    std::thread::id self = std::this_thread::get_id();
+    ThreadSlot *found = nullptr;
+    for (ThreadSlot &slot: m_Slots) {
+        if (slot.InUse.load(std::memory_order_acquire) && slot.Owner.load(std::memory_order_relaxed) == self) {
+            found = &slot;
+            break;
+        }
+    }
+    for (int i = 0; !found && i < kMaxThreads; i++) {
+        bool expected = false;
+        if (m_Slots[i].InUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            m_Slots[i].Owner.store(self, std::memory_order_relaxed);
+            found = &m_Slots[i];
+            t_ExitGuard.Claimed.emplace_back(m_Id, found);
+        }
+    }
+    if (!found) {
+        // Every command of every extra thread lands here
+        if (!m_FullReported.exchange(true, std::memory_order_relaxed))
+            fprintf(stderr, "DrawCommandQueue: more than %d threads, their commands are dropped\n", kMaxThreads);
+        return nullptr;
+    }
+    t_QueueId = m_Id;
+    t_Slot = found;
+    return found;
+}
+
+void DrawCommandQueue::Push(const Command &command) {
+    if (ThreadSlot *slot = GetSlot())
+        slot->Buffers[slot->Writing].Commands.push_back(command);
+}
+
+void DrawCommandQueue::AddLine(const ImVec2 &p1, const ImVec2 &p2, ImU32 col, float thickness, Layer layer) {
+    Push({LINE, (uint8_t) layer, col, p1.x, p1.y, p2.x, p2.y, thickness});
+}
+
+void DrawCommandQueue::AddRect(const ImVec2 &pMin, const ImVec2 &pMax, ImU32 col, float thickness, Layer layer) {
+    Push({RECT, (uint8_t) layer, col, pMin.x, pMin.y, pMax.x, pMax.y, thickness});
+}
+
+void DrawCommandQueue::AddRectFilled(const ImVec2 &pMin, const ImVec2 &pMax, ImU32 col, Layer layer) {
+    Push({RECT_FILLED, (uint8_t) layer, col, pMin.x, pMin.y, pMax.x, pMax.y, 0.0f});
+}
+
+void DrawCommandQueue::AddCircle(const ImVec2 &center, float radius, ImU32 col, float thickness, Layer layer) {
+    Push({CIRCLE, (uint8_t) layer, col, center.x, center.y, radius, 0.0f, thickness});
+}
+
+void DrawCommandQueue::AddCircleFilled(const ImVec2 &center, float radius, ImU32 col, Layer layer) {
+    Push({CIRCLE_FILLED, (uint8_t) layer, col, center.x, center.y, radius, 0.0f, 0.0f});
+}
+
+void DrawCommandQueue::AddText(const ImVec2 &pos, ImU32 col, const char *text, float fontSize, Layer layer) {
+    ThreadSlot *slot = GetSlot();
+    if (!slot || !text)
+        return;
+    Batch &batch = slot->Buffers[slot->Writing];
+    Command command = {TEXT, (uint8_t) layer, col, pos.x, pos.y, 0.0f, 0.0f, fontSize};
+    command.TextOffset = (uint32_t) batch.Text.size();
+    command.TextLength = (uint32_t) strlen(text);
+    batch.Text.insert(batch.Text.end(), text, text + command.TextLength);
+    batch.Commands.push_back(command);
+}
+
+void DrawCommandQueue::AddImage(BaseTexData *image, const ImVec2 &pMin, const ImVec2 &pMax, ImU32 tint,
+                                Layer layer) {
+    if (!image)
+        return;
+    Command command = {IMAGE, (uint8_t) layer, tint, pMin.x, pMin.y, pMax.x, pMax.y, 0.0f};
+    command.Image = image;
+    Push(command);
+}
+
+void DrawCommandQueue::Submit() {
+    ThreadSlot *slot = GetSlot();
+    if (!slot)
+        return;
+    slot->Writing = slot->Ready.exchange(slot->Writing | kFresh, std::memory_order_acq_rel) & ~kFresh;
+    slot->Buffers[slot->Writing].Clear();
+}
+
+void DrawCommandQueue::ReleaseThread() {
+    ThreadSlot *slot = GetSlot();
+    if (!slot)
+        return;
+    // Forgotten before the slot is up for grabs, the next command claims a slot again
+    t_QueueId = 0;
+    t_Slot = nullptr;
+    auto &claimed = t_ExitGuard.Claimed;
+    claimed.erase(std::remove(claimed.begin(), claimed.end(), std::make_pair(m_Id, slot)), claimed.end());
+    ReleaseSlot(slot);
+}
+
+void DrawCommandQueue::ReleaseSlot(ThreadSlot *slot) {
+    // An empty batch replaces what the thread showed
+    slot->Buffers[slot->Writing].Clear();
+    slot->Writing = slot->Ready.exchange(slot->Writing | kFresh, std::memory_order_acq_rel) & ~kFresh;
+    slot->Buffers[slot->Writing].Clear();
+    // Writing stays consistent for whichever thread claims the slot next
+    slot->Owner.store(std::thread::id(), std::memory_order_relaxed);
+    slot->InUse.store(false, std::memory_order_release);
+}
+
+static inline ImU32 ScaleAlpha(ImU32 col, float scale) {
+    ImU32 alpha = (ImU32) ((float) ((col & IM_COL32_A_MASK) >> IM_COL32_A_SHIFT) * scale);
+    return (col & ~IM_COL32_A_MASK) | (alpha << IM_COL32_A_SHIFT);
+}
+
+static inline void WriteQuad(ImDrawList *drawList, unsigned int a, unsigned int b, unsigned int c, unsigned int d) {
+    drawList->PrimWriteIdx((ImDrawIdx) a);
+    drawList->PrimWriteIdx((ImDrawIdx) b);
+    drawList->PrimWriteIdx((ImDrawIdx) c);
+    drawList->PrimWriteIdx((ImDrawIdx) a);
+    drawList->PrimWriteIdx((ImDrawIdx) c);
+    drawList->PrimWriteIdx((ImDrawIdx) d);
+}
+
+static int CircleSegments(ImDrawList *drawList, float radius) {
+    return ImMax(drawList->_CalcCircleAutoSegmentCount(radius), 3);
+}
+
+// Anti-aliased the way ImGui does it: a 1px fringe fading to transparent around the solid part.
+// Counts must match the writers below exactly.
+static void CountShape(ImDrawList *drawList, uint8_t kind, float radius, int &vtx, int &idx) {
+    switch (kind) {
+        case 0: // line
+            vtx = 8;
+            idx = 18;
+            break;
+        case 1: // rect outline, four lines
+            vtx = 32;
+            idx = 72;
+            break;
+        case 2: // filled rect
+            vtx = 8;
+            idx = 30;
+            break;
+        case 3: { // circle outline
+            int n = CircleSegments(drawList, radius);
+            vtx = 4 * n;
+            idx = 18 * n;
+            break;
+        }
+        default: { // filled circle
+            int n = CircleSegments(drawList, radius);
+            vtx = 2 * n;
+            idx = 3 * (n - 2) + 6 * n;
+            break;
+        }
+    }
+}
+
+static void WriteLine(ImDrawList *drawList, const ImVec2 &uv, float x0, float y0, float x1, float y1, ImU32 col,
+                      float thickness) {
+    float dx = x1 - x0, dy = y1 - y0;
+    float length = std::sqrt(dx * dx + dy * dy);
+    if (length > 0.0f) {
+        dx /= length;
+        dy /= length;
+    } else {
+        dx = 1.0f;
+        dy = 0.0f;
+    }
+    // Thin lines keep a 1px core and get fainter instead
+    float core = ImMax(thickness - 1.0f, 0.0f) * 0.5f;
+    float fringe = core + 1.0f;
+    ImU32 coreCol = thickness < 1.0f ? ScaleAlpha(col, thickness) : col;
+    ImU32 clear = col & ~IM_COL32_A_MASK;
+    const float offsets[4] = {-fringe, -core, core, fringe};
+    const ImU32 cols[4] = {clear, coreCol, coreCol, clear};
+    unsigned int base = drawList->_VtxCurrentIdx;
+    for (int i = 0; i < 4; i++)
+        drawList->PrimWriteVtx(ImVec2(x0 - dy * offsets[i], y0 + dx * offsets[i]), uv, cols[i]);
+    for (int i = 0; i < 4; i++)
+        drawList->PrimWriteVtx(ImVec2(x1 - dy * offsets[i], y1 + dx * offsets[i]), uv, cols[i]);
+    for (int i = 0; i < 3; i++)
+        WriteQuad(drawList, base + i, base + i + 1, base + i + 5, base + i + 4);
+}
+
+static void WriteRectFilled(ImDrawList *drawList, const ImVec2 &uv, float x0, float y0, float x1, float y1,
+                            ImU32 col) {
+    ImU32 clear = col & ~IM_COL32_A_MASK;
+    unsigned int base = drawList->_VtxCurrentIdx;
+    const float inset[2] = {0.5f, -0.5f};
+    const ImU32 cols[2] = {col, clear};
+    for (int ring = 0; ring < 2; ring++) {
+        drawList->PrimWriteVtx(ImVec2(x0 + inset[ring], y0 + inset[ring]), uv, cols[ring]);
+        drawList->PrimWriteVtx(ImVec2(x1 - inset[ring], y0 + inset[ring]), uv, cols[ring]);
+        drawList->PrimWriteVtx(ImVec2(x1 - inset[ring], y1 - inset[ring]), uv, cols[ring]);
+        drawList->PrimWriteVtx(ImVec2(x0 + inset[ring], y1 - inset[ring]), uv, cols[ring]);
+    }
+    WriteQuad(drawList, base, base + 1, base + 2, base + 3);
+    for (unsigned int i = 0; i < 4; i++)
+        WriteQuad(drawList, base + i, base + (i + 1) % 4, base + 4 + (i + 1) % 4, base + 4 + i);
+}
+
+static void WriteCircle(ImDrawList *drawList, const ImVec2 &uv, float cx, float cy, float radius, ImU32 col,
+                        float thickness, bool filled) {
+    const int n = CircleSegments(drawList, radius);
+    ImU32 clear = col & ~IM_COL32_A_MASK;
+    const int rings = filled ? 2 : 4;
+    float radii[4];
+    ImU32 cols[4];
+    if (filled) {
+        radii[0] = radius - 0.5f;
+        radii[1] = radius + 0.5f;
+        cols[0] = col;
+        cols[1] = clear;
+    } else {
+        float core = ImMax(thickness - 1.0f, 0.0f) * 0.5f;
+        ImU32 coreCol = thickness < 1.0f ? ScaleAlpha(col, thickness) : col;
+        radii[0] = radius - core - 1.0f;
+        radii[1] = radius - core;
+        radii[2] = radius + core;
+        radii[3] = radius + core + 1.0f;
+        cols[0] = clear;
+        cols[1] = coreCol;
+        cols[2] = coreCol;
+        cols[3] = clear;
+    }
+
+    unsigned int base = drawList->_VtxCurrentIdx;
+    for (int ring = 0; ring < rings; ring++) {
+        float r = ImMax(radii[ring], 0.0f);
+        for (int i = 0; i < n; i++) {
+            float a = (float) i * (2.0f * IM_PI / (float) n);
+            drawList->PrimWriteVtx(ImVec2(cx + std::cos(a) * r, cy + std::sin(a) * r), uv, cols[ring]);
+        }
+    }
+    if (filled) {
+        for (int i = 1; i < n - 1; i++) {
+            drawList->PrimWriteIdx((ImDrawIdx) base);
+            drawList->PrimWriteIdx((ImDrawIdx) (base + i));
+            drawList->PrimWriteIdx((ImDrawIdx) (base + i + 1));
+        }
+    }
+    for (int ring = 0; ring + 1 < rings; ring++) {
+        unsigned int inner = base + ring * n;
+        unsigned int outer = inner + n;
+        for (int i = 0; i < n; i++)
+            WriteQuad(drawList, inner + i, inner + (i + 1) % n, outer + (i + 1) % n, outer + i);
+    }
+}
+
+void DrawCommandQueue::RenderShapes(const Batch &batch, ImDrawList *drawList, Layer layer) {
+    const ImVec2 uv = drawList->_Data->TexUvWhitePixel;
+    const size_t count = batch.Commands.size();
+    size_t first = 0;
+    while (first < count) {
+        // Reserve for as many shapes as fit one index range, then write them all
+        int vtxTotal = 0, idxTotal = 0;
+        size_t end = first;
+        for (; end < count; end++) {
+            const Command &command = batch.Commands[end];
+            if (command.Target != layer || command.Kind > CIRCLE_FILLED)
+                continue;
+            int vtx, idx;
+            CountShape(drawList, command.Kind, command.X1, vtx, idx);
+            if (vtxTotal > 0 && vtxTotal + vtx > kMaxChunkVertices)
+                break;
+            vtxTotal += vtx;
+            idxTotal += idx;
+        }
+        if (vtxTotal > 0)
+            drawList->PrimReserve(idxTotal, vtxTotal);
+
+        for (size_t i = first; i < end; i++) {
+            const Command &c = batch.Commands[i];
+            if (c.Target != layer)
+                continue;
+            switch (c.Kind) {
+                case LINE:
+                    WriteLine(drawList, uv, c.X0, c.Y0, c.X1, c.Y1, c.Col, c.Size);
+                    break;
+                case RECT: {
+                    // Half the thickness inside the rect, like ImDrawList::AddRect
+                    float h = c.Size * 0.5f;
+                    WriteLine(drawList, uv, c.X0 - h, c.Y0, c.X1 + h, c.Y0, c.Col, c.Size);
+                    WriteLine(drawList, uv, c.X0 - h, c.Y1, c.X1 + h, c.Y1, c.Col, c.Size);
+                    WriteLine(drawList, uv, c.X0, c.Y0 + h, c.X0, c.Y1 - h, c.Col, c.Size);
+                    WriteLine(drawList, uv, c.X1, c.Y0 + h, c.X1, c.Y1 - h, c.Col, c.Size);
+                    break;
+                }
+                case RECT_FILLED:
+                    WriteRectFilled(drawList, uv, c.X0, c.Y0, c.X1, c.Y1, c.Col);
+                    break;
+                case CIRCLE:
+                    WriteCircle(drawList, uv, c.X0, c.Y0, c.X1, c.Col, c.Size, false);
+                    break;
+                case CIRCLE_FILLED:
+                    WriteCircle(drawList, uv, c.X0, c.Y0, c.X1, c.Col, 0.0f, true);
+                    break;
+                default:
+                    break;
+            }
+        }
+        first = end;
+    }
+}
+
+void DrawCommandQueue::Render(ImDrawList *background, ImDrawList *foreground, TextLayoutCache &textCache) {
+    for (ThreadSlot &slot: m_Slots) {
+        if (slot.Ready.load(std::memory_order_relaxed) & kFresh)
+            slot.Reading = slot.Ready.exchange(slot.Reading, std::memory_order_acq_rel) & ~kFresh;
+        const Batch &batch = slot.Buffers[slot.Reading];
+        if (batch.Commands.empty())
+            continue;
+
+        for (int layer = BACKGROUND; layer <= FOREGROUND; layer++) {
+            ImDrawList *drawList = layer == BACKGROUND ? background : foreground;
+            RenderShapes(batch, drawList, (Layer) layer);
+            for (const Command &c: batch.Commands) {
+                if (c.Target != layer)
+                    continue;
+                if (c.Kind == IMAGE) {
+                    drawList->AddImage((ImTextureID) (intptr_t) c.Image->DS, ImVec2(c.X0, c.Y0), ImVec2(c.X1, c.Y1),
+                                       ImVec2(c.Image->U0, c.Image->V0), ImVec2(c.Image->U1, c.Image->V1), c.Col);
+                } else if (c.Kind == TEXT) {
+                    const char *text = batch.Text.data() + c.TextOffset;
+                    textCache.AddText(drawList, ImGui::GetFont(), c.Size, ImVec2(c.X0, c.Y0), c.Col, text,
+                                      text + c.TextLength);
+                }
+            }
+        }
+    }
+}
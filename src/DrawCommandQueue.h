@@ -0,0 +1,127 @@
+#ifndef ANDROIDIMGUI_DRAWCOMMANDQUEUE_H
+#define ANDROIDIMGUI_DRAWCOMMANDQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "imgui.h"
+
+struct BaseTexData;
+class TextLayoutCache;
+
+// Draw commands from any thread without locks. Each thread fills its own batch and publishes it with Submit; the
+// UI thread picks up every thread's newest batch at NewFrame and draws it each frame until that thread submits
+// again (a triple buffer per thread, so neither side ever waits). Shapes are tessellated here with one vertex
+// reservation per draw list, then images and text follow.
+class DrawCommandQueue {
+public:
+    enum Layer {
+        BACKGROUND, // behind every window
+        FOREGROUND  // above every window
+    };
+
+    // Threads that can have a batch at the same time, further threads' commands are dropped
+    static constexpr int kMaxThreads = 32;
+
+    DrawCommandQueue();
+
+    ~DrawCommandQueue();
+
+    void AddLine(const ImVec2 &p1, const ImVec2 &p2, ImU32 col, float thickness = 1.0f, Layer layer = BACKGROUND);
+
+    void AddRect(const ImVec2 &pMin, const ImVec2 &pMax, ImU32 col, float thickness = 1.0f,
+                 Layer layer = BACKGROUND);
+
+    void AddRectFilled(const ImVec2 &pMin, const ImVec2 &pMax, ImU32 col, Layer layer = BACKGROUND);
+
+    void AddCircle(const ImVec2 &center, float radius, ImU32 col, float thickness = 1.0f, Layer layer = BACKGROUND);
+
+    void AddCircleFilled(const ImVec2 &center, float radius, ImU32 col, Layer layer = BACKGROUND);
+
+    // fontSize 0 = the current font size
+    void AddText(const ImVec2 &pos, ImU32 col, const char *text, float fontSize = 0.0f, Layer layer = BACKGROUND);
+
+    // The texture has to stay loaded while a submitted batch refers to it
+    void AddImage(BaseTexData *image, const ImVec2 &pMin, const ImVec2 &pMax, ImU32 tint = IM_COL32_WHITE,
+                  Layer layer = BACKGROUND);
+
+    // Replaces what the calling thread showed so far with the commands added since its last Submit
+    void Submit();
+
+    // Hides the calling thread's commands and frees its slot. Done for every queue when the thread exits
+    void ReleaseThread();
+
+    // UI thread, after ImGui::NewFrame
+    void Render(ImDrawList *background, ImDrawList *foreground, TextLayoutCache &textCache);
+
+private:
+    enum Type : uint8_t {
+        LINE,
+        RECT,
+        RECT_FILLED,
+        CIRCLE,
+        CIRCLE_FILLED,
+        TEXT,
+        IMAGE
+    };
+
+    struct Command {
+        Type Kind;
+        uint8_t Target; // Layer
+        ImU32 Col;
+        float X0, Y0, X1, Y1; // CIRCLE*: center and radius in X1
+        float Size;           // thickness or font size
+        BaseTexData *Image;
+        uint32_t TextOffset;
+        uint32_t TextLength;
+    };
+
+    struct Batch {
+        std::vector<Command> Commands;
+        std::vector<char> Text;
+
+        void Clear() {
+            Commands.clear();
+            Text.clear();
+        }
+    };
+
+    static constexpr int kFresh = 4; // set in Ready while the UI thread hasn't taken the buffer
+
+    struct ThreadSlot {
+        std::atomic<bool> InUse{false};
+        std::atomic<std::thread::id> Owner{};
+        Batch Buffers[3];
+        int Writing = 0;            // producer thread only
+        std::atomic<int> Ready{1};  // buffer index | kFresh
+        int Reading = 2;            // UI thread only
+    };
+
+    // Slots the thread claimed, released by its destructor at thread exit unless their queue is gone
+    struct ThreadExitGuard {
+        std::vector<std::pair<uint64_t, ThreadSlot *>> Claimed;
+
+        ~ThreadExitGuard();
+    };
+
+    // The calling thread's slot, keyed by queue id rather than address: a new queue may reuse a destroyed one's
+    // memory. Reset by ReleaseThread
+    static thread_local uint64_t t_QueueId;
+    static thread_local ThreadSlot *t_Slot;
+    static thread_local ThreadExitGuard t_ExitGuard;
+
+    ThreadSlot *GetSlot();
+
+    static void ReleaseSlot(ThreadSlot *slot);
+
+    void Push(const Command &command);
+
+    void RenderShapes(const Batch &batch, ImDrawList *drawList, Layer layer);
+
+    uint64_t m_Id;
+    ThreadSlot m_Slots[kMaxThreads];
+    std::atomic<bool> m_FullReported{false};
+};
+
+#endif //ANDROIDIMGUI_DRAWCOMMANDQUEUE_H
@@ -0,0 +1,514 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "DrawDataCapture.h"
+
+static constexpr uint32_t kFileMagic = 0x43444941;  // "AIDC"
+static constexpr uint32_t kFrameMagic = 0x4D415246; // "FRAM"
+static constexpr uint32_t kVersion = 1;
+
+struct CaptureFileHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t VertexSize;
+    uint32_t IndexSize;
+};
+
+struct CaptureFrameHeader {
+    uint32_t Magic;
+    uint32_t ListCount;
+    uint32_t TextureEventCount;
+    uint32_t Flags;
+    float DisplayPos[2];
+    float DisplaySize[2];
+    float FramebufferScale[2];
+    uint64_t Size; // whole frame including this header
+};
+
+enum CaptureTextureEventType : uint32_t {
+    CaptureTexture_Create,
+    CaptureTexture_Update,
+    CaptureTexture_Destroy
+};
+
+// Followed by DataSize bytes of pixels for the rect, rows tightly packed
+struct CaptureTextureEvent {
+    uint32_t Type;
+    int32_t Id;
+    int32_t Format;
+    int32_t Width;
+    int32_t Height;
+    int32_t X, Y, W, H;
+    uint32_t Reserved;
+    uint64_t DataSize;
+};
+
+// Followed by the vertices, the indices and CmdCount CaptureCmd, each section aligned
+struct CaptureListHeader {
+    uint32_t VtxCount;
+    uint32_t IdxCount;
+    uint32_t CmdCount;
+    uint32_t Reserved;
+};
+
+static constexpr uint32_t kFrameAllTextures = 1u << 0; // every live texture is created again in this frame
+
+static constexpr uint32_t kCmdTextureData = 1u << 0; // TexKey is an ImTextureData UniqueID, otherwise a raw TexID
+
+struct CaptureCmd {
+    float ClipRect[4];
+    uint64_t TexKey;
+    uint32_t VtxOffset;
+    uint32_t IdxOffset;
+    uint32_t ElemCount;
+    uint32_t Flags;
+};
+
+static inline size_t AlignUp(size_t value) {
+    return (value + 7) & ~(size_t) 7;
+}
+
+// --- DrawDataRecorder ---
+
+DrawDataRecorder::~DrawDataRecorder() {
+    Close();
+}
+
+bool DrawDataRecorder::Open(const char *path) {
+    Close();
+    m_File = fopen(path, "wb");
+    if (!m_File) {
+        fprintf(stderr, "Failed to open capture file %s\n", path);
+        return false;
+    }
+    CaptureFileHeader header = {kFileMagic, kVersion, sizeof(ImDrawVert), sizeof(ImDrawIdx)};
+    fwrite(&header, sizeof(header), 1, m_File);
+    m_FrameCount = 0;
+    return true;
+}
+
+void DrawDataRecorder::Close() {
+    if (m_File) {
+        fclose(m_File);
+        m_File = nullptr;
+    }
+}
+
+void DrawDataRecorder::Record(const ImDrawData *drawData) {
+    if (!m_File || !drawData)
+        return;
+
+    // The frame is assembled in one reused buffer so its size is known before it hits the file
+    m_Buffer.resize(EncodeFrame(drawData, nullptr));
+    EncodeFrame(drawData, m_Buffer.data());
+    fwrite(m_Buffer.data(), 1, m_Buffer.size(), m_File);
+    m_FrameCount++;
+}
+
+// Writes to Out when it's set, otherwise only counts
+struct FrameWriter {
+    uint8_t *Out;
+    size_t Size = 0;
+
+    void Append(const void *data, size_t size) {
+        if (Out && size)
+            memcpy(Out + Size, data, size);
+        Size += size;
+    }
+
+    void Align() {
+        size_t aligned = AlignUp(Size);
+        if (Out && aligned != Size)
+            memset(Out + Size, 0, aligned - Size);
+        Size = aligned;
+    }
+};
+
+static void AppendTextureCreate(FrameWriter &writer, ImTextureData *tex) {
+    CaptureTextureEvent event = {};
+    event.Type = CaptureTexture_Create;
+    event.Id = tex->UniqueID;
+    event.Format = tex->Format;
+    event.Width = tex->Width;
+    event.Height = tex->Height;
+    event.W = tex->Width;
+    event.H = tex->Height;
+    event.DataSize = (uint64_t) tex->GetSizeInBytes();
+    writer.Append(&event, sizeof(event));
+    writer.Append(tex->GetPixels(), event.DataSize);
+    writer.Align();
+}
+
+size_t DrawDataRecorder::EncodeFrame(const ImDrawData *drawData, uint8_t *out, bool allTextures) {
+    FrameWriter writer = {out};
+    CaptureFrameHeader frame = {};
+    frame.Magic = kFrameMagic;
+    frame.DisplayPos[0] = drawData->DisplayPos.x;
+    frame.DisplayPos[1] = drawData->DisplayPos.y;
+    frame.DisplaySize[0] = drawData->DisplaySize.x;
+    frame.DisplaySize[1] = drawData->DisplaySize.y;
+    frame.FramebufferScale[0] = drawData->FramebufferScale.x;
+    frame.FramebufferScale[1] = drawData->FramebufferScale.y;
+    frame.Flags = allTextures ? kFrameAllTextures : 0;
+    writer.Append(&frame, sizeof(frame));
+
+    // Texture events in the order the backend will process them
+    if (drawData->Textures != nullptr) {
+        for (ImTextureData *tex: *drawData->Textures) {
+            if (tex->Status == ImTextureStatus_WantCreate ||
+                (allTextures && tex->Status != ImTextureStatus_WantDestroy &&
+                 tex->Status != ImTextureStatus_Destroyed && tex->Pixels)) {
+                AppendTextureCreate(writer, tex);
+                frame.TextureEventCount++;
+            } else if (tex->Status == ImTextureStatus_WantUpdates) {
+                CaptureTextureEvent event = {};
+                event.Type = CaptureTexture_Update;
+                event.Id = tex->UniqueID;
+                event.Format = tex->Format;
+                event.Width = tex->Width;
+                event.Height = tex->Height;
+                for (const ImTextureRect &r: tex->Updates) {
+                    event.X = r.x;
+                    event.Y = r.y;
+                    event.W = r.w;
+                    event.H = r.h;
+                    event.DataSize = (uint64_t) r.w * r.h * tex->BytesPerPixel;
+                    writer.Append(&event, sizeof(event));
+                    for (int y = 0; y < r.h; y++)
+                        writer.Append(tex->GetPixelsAt(r.x, r.y + y), (size_t) r.w * tex->BytesPerPixel);
+                    writer.Align();
+                    frame.TextureEventCount++;
+                }
+            } else if (tex->Status == ImTextureStatus_WantDestroy && tex->UnusedFrames > 0) {
+                CaptureTextureEvent event = {};
+                event.Type = CaptureTexture_Destroy;
+                event.Id = tex->UniqueID;
+                writer.Append(&event, sizeof(event));
+                frame.TextureEventCount++;
+            }
+        }
+    }
+
+    for (int n = 0; n < drawData->CmdListsCount; n++) {
+        const ImDrawList *list = drawData->CmdLists[n];
+        CaptureListHeader header = {(uint32_t) list->VtxBuffer.Size, (uint32_t) list->IdxBuffer.Size, 0, 0};
+        for (const ImDrawCmd &cmd: list->CmdBuffer) {
+            if (cmd.UserCallback == nullptr)
+                header.CmdCount++;
+        }
+        writer.Append(&header, sizeof(header));
+        writer.Append(list->VtxBuffer.Data, list->VtxBuffer.size_in_bytes());
+        writer.Align();
+        writer.Append(list->IdxBuffer.Data, list->IdxBuffer.size_in_bytes());
+        writer.Align();
+        for (const ImDrawCmd &cmd: list->CmdBuffer) {
+            if (cmd.UserCallback != nullptr)
+                continue;
+            CaptureCmd captured = {};
+            captured.ClipRect[0] = cmd.ClipRect.x;
+            captured.ClipRect[1] = cmd.ClipRect.y;
+            captured.ClipRect[2] = cmd.ClipRect.z;
+            captured.ClipRect[3] = cmd.ClipRect.w;
+            if (cmd.TexRef._TexData != nullptr) {
+                captured.TexKey = (uint64_t) cmd.TexRef._TexData->UniqueID;
+                captured.Flags = kCmdTextureData;
+            } else {
+                captured.TexKey = (uint64_t) cmd.TexRef._TexID;
+            }
+            captured.VtxOffset = cmd.VtxOffset;
+            captured.IdxOffset = cmd.IdxOffset;
+            captured.ElemCount = cmd.ElemCount;
+            writer.Append(&captured, sizeof(captured));
+        }
+        frame.ListCount++;
+    }
+
+    if (out) {
+        frame.Size = writer.Size;
+        memcpy(out, &frame, sizeof(frame));
+    }
+    return writer.Size;
+}
+
+bool DrawDataRecorder::IsFrame(const void *data, size_t size) {
+    const auto *frame = (const CaptureFrameHeader *) data;
+    return size >= sizeof(CaptureFrameHeader) && frame->Magic == kFrameMagic &&
+           frame->Size >= sizeof(CaptureFrameHeader) && frame->Size <= size;
+}
+
+// --- DrawDataReplay ---
+
+template<typename T>
+static void BorrowVector(ImVector<T> &vector, const void *data, int size) {
+    vector.Data = (T *) data;
+    vector.Size = vector.Capacity = size;
+}
+
+template<typename T>
+static void ForgetVector(ImVector<T> &vector) {
+    vector.Data = nullptr;
+    vector.Size = vector.Capacity = 0;
+}
+
+DrawDataReplay::~DrawDataReplay() {
+    Close();
+}
+
+bool DrawDataReplay::Open(const char *path) {
+    Close();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open capture file %s\n", path);
+        return false;
+    }
+    struct stat st = {};
+    fstat(fd, &st);
+    void *map = st.st_size > 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Failed to map capture file %s\n", path);
+        return false;
+    }
+    m_Data = (const uint8_t *) map;
+    m_Size = st.st_size;
+
+    const auto *header = (const CaptureFileHeader *) m_Data;
+    if (m_Size < sizeof(CaptureFileHeader) || header->Magic != kFileMagic || header->Version != kVersion ||
+        header->VertexSize != sizeof(ImDrawVert) || header->IndexSize != sizeof(ImDrawIdx)) {
+        fprintf(stderr, "%s is not a compatible capture\n", path);
+        Close();
+        return false;
+    }
+
+    // Index the frames; a truncated last frame (capture killed mid-write) is dropped
+    size_t offset = AlignUp(sizeof(CaptureFileHeader));
+    while (offset + sizeof(CaptureFrameHeader) <= m_Size) {
+        const auto *frame = (const CaptureFrameHeader *) (m_Data + offset);
+        if (!DrawDataRecorder::IsFrame(frame, m_Size - offset))
+            break;
+        m_Frames.push_back(offset);
+        offset += frame->Size;
+    }
+    m_NextFrame = 0;
+    return true;
+}
+
+void DrawDataReplay::Close() {
+    ReleaseLists();
+    for (ImDrawList *list: m_Lists)
+        IM_DELETE(list);
+    m_Lists.clear();
+    for (auto &it: m_Textures)
+        IM_DELETE(it.second);
+    m_Textures.clear();
+    for (ImTextureData *tex: m_Retired)
+        IM_DELETE(tex);
+    m_Retired.clear();
+    m_TextureList.clear();
+    m_Frames.clear();
+    if (m_Data) {
+        munmap((void *) m_Data, m_Size);
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+}
+
+void DrawDataReplay::ReleaseLists() {
+    for (ImDrawList *list: m_Lists) {
+        ForgetVector(list->VtxBuffer);
+        ForgetVector(list->IdxBuffer);
+    }
+}
+
+ImTextureData *DrawDataReplay::RetireTexture(int id) {
+    auto it = m_Textures.find(id);
+    if (it == m_Textures.end())
+        return nullptr;
+    ImTextureData *tex = it->second;
+    m_Textures.erase(it);
+    if (tex->Status == ImTextureStatus_WantCreate) {
+        // Never reached the backend
+        IM_DELETE(tex);
+        return nullptr;
+    }
+    tex->WantDestroyNextFrame = true;
+    tex->Status = ImTextureStatus_WantDestroy;
+    tex->UnusedFrames = 1;
+    m_Retired.push_back(tex);
+    return tex;
+}
+
+void DrawDataReplay::ApplyTextureEvents(const uint8_t *&cursor, uint32_t count) {
+    // Rects the backend already uploaded; those of skipped frames stay pending
+    for (auto &it: m_Textures) {
+        if (it.second->Status == ImTextureStatus_OK)
+            it.second->Updates.resize(0);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const auto *event = (const CaptureTextureEvent *) cursor;
+        const uint8_t *pixels = cursor + sizeof(CaptureTextureEvent);
+        cursor = pixels + AlignUp(event->DataSize);
+
+        if (event->Type == CaptureTexture_Destroy) {
+            RetireTexture(event->Id);
+            continue;
+        }
+
+        ImTextureData *tex;
+        if (event->Type == CaptureTexture_Create) {
+            // Also reached when the replay wraps around while the first frame's textures are still alive
+            RetireTexture(event->Id);
+            tex = IM_NEW(ImTextureData)();
+            tex->Create((ImTextureFormat) event->Format, event->Width, event->Height);
+            tex->UniqueID = event->Id;
+            m_Textures[event->Id] = tex;
+            memcpy(tex->GetPixels(), pixels, event->DataSize);
+            continue;
+        }
+
+        auto it = m_Textures.find(event->Id);
+        if (it == m_Textures.end())
+            continue;
+        tex = it->second;
+        const size_t rowSize = (size_t) event->W * tex->BytesPerPixel;
+        for (int y = 0; y < event->H; y++)
+            memcpy(tex->GetPixelsAt(event->X, event->Y + y), pixels + y * rowSize, rowSize);
+        if (tex->Status == ImTextureStatus_WantCreate)
+            continue; // uploaded whole anyway
+        ImTextureRect rect = {(unsigned short) event->X, (unsigned short) event->Y,
+                              (unsigned short) event->W, (unsigned short) event->H};
+        tex->Updates.push_back(rect);
+        // Bounds of the pending rects, kept like ImFontAtlas does: imgui_impl_vulkan uploads only this one
+        if (tex->Updates.Size == 1) {
+            tex->UpdateRect = rect;
+        } else {
+            ImTextureRect &bounds = tex->UpdateRect;
+            int x1 = std::max(bounds.x + bounds.w, rect.x + rect.w);
+            int y1 = std::max(bounds.y + bounds.h, rect.y + rect.h);
+            bounds.x = std::min(bounds.x, rect.x);
+            bounds.y = std::min(bounds.y, rect.y);
+            bounds.w = (unsigned short) (x1 - bounds.x);
+            bounds.h = (unsigned short) (y1 - bounds.y);
+        }
+        tex->Status = ImTextureStatus_WantUpdates;
+    }
+}
+
+void DrawDataReplay::BuildTextureList() {
+    m_TextureList.resize(0);
+    for (auto &it: m_Textures)
+        m_TextureList.push_back(it.second);
+    for (ImTextureData *tex: m_Retired)
+        m_TextureList.push_back(tex);
+}
+
+ImDrawData *DrawDataReplay::NextFrame() {
+    if (m_Frames.empty())
+        return nullptr;
+    if (m_NextFrame >= (int) m_Frames.size())
+        m_NextFrame = 0;
+    return DecodeFrame(m_Data + m_Frames[m_NextFrame++]);
+}
+
+void DrawDataReplay::ApplyFrameTextures(const CaptureFrameHeader *frame, const uint8_t *&cursor) {
+    // Textures the writer stopped telling us about, e.g. destroyed in a frame it had to drop
+    if (frame->Flags & kFrameAllTextures) {
+        std::vector<int> ids;
+        for (auto &it: m_Textures)
+            ids.push_back(it.first);
+        for (int id: ids)
+            RetireTexture(id);
+    }
+    ApplyTextureEvents(cursor, frame->TextureEventCount);
+}
+
+void DrawDataReplay::SkipFrame(const void *data) {
+    const auto *frame = (const CaptureFrameHeader *) data;
+    const uint8_t *cursor = (const uint8_t *) data + sizeof(CaptureFrameHeader);
+    ApplyFrameTextures(frame, cursor);
+}
+
+ImDrawData *DrawDataReplay::DecodeFrame(const void *data) {
+    const auto *frame = (const CaptureFrameHeader *) data;
+    const uint8_t *cursor = (const uint8_t *) data + sizeof(CaptureFrameHeader);
+    ApplyFrameTextures(frame, cursor);
+    BuildTextureList();
+
+    ReleaseLists();
+    while (m_Lists.size() < frame->ListCount)
+        m_Lists.push_back(IM_NEW(ImDrawList)(nullptr));
+
+    m_DrawData.Clear();
+    m_DrawData.Valid = true;
+    m_DrawData.DisplayPos = ImVec2(frame->DisplayPos[0], frame->DisplayPos[1]);
+    m_DrawData.DisplaySize = ImVec2(frame->DisplaySize[0], frame->DisplaySize[1]);
+    m_DrawData.FramebufferScale = ImVec2(frame->FramebufferScale[0], frame->FramebufferScale[1]);
+    m_DrawData.Textures = &m_TextureList;
+
+    for (uint32_t n = 0; n < frame->ListCount; n++) {
+        const auto *header = (const CaptureListHeader *) cursor;
+        cursor += sizeof(CaptureListHeader);
+        ImDrawList *list = m_Lists[n];
+
+        // Geometry is used in place from the mapping
+        BorrowVector(list->VtxBuffer, cursor, (int) header->VtxCount);
+        cursor += AlignUp(header->VtxCount * sizeof(ImDrawVert));
+        BorrowVector(list->IdxBuffer, cursor, (int) header->IdxCount);
+        cursor += AlignUp(header->IdxCount * sizeof(ImDrawIdx));
+
+        list->CmdBuffer.resize((int) header->CmdCount);
+        const auto *cmds = (const CaptureCmd *) cursor;
+        cursor += header->CmdCount * sizeof(CaptureCmd);
+        for (uint32_t i = 0; i < header->CmdCount; i++) {
+            ImDrawCmd &cmd = list->CmdBuffer[(int) i];
+            cmd = ImDrawCmd();
+            cmd.ClipRect = ImVec4(cmds[i].ClipRect[0], cmds[i].ClipRect[1], cmds[i].ClipRect[2], cmds[i].ClipRect[3]);
+            if (cmds[i].Flags & kCmdTextureData) {
+                auto it = m_Textures.find((int) cmds[i].TexKey);
+                cmd.TexRef._TexData = it != m_Textures.end() ? it->second : nullptr;
+            }
+            cmd.VtxOffset = cmds[i].VtxOffset;
+            cmd.IdxOffset = cmds[i].IdxOffset;
+            cmd.ElemCount = cmds[i].ElemCount;
+        }
+
+        m_DrawData.CmdLists.push_back(list);
+        m_DrawData.TotalVtxCount += (int) header->VtxCount;
+        m_DrawData.TotalIdxCount += (int) header->IdxCount;
+    }
+    m_DrawData.CmdListsCount = m_DrawData.CmdLists.Size;
+    return &m_DrawData;
+}
+
+void DrawDataReplay::FrameRendered() {
+    for (size_t i = 0; i < m_Retired.size();) {
+        if (m_Retired[i]->Status == ImTextureStatus_Destroyed) {
+            IM_DELETE(m_Retired[i]);
+            m_Retired.erase(m_Retired.begin() + (long) i);
+        } else {
+            i++;
+        }
+    }
+}
+
+ImDrawData *DrawDataReplay::ShutdownFrame() {
+    std::vector<int> ids;
+    for (auto &it: m_Textures)
+        ids.push_back(it.first);
+    for (int id: ids)
+        RetireTexture(id);
+    BuildTextureList();
+
+    ReleaseLists();
+    ImVec2 displaySize = m_DrawData.DisplaySize;
+    ImVec2 framebufferScale = m_DrawData.FramebufferScale;
+    m_DrawData.Clear();
+    m_DrawData.Valid = true;
+    m_DrawData.DisplaySize = displaySize;
+    m_DrawData.FramebufferScale = framebufferScale;
+    m_DrawData.Textures = &m_TextureList;
+    return &m_DrawData;
+}
@@ -0,0 +1,89 @@
+#ifndef ANDROIDIMGUI_DRAWDATACAPTURE_H
+#define ANDROIDIMGUI_DRAWDATACAPTURE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+#include "imgui.h"
+
+struct CaptureFrameHeader;
+
+// Binary capture of a stream of ImDrawData frames: vertices, indices, commands, clip rects, texture references and
+// texture create/update/destroy events. Sections are 8-byte aligned so a replay can borrow vertex and index buffers
+// straight from the mapped file. Draw callbacks are not captured; textures not owned by ImGui (LoadTexture*,
+// render targets) replay as ImTextureID_Invalid.
+class DrawDataRecorder {
+public:
+    ~DrawDataRecorder();
+
+    bool Open(const char *path);
+
+    void Record(const ImDrawData *drawData);
+
+    void Close();
+
+    int GetFrameCount() const { return m_FrameCount; }
+
+    // Serializes one frame into out and returns its size; with out == nullptr only the size is computed.
+    // allTextures sends every live texture as created, for a reader that missed earlier frames.
+    static size_t EncodeFrame(const ImDrawData *drawData, uint8_t *out, bool allTextures = false);
+
+    static bool IsFrame(const void *data, size_t size);
+
+private:
+    FILE *m_File = nullptr;
+    int m_FrameCount = 0;
+    std::vector<uint8_t> m_Buffer;
+};
+
+class DrawDataReplay {
+public:
+    ~DrawDataReplay();
+
+    bool Open(const char *path);
+
+    void Close();
+
+    int GetFrameCount() const { return (int) m_Frames.size(); }
+
+    // Frames come out in capture order and wrap around after the last one. The result stays valid until the next call.
+    ImDrawData *NextFrame();
+
+    // Call once the backend has rendered the frame returned by NextFrame
+    void FrameRendered();
+
+    // A frame encoded with DrawDataRecorder::EncodeFrame; its geometry is borrowed, so the data must stay valid
+    // until the next DecodeFrame/NextFrame
+    ImDrawData *DecodeFrame(const void *frame);
+
+    // Applies only the texture events of a frame that won't be rendered
+    void SkipFrame(const void *frame);
+
+    // Empty frame asking the backend to release every replayed texture; render it, then call FrameRendered
+    ImDrawData *ShutdownFrame();
+
+private:
+    void ApplyFrameTextures(const CaptureFrameHeader *frame, const uint8_t *&cursor);
+
+    void ApplyTextureEvents(const uint8_t *&cursor, uint32_t count);
+
+    ImTextureData *RetireTexture(int id);
+
+    void BuildTextureList();
+
+    void ReleaseLists();
+
+    const uint8_t *m_Data = nullptr;
+    size_t m_Size = 0;
+    std::vector<size_t> m_Frames;
+    int m_NextFrame = 0;
+
+    ImDrawData m_DrawData;
+    std::vector<ImDrawList *> m_Lists;
+    std::unordered_map<int, ImTextureData *> m_Textures;
+    std::vector<ImTextureData *> m_Retired;
+    ImVector<ImTextureData *> m_TextureList;
+};
+
+#endif //ANDROIDIMGUI_DRAWDATACAPTURE_H
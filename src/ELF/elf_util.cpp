@@ -18,6 +18,7 @@
  * Copyright (C) 2021 LSPosed Contributors
  */
 #include <malloc.h>
+#include <algorithm>
 #include <cstring>
 #include <sys/mman.h>
 #include <fcntl.h>
@@ -218,6 +219,53 @@ ElfImg::getSymbOffset(std::string_view name, uint32_t gnu_hash, uint32_t elf_has
 
 }
 
+void ElfImg::buildSortedSymbols() const {
+    sorted_ready_ = true;
+    if (!header)
+        return;
+    // base maps the segment at file offset 0, whose vaddr is 0 unless the file isn't position independent
+    auto *program_header = offsetOf<ElfW(Phdr) *>(header, header->e_phoff);
+    for (int i = 0; i < header->e_phnum; i++) {
+        if (program_header[i].p_type == PT_LOAD && program_header[i].p_offset == 0) {
+            load_vaddr_ = program_header[i].p_vaddr;
+            break;
+        }
+    }
+    auto add = [this](ElfW(Sym) *symbols, ElfW(Off) count, ElfW(Off) strings) {
+        for (ElfW(Off) i = 0; i < count; i++) {
+            if (ELF_ST_TYPE(symbols[i].st_info) != STT_FUNC || symbols[i].st_value == 0 || symbols[i].st_size == 0)
+                continue;
+            sorted_symbs_.push_back({symbols[i].st_value, symbols[i].st_size,
+                                     offsetOf<const char *>(header, strings + symbols[i].st_name)});
+        }
+    };
+    if (symtab_start && symstr_offset_for_symtab)
+        add(symtab_start, symtab_count, symstr_offset_for_symtab);
+    if (dynsym_start && dynsym->sh_entsize)
+        add(dynsym_start, dynsym->sh_size / dynsym->sh_entsize, symstr_offset);
+    std::sort(sorted_symbs_.begin(), sorted_symbs_.end(), [](const SymbRange &a, const SymbRange &b) {
+        return a.value < b.value;
+    });
+}
+
+std::string_view ElfImg::getSymbName(ElfW(Addr) address, ElfW(Addr) *symb_address) const {
+    if (!sorted_ready_)
+        buildSortedSymbols();
+    if (!base || sorted_symbs_.empty() || address < (ElfW(Addr)) base)
+        return {};
+    ElfW(Addr) vaddr = address - (ElfW(Addr)) base + load_vaddr_;
+    auto next = std::upper_bound(sorted_symbs_.begin(), sorted_symbs_.end(), vaddr,
+                                 [](ElfW(Addr) value, const SymbRange &symb) { return value < symb.value; });
+    if (next == sorted_symbs_.begin())
+        return {};
+    const SymbRange &symb = *(next - 1);
+    if (vaddr >= symb.value + symb.size)
+        return {};
+    if (symb_address)
+        *symb_address = (ElfW(Addr)) base + symb.value - load_vaddr_;
+    return symb.name;
+}
+
 bool ElfImg::findModuleBase() {
     char buff[256];
     off_t load_addr;
@@ -24,23 +24,40 @@
 
 #include <string_view>
 #include <unordered_map>
+#include <vector>
+#ifdef __ANDROID__
 #include <linux/elf.h>
+#else
+// glibc's link.h brings elf.h, which clashes with the kernel header
+#include <elf.h>
+#endif
 #include <sys/types.h>
 #include <link.h>
 #include <string>
 
 #define SHT_GNU_HASH 0x6ffffff6
 
+#ifndef ELF_ST_TYPE
+#define ELF_ST_TYPE(info) ((info) & 0xf)
+#endif
+
+// GCC before C++23 rejects a constexpr function that can only call the out-of-line lookup, clang accepts it
+#ifdef __clang__
+#define ELFIMG_CONSTEXPR constexpr
+#else
+#define ELFIMG_CONSTEXPR
+#endif
+
 class ElfImg {
 public:
 
     ElfImg(std::string_view elf);
 
-    constexpr ElfW(Addr) getSymbOffset(std::string_view name) const {
+    ELFIMG_CONSTEXPR ElfW(Addr) getSymbOffset(std::string_view name) const {
         return getSymbOffset(name, GnuHash(name), ElfHash(name));
     }
 
-    constexpr ElfW(Addr) getSymbAddress(std::string_view name) const {
+    ELFIMG_CONSTEXPR ElfW(Addr) getSymbAddress(std::string_view name) const {
         ElfW(Addr) offset = getSymbOffset(name);
         if (offset > 0 && base != nullptr) {
             return static_cast<ElfW(Addr)>((uintptr_t) base + offset - bias);
@@ -63,6 +80,9 @@ public:
         return elf;
     }
 
+    // Function containing a loaded address, from .symtab and .dynsym; empty when none does. Not thread-safe
+    std::string_view getSymbName(ElfW(Addr) address, ElfW(Addr) *symb_address = nullptr) const;
+
     ~ElfImg();
 
 private:
@@ -80,6 +100,14 @@ private:
 
     bool findModuleBase();
 
+    void buildSortedSymbols() const;
+
+    struct SymbRange {
+        ElfW(Addr) value;
+        ElfW(Xword) size;
+        const char *name;
+    };
+
     std::string elf;
     void *base = nullptr;
     char *buffer = nullptr;
@@ -113,6 +141,10 @@ private:
     uint32_t *gnu_chain_;
 
     mutable std::unordered_map<std::string_view, ElfW(Sym) *> symtabs_;
+
+    mutable std::vector<SymbRange> sorted_symbs_;
+    mutable ElfW(Addr) load_vaddr_ = 0;
+    mutable bool sorted_ready_ = false;
 };
 
 constexpr uint32_t ElfImg::ElfHash(std::string_view name) {
@@ -0,0 +1,53 @@
+#include <algorithm>
+#include "FrameTask.h"
+
+TaskScheduler::~TaskScheduler() {
+    Clear();
+}
+
+void TaskScheduler::Spawn(FrameTask task) {
+    std::coroutine_handle<> handle = std::exchange(task.m_Handle, nullptr);
+    m_Tasks.push_back(handle);
+    Resume(handle);
+}
+
+void TaskScheduler::Offload(std::coroutine_handle<> handle, std::function<void()> work) {
+    if (!m_Pool)
+        m_Pool = std::make_unique<ThreadPool>(m_Threads);
+    m_Pool->Post([this, handle, work = std::move(work)] {
+        work();
+        std::lock_guard<std::mutex> lock(m_CompletedLock);
+        m_Completed.push_back(handle);
+    });
+}
+
+void TaskScheduler::Resume(std::coroutine_handle<> handle) {
+    handle.resume();
+    if (handle.done()) {
+        m_Tasks.erase(std::find(m_Tasks.begin(), m_Tasks.end(), handle));
+        handle.destroy();
+    }
+}
+
+void TaskScheduler::ResumeFrame() {
+    // Tasks awaiting again while resumed wait for the next frame
+    m_Resuming.swap(m_NextFrame);
+    {
+        std::lock_guard<std::mutex> lock(m_CompletedLock);
+        m_Resuming.insert(m_Resuming.end(), m_Completed.begin(), m_Completed.end());
+        m_Completed.clear();
+    }
+    for (std::coroutine_handle<> handle: m_Resuming)
+        Resume(handle);
+    m_Resuming.clear();
+}
+
+void TaskScheduler::Clear() {
+    // Joins the workers after their queue ran dry, nothing refers to the tasks afterwards
+    m_Pool.reset();
+    for (std::coroutine_handle<> handle: m_Tasks)
+        handle.destroy();
+    m_Tasks.clear();
+    m_NextFrame.clear();
+    m_Completed.clear();
+}
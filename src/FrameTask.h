@@ -0,0 +1,139 @@
+#ifndef ANDROIDIMGUI_FRAMETASK_H
+#define ANDROIDIMGUI_FRAMETASK_H
+
+#include <coroutine>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "ThreadPool.h"
+
+class TaskScheduler;
+
+// Coroutine started with TaskScheduler::Spawn; it lives until it returns or the scheduler is cleared. May only
+// co_await what TaskScheduler hands out (NextFrame, Run, AndroidImgui::LoadTextureAsync).
+class FrameTask {
+public:
+    struct promise_type {
+        FrameTask get_return_object() {
+            return FrameTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+
+        void unhandled_exception() { abort(); }
+    };
+
+    FrameTask(FrameTask &&other) noexcept : m_Handle(std::exchange(other.m_Handle, nullptr)) {}
+
+    FrameTask(const FrameTask &) = delete;
+
+    ~FrameTask() {
+        if (m_Handle)
+            m_Handle.destroy();
+    }
+
+private:
+    friend class TaskScheduler;
+
+    explicit FrameTask(std::coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+
+    std::coroutine_handle<promise_type> m_Handle;
+};
+
+// co_await result: work runs on the scheduler's pool, then the coroutine continues in NewFrame with finish()
+template<typename T>
+class Async {
+public:
+    Async(TaskScheduler &scheduler, std::function<void()> work, std::function<T()> finish)
+            : m_Scheduler(scheduler), m_Work(std::move(work)), m_Finish(std::move(finish)) {}
+
+    bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle);
+
+    T await_resume() { return m_Finish(); }
+
+private:
+    TaskScheduler &m_Scheduler;
+    std::function<void()> m_Work;
+    std::function<T()> m_Finish;
+};
+
+// Runs FrameTasks on the UI thread. Suspended tasks continue inside AndroidImgui::NewFrame, right after
+// ImGui::NewFrame, so they may use ImGui and draw into the new frame. Everything but the work passed to Run
+// happens on the UI thread.
+class TaskScheduler {
+public:
+    struct FrameAwaiter {
+        TaskScheduler &Scheduler;
+
+        bool await_ready() const { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) { Scheduler.m_NextFrame.push_back(handle); }
+
+        void await_resume() const {}
+    };
+
+    // 0 = ThreadPool's default, the pool starts with the first Run
+    explicit TaskScheduler(int threads = 0) : m_Threads(threads) {}
+
+    ~TaskScheduler();
+
+    // Runs the task until its first co_await
+    void Spawn(FrameTask task);
+
+    // Continues at the next NewFrame
+    FrameAwaiter NextFrame() { return {*this}; }
+
+    // Evaluates work() on a pool thread and continues at the first NewFrame after it finished, with its result
+    template<typename F>
+    auto Run(F work) -> Async<std::invoke_result_t<F>> {
+        using Result = std::invoke_result_t<F>;
+        if constexpr (std::is_void_v<Result>) {
+            return Async<void>(*this, std::move(work), [] {});
+        } else {
+            auto result = std::make_shared<Result>();
+            return Async<Result>(*this, [result, work = std::move(work)]() mutable { *result = work(); },
+                                 [result] { return std::move(*result); });
+        }
+    }
+
+    // In NewFrame: continues the tasks whose frame came or whose work finished
+    void ResumeFrame();
+
+    // Waits for running work, then destroys every unfinished task
+    void Clear();
+
+    int GetTaskCount() const { return (int) m_Tasks.size(); }
+
+private:
+    template<typename T>
+    friend class Async;
+
+    void Offload(std::coroutine_handle<> handle, std::function<void()> work);
+
+    void Resume(std::coroutine_handle<> handle);
+
+    int m_Threads;
+    std::unique_ptr<ThreadPool> m_Pool;
+    std::vector<std::coroutine_handle<>> m_Tasks;
+    std::vector<std::coroutine_handle<>> m_NextFrame;
+    std::vector<std::coroutine_handle<>> m_Resuming;
+    std::mutex m_CompletedLock;
+    std::vector<std::coroutine_handle<>> m_Completed;
+};
+
+template<typename T>
+void Async<T>::await_suspend(std::coroutine_handle<> handle) {
+    m_Scheduler.Offload(handle, std::move(m_Work));
+}
+
+#endif //ANDROIDIMGUI_FRAMETASK_H
@@ -3,19 +3,60 @@
 //
 
 #include "GraphicsManager.h"
+#ifdef __ANDROID__
 #include "VulkanGraphics.h"
 #include "OpenGLGraphics.h"
+#endif
 #include "SoftwareGraphics.h"
+#include "HeadlessGraphics.h"
+#include "SwitchableGraphics.h"
+#include "BackendProbe.h"
 
+#ifdef __ANDROID__
+static std::string s_AutoSelectCache = "/data/local/tmp/AndroidImgui.backend";
+#else
+static std::string s_AutoSelectCache = "/tmp/AndroidImgui.backend";
+#endif
 
-std::unique_ptr<AndroidImgui> GraphicsManager::getGraphicsInterface(GraphicsAPI api) {
+void GraphicsManager::setAutoSelectCache(const char *path) {
+    s_AutoSelectCache = path;
+}
+
+
+std::unique_ptr<AndroidImgui> GraphicsManager::getGraphicsInterface(GraphicsAPI api, SurfaceProvider surfaceProvider) {
     switch (api) {
+#ifdef __ANDROID__
         case OPENGL:
             return std::make_unique<OpenGLGraphics>();
         case VULKAN:
             return std::make_unique<VulkanGraphics>();
+#else
+        case OPENGL:
+        case VULKAN:
+            return nullptr;
+#endif
         case SOFTWARE:
             return std::make_unique<SoftwareGraphics>();
+        case HEADLESS:
+            return std::make_unique<HeadlessGraphics>();
+        case AUTO: {
+            GraphicsAPI cached;
+            if (BackendProbe::LoadDecision(s_AutoSelectCache.c_str(), cached))
+                return getGraphicsInterface(cached);
+            auto graphics = std::make_unique<SwitchableGraphics>(SOFTWARE);
+            graphics->SetAutoSelect(s_AutoSelectCache.c_str());
+            graphics->SetSurfaceProvider(std::move(surfaceProvider));
+            return graphics;
+        }
     }
     return nullptr;
 }
+
+std::unique_ptr<AndroidImgui> GraphicsManager::getProgressiveGraphicsInterface(GraphicsAPI target,
+                                                                               float systemFontSize,
+                                                                               SurfaceProvider surfaceProvider) {
+    auto graphics = std::make_unique<SwitchableGraphics>(SOFTWARE);
+    graphics->SetStartupTarget(target, systemFontSize);
+    graphics->SetSurfaceProvider(std::move(surfaceProvider));
+    return graphics;
+}
@@ -6,6 +6,7 @@
 #define ANDROIDIMGUI_GRAPHICSMANAGER_H
 
 #include "AndroidImgui.h"
+#include <functional>
 #include <memory>
 
 
@@ -14,10 +15,29 @@ public:
     enum GraphicsAPI {
         OPENGL,
         VULKAN,
-        SOFTWARE
+        SOFTWARE,
+        // SoftwareGraphics into memory only, Init with a null window (HeadlessGraphics)
+        HEADLESS,
+        // The backend measured fastest on this device (BackendProbe), probed on the first run only
+        AUTO
     };
 
-    static std::unique_ptr<AndroidImgui> getGraphicsInterface(GraphicsAPI api);
+    // A freshly created Surface for a SwitchableGraphics leaving SOFTWARE, see SwitchableGraphics::SetSurfaceProvider
+    using SurfaceProvider = std::function<ANativeWindow *()>;
+
+    // surfaceProvider is for AUTO, whose first run starts on SOFTWARE and switches to the GPU backends it measures;
+    // without one on Android only SOFTWARE can be measured and nothing is saved
+    static std::unique_ptr<AndroidImgui> getGraphicsInterface(GraphicsAPI api,
+                                                              SurfaceProvider surfaceProvider = nullptr);
+
+    // Where AUTO keeps its decision, per device fingerprint
+    static void setAutoSelectCache(const char *path);
+
+    // First frames on SOFTWARE while target and the system font (systemFontSize > 0) load in the background,
+    // see SwitchableGraphics::SetStartupTarget. On Android a GPU target needs surfaceProvider to take over
+    static std::unique_ptr<AndroidImgui> getProgressiveGraphicsInterface(GraphicsAPI target,
+                                                                         float systemFontSize = 0.0f,
+                                                                         SurfaceProvider surfaceProvider = nullptr);
 };
 
 
@@ -0,0 +1,94 @@
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+#include <zlib.h>
+#include "HeadlessGraphics.h"
+
+void HeadlessGraphics::DumpFrame(int frame, const std::string &path) {
+    m_Dumps.push_back({frame, path});
+}
+
+void HeadlessGraphics::Render(ImDrawData *drawData) {
+    SoftwareGraphics::Render(drawData);
+
+    for (auto it = m_Dumps.begin(); it != m_Dumps.end();) {
+        if (it->Frame == m_FrameCount) {
+            SaveFramebuffer(it->Path);
+            it = m_Dumps.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_FrameCount++;
+}
+
+bool HeadlessGraphics::SaveFramebuffer(const std::string &path) const {
+    bool png = path.size() >= 4 && strcasecmp(path.c_str() + path.size() - 4, ".png") == 0;
+    bool ok = png ? WritePNG(path) : WritePPM(path);
+    if (!ok)
+        fprintf(stderr, "Failed to write frame to %s\n", path.c_str());
+    return ok;
+}
+
+bool HeadlessGraphics::WritePPM(const std::string &path) const {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    fprintf(file, "P6\n%d %d\n255\n", m_FbWidth, m_FbHeight);
+    std::vector<uint8_t> row(m_FbWidth * 3);
+    for (int y = 0; y < m_FbHeight; y++) {
+        const uint32_t *src = m_Framebuffer.data() + y * m_FbWidth;
+        for (int x = 0; x < m_FbWidth; x++) {
+            row[x * 3 + 0] = src[x] & 0xFF;
+            row[x * 3 + 1] = (src[x] >> 8) & 0xFF;
+            row[x * 3 + 2] = (src[x] >> 16) & 0xFF;
+        }
+        fwrite(row.data(), 1, row.size(), file);
+    }
+    return fclose(file) == 0;
+}
+
+static void PutBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static void WriteChunk(FILE *file, const char *type, const uint8_t *data, size_t size) {
+    std::vector<uint8_t> chunk;
+    PutBigEndian(chunk, (uint32_t) size);
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data, data + size);
+    uLong crc = crc32(0L, chunk.data() + 4, (uInt) (size + 4));
+    PutBigEndian(chunk, (uint32_t) crc);
+    fwrite(chunk.data(), 1, chunk.size(), file);
+}
+
+bool HeadlessGraphics::WritePNG(const std::string &path) const {
+    // RGBA8, filter type 0 on every row
+    std::vector<uint8_t> raw((size_t) (m_FbWidth * 4 + 1) * m_FbHeight);
+    for (int y = 0; y < m_FbHeight; y++) {
+        uint8_t *dst = &raw[(size_t) y * (m_FbWidth * 4 + 1)];
+        dst[0] = 0;
+        memcpy(dst + 1, m_Framebuffer.data() + y * m_FbWidth, m_FbWidth * 4);
+    }
+    uLongf compressedSize = compressBound((uLong) raw.size());
+    std::vector<uint8_t> compressed(compressedSize);
+    if (compress2(compressed.data(), &compressedSize, raw.data(), (uLong) raw.size(), Z_BEST_SPEED) != Z_OK)
+        return false;
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(kSignature, 1, sizeof(kSignature), file);
+    std::vector<uint8_t> header;
+    PutBigEndian(header, m_FbWidth);
+    PutBigEndian(header, m_FbHeight);
+    header.insert(header.end(), {8, 6, 0, 0, 0}); // 8 bit, RGBA, deflate, no filter, no interlace
+    WriteChunk(file, "IHDR", header.data(), header.size());
+    WriteChunk(file, "IDAT", compressed.data(), compressedSize);
+    WriteChunk(file, "IEND", nullptr, 0);
+    return fclose(file) == 0;
+}
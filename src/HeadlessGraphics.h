@@ -0,0 +1,40 @@
+#ifndef ANDROIDIMGUI_HEADLESSGRAPHICS_H
+#define ANDROIDIMGUI_HEADLESSGRAPHICS_H
+
+#include <string>
+#include <vector>
+#include "SoftwareGraphics.h"
+
+// Software rasterizer into an in-memory framebuffer, no window or GPU needed. Init with a null window.
+class HeadlessGraphics : public SoftwareGraphics {
+public:
+    // Writes the framebuffer after frame `frame` (0 = first EndFrame) to path, ".png" for PNG, otherwise PPM
+    void DumpFrame(int frame, const std::string &path);
+
+    bool SaveFramebuffer(const std::string &path) const;
+
+    const uint32_t *GetPixels() const { return m_Framebuffer.data(); }
+
+    int GetFbWidth() const { return m_FbWidth; }
+
+    int GetFbHeight() const { return m_FbHeight; }
+
+    int GetFrameCount() const { return m_FrameCount; }
+
+private:
+    struct PendingDump {
+        int Frame;
+        std::string Path;
+    };
+
+    void Render(ImDrawData *drawData) override;
+
+    bool WritePPM(const std::string &path) const;
+
+    bool WritePNG(const std::string &path) const;
+
+    int m_FrameCount = 0;
+    std::vector<PendingDump> m_Dumps;
+};
+
+#endif //ANDROIDIMGUI_HEADLESSGRAPHICS_H
@@ -0,0 +1,208 @@
+#include <cstdlib>
+#include <cstring>
+#include "MemoryAllocator.h"
+
+static HeapAllocator s_DefaultAllocator;
+static MemoryAllocator *s_Installed = nullptr;
+
+void *MemoryAllocator::Allocate(size_t size, Category category) {
+    if (size > UINT32_MAX - sizeof(Header))
+        return nullptr;
+    auto *header = (Header *) AllocateBlock(size + sizeof(Header));
+    if (!header)
+        return nullptr;
+    header->Owner = this;
+    header->Size = (uint32_t) size;
+    header->Category = category;
+    Account(category, size, true);
+    return header + 1;
+}
+
+void MemoryAllocator::Release(void *ptr) {
+    if (!ptr)
+        return;
+    Header *header = (Header *) ptr - 1;
+    MemoryAllocator *owner = header->Owner;
+    owner->Account((Category) header->Category, header->Size, false);
+    owner->FreeBlock(header, header->Size + sizeof(Header));
+}
+
+void MemoryAllocator::Account(Category category, size_t size, bool allocate) {
+    std::lock_guard<std::mutex> lock(m_StatsLock);
+    CategoryStats &stats = m_Stats[category];
+    if (allocate) {
+        stats.Bytes += size;
+        stats.PeakBytes = stats.Bytes > stats.PeakBytes ? stats.Bytes : stats.PeakBytes;
+        stats.Allocations++;
+        m_AllocationCount++;
+    } else {
+        stats.Bytes -= size < stats.Bytes ? size : stats.Bytes;
+        stats.Frees++;
+    }
+}
+
+MemoryAllocator::CategoryStats MemoryAllocator::GetStats(Category category) {
+    std::lock_guard<std::mutex> lock(m_StatsLock);
+    return m_Stats[category];
+}
+
+uint64_t MemoryAllocator::GetAllocationCount() {
+    std::lock_guard<std::mutex> lock(m_StatsLock);
+    return m_AllocationCount;
+}
+
+void MemoryAllocator::Install(MemoryAllocator *allocator) {
+    s_Installed = allocator;
+}
+
+MemoryAllocator &MemoryAllocator::Get() {
+    return s_Installed ? *s_Installed : s_DefaultAllocator;
+}
+
+MemoryAllocator *MemoryAllocator::GetInstalled() {
+    return s_Installed;
+}
+
+void MemoryAllocator::CountHeapAllocation(size_t size, bool allocate) {
+    s_DefaultAllocator.Account(IMGUI, size, allocate);
+}
+
+void *HeapAllocator::AllocateBlock(size_t size) {
+    return malloc(size);
+}
+
+void HeapAllocator::FreeBlock(void *ptr, size_t size) {
+    free(ptr);
+}
+
+TlsfAllocator::~TlsfAllocator() {
+    for (void *pool: m_Pools)
+        free(pool);
+}
+
+void TlsfAllocator::Mapping(size_t size, int &fl, int &sl) {
+    if (size < ((size_t) 1 << kFlShift)) {
+        fl = 0;
+        sl = (int) (size / (((size_t) 1 << kFlShift) / kSlCount));
+        return;
+    }
+    int msb = 63 - __builtin_clzll(size);
+    sl = (int) (size >> (msb - kSlLog2)) ^ kSlCount;
+    fl = msb - kFlShift + 1;
+}
+
+void TlsfAllocator::InsertFree(Block *block) {
+    int fl, sl;
+    Mapping(SizeOf(block), fl, sl);
+    block->SizeAndFree |= 1;
+    block->PrevFree = nullptr;
+    block->NextFree = m_Free[fl][sl];
+    if (block->NextFree)
+        block->NextFree->PrevFree = block;
+    m_Free[fl][sl] = block;
+    m_FlBitmap |= 1u << fl;
+    m_SlBitmap[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFree(Block *block) {
+    int fl, sl;
+    Mapping(SizeOf(block), fl, sl);
+    if (block->PrevFree)
+        block->PrevFree->NextFree = block->NextFree;
+    else
+        m_Free[fl][sl] = block->NextFree;
+    if (block->NextFree)
+        block->NextFree->PrevFree = block->PrevFree;
+    if (!m_Free[fl][sl]) {
+        m_SlBitmap[fl] &= ~(1u << sl);
+        if (!m_SlBitmap[fl])
+            m_FlBitmap &= ~(1u << fl);
+    }
+    block->SizeAndFree &= ~(size_t) 1;
+}
+
+TlsfAllocator::Block *TlsfAllocator::FindFree(size_t size) {
+    // Rounded up to the next list so every block found there is large enough
+    if (size >= ((size_t) 1 << kFlShift))
+        size += ((size_t) 1 << (63 - __builtin_clzll(size) - kSlLog2)) - 1;
+    int fl, sl;
+    Mapping(size, fl, sl);
+    if (fl >= kFlCount)
+        return nullptr;
+    uint32_t slMap = m_SlBitmap[fl] & (~0u << sl);
+    if (!slMap) {
+        uint32_t flMap = fl + 1 < kFlCount ? m_FlBitmap & (~0u << (fl + 1)) : 0;
+        if (!flMap)
+            return nullptr;
+        fl = __builtin_ctz(flMap);
+        slMap = m_SlBitmap[fl];
+    }
+    return m_Free[fl][__builtin_ctz(slMap)];
+}
+
+bool TlsfAllocator::AddPool() {
+    void *pool = malloc(kPoolSize);
+    if (!pool)
+        return false;
+    m_Pools.push_back(pool);
+
+    // One free block spanning the pool, then a used sentinel of size 0 that stops coalescing
+    auto *block = (Block *) pool;
+    block->PrevPhys = nullptr;
+    block->SizeAndFree = kPoolSize - 2 * kHeader;
+    Block *sentinel = NextPhys(block);
+    sentinel->PrevPhys = block;
+    sentinel->SizeAndFree = 0;
+    InsertFree(block);
+    return true;
+}
+
+void *TlsfAllocator::AllocateBlock(size_t size) {
+    if (size >= kLargeBlock)
+        return malloc(size);
+    size = (size < kMinPayload ? kMinPayload : size + kAlign - 1) & ~(kAlign - 1);
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+    Block *block = FindFree(size);
+    if (!block) {
+        if (!AddPool())
+            return nullptr;
+        block = FindFree(size);
+    }
+    RemoveFree(block);
+
+    // Split off the tail when it can hold another block
+    if (SizeOf(block) >= size + kHeader + kMinPayload) {
+        auto *rest = (Block *) ((char *) block + kHeader + size);
+        rest->PrevPhys = block;
+        rest->SizeAndFree = SizeOf(block) - size - kHeader;
+        NextPhys(rest)->PrevPhys = rest;
+        block->SizeAndFree = size;
+        InsertFree(rest);
+    }
+    return (char *) block + kHeader;
+}
+
+void TlsfAllocator::FreeBlock(void *ptr, size_t size) {
+    if (size >= kLargeBlock) {
+        free(ptr);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+    auto *block = (Block *) ((char *) ptr - kHeader);
+    Block *next = NextPhys(block);
+    if (IsFree(next)) {
+        RemoveFree(next);
+        block->SizeAndFree += kHeader + SizeOf(next);
+        NextPhys(block)->PrevPhys = block;
+    }
+    Block *prev = block->PrevPhys;
+    if (prev && IsFree(prev)) {
+        RemoveFree(prev);
+        prev->SizeAndFree += kHeader + SizeOf(block);
+        NextPhys(prev)->PrevPhys = prev;
+        block = prev;
+    }
+    InsertFree(block);
+}
@@ -0,0 +1,162 @@
+#ifndef ANDROIDIMGUI_MEMORYALLOCATOR_H
+#define ANDROIDIMGUI_MEMORYALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Where ImGui (ImGui::SetAllocatorFunctions, done by AndroidImgui::Init) and the backends' texture objects and
+// pixel buffers get their memory from. One allocator per process, installed before the first Init and kept until
+// after the last Shutdown; every block remembers its allocator, so replacing it later is safe for old blocks.
+class MemoryAllocator {
+public:
+    enum Category {
+        IMGUI,   // everything ImGui and its backends allocate with IM_ALLOC
+        TEXTURE, // BaseTexData objects
+        PIXELS,  // CPU pixel buffers (software textures and framebuffer)
+        CATEGORY_COUNT
+    };
+
+    struct CategoryStats {
+        size_t Bytes = 0;
+        size_t PeakBytes = 0;
+        uint64_t Allocations = 0;
+        uint64_t Frees = 0;
+    };
+
+    virtual ~MemoryAllocator() = default;
+
+    void *Allocate(size_t size, Category category);
+
+    // Returns the block to whichever allocator handed it out
+    static void Release(void *ptr);
+
+    CategoryStats GetStats(Category category);
+
+    uint64_t GetAllocationCount();
+
+    // nullptr goes back to the default heap allocator
+    static void Install(MemoryAllocator *allocator);
+
+    static MemoryAllocator &Get();
+
+    // The allocator set with Install, nullptr while the default is in use
+    static MemoryAllocator *GetInstalled();
+
+    // Counts allocations ImGui makes with malloc while no allocator is installed
+    static void CountHeapAllocation(size_t size, bool allocate);
+
+protected:
+    virtual void *AllocateBlock(size_t size) = 0;
+
+    virtual void FreeBlock(void *ptr, size_t size) = 0;
+
+private:
+    // Padded so the user block after it keeps the alignment malloc guarantees, 32-bit ABIs included
+    struct alignas(alignof(std::max_align_t)) Header {
+        MemoryAllocator *Owner;
+        uint32_t Size;
+        uint32_t Category;
+    };
+    static_assert(sizeof(Header) % alignof(std::max_align_t) == 0);
+
+    void Account(Category category, size_t size, bool allocate);
+
+    std::mutex m_StatsLock;
+    CategoryStats m_Stats[CATEGORY_COUNT];
+    uint64_t m_AllocationCount = 0;
+};
+
+class HeapAllocator : public MemoryAllocator {
+protected:
+    void *AllocateBlock(size_t size) override;
+
+    void FreeBlock(void *ptr, size_t size) override;
+};
+
+// Two-level segregated fit over 1 MiB pools: O(1) allocate/free with immediate coalescing, so steady-state churn
+// neither fragments the general heap nor takes its locks. Blocks of kLargeBlock bytes and more go to the heap.
+// Pools are only returned when the allocator is destroyed.
+class TlsfAllocator : public MemoryAllocator {
+public:
+    ~TlsfAllocator() override;
+
+    size_t GetPoolBytes() const { return m_Pools.size() * kPoolSize; }
+
+protected:
+    void *AllocateBlock(size_t size) override;
+
+    void FreeBlock(void *ptr, size_t size) override;
+
+private:
+    struct Block {
+        Block *PrevPhys;
+        size_t SizeAndFree; // payload bytes, bit 0 set while free
+        // Valid while free, they live in the payload
+        Block *NextFree;
+        Block *PrevFree;
+    };
+
+    static constexpr size_t kHeader = 16;
+    static constexpr size_t kAlign = 16;
+    static constexpr size_t kMinPayload = 16;
+    static constexpr int kSlLog2 = 4;
+    static constexpr int kSlCount = 1 << kSlLog2;
+    static constexpr int kFlShift = kSlLog2 + 4; // sizes below 1 << kFlShift share first level 0
+    static constexpr int kFlCount = 25;
+    static constexpr size_t kPoolSize = 1 << 20;
+    static constexpr size_t kLargeBlock = 256 << 10;
+
+    static size_t SizeOf(const Block *block) { return block->SizeAndFree & ~(size_t) 1; }
+
+    static bool IsFree(const Block *block) { return block->SizeAndFree & 1; }
+
+    static Block *NextPhys(Block *block) { return (Block *) ((char *) block + kHeader + SizeOf(block)); }
+
+    static void Mapping(size_t size, int &fl, int &sl);
+
+    void InsertFree(Block *block);
+
+    void RemoveFree(Block *block);
+
+    Block *FindFree(size_t size);
+
+    bool AddPool();
+
+    std::mutex m_Lock;
+    uint32_t m_FlBitmap = 0;
+    uint32_t m_SlBitmap[kFlCount] = {};
+    Block *m_Free[kFlCount][kSlCount] = {};
+    std::vector<void *> m_Pools;
+};
+
+// std::allocator replacement that draws from MemoryAllocator::Get()
+template<typename T, MemoryAllocator::Category C>
+struct TrackedAllocator {
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = TrackedAllocator<U, C>;
+    };
+
+    TrackedAllocator() = default;
+
+    template<typename U>
+    TrackedAllocator(const TrackedAllocator<U, C> &) {}
+
+    T *allocate(size_t count) { return (T *) MemoryAllocator::Get().Allocate(count * sizeof(T), C); }
+
+    void deallocate(T *ptr, size_t) { MemoryAllocator::Release(ptr); }
+
+    template<typename U>
+    bool operator==(const TrackedAllocator<U, C> &) const { return true; }
+
+    template<typename U>
+    bool operator!=(const TrackedAllocator<U, C> &) const { return false; }
+};
+
+using PixelBuffer = std::vector<uint32_t, TrackedAllocator<uint32_t, MemoryAllocator::PIXELS>>;
+
+#endif //ANDROIDIMGUI_MEMORYALLOCATOR_H
@@ -0,0 +1,30 @@
+#include "MemoryReport.h"
+
+size_t MemoryReport::Total() const {
+    size_t total = 0;
+    for (size_t bytes: Bytes)
+        total += bytes;
+    return total;
+}
+
+const char *MemoryReport::CategoryName(Category category) {
+    switch (category) {
+        case TEXTURE_CPU:
+            return "texture cpu";
+        case TEXTURE_GPU:
+            return "texture gpu";
+        case STAGING:
+            return "staging";
+        case FONT_ATLAS:
+            return "font atlas";
+        case FRAMEBUFFER:
+            return "framebuffer";
+        case DESCRIPTOR_POOL:
+            return "descriptor pool";
+        case GEOMETRY:
+            return "geometry";
+        case CATEGORY_COUNT:
+            break;
+    }
+    return "?";
+}
@@ -0,0 +1,49 @@
+#ifndef ANDROIDIMGUI_MEMORYREPORT_H
+#define ANDROIDIMGUI_MEMORYREPORT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct BaseTexData;
+
+// Bytes one texture or render target holds in each place
+struct TextureMemory {
+    size_t Cpu = 0;
+    size_t Gpu = 0;
+    size_t Staging = 0;
+
+    size_t Total() const { return Cpu + Gpu + Staging; }
+};
+
+struct MemoryReport {
+    enum Category {
+        TEXTURE_CPU,     // pixel copies in process memory
+        TEXTURE_GPU,     // texture images
+        STAGING,         // upload buffers
+        FONT_ATLAS,      // ImGui's atlas pixels plus the backend's copy
+        FRAMEBUFFER,     // window buffers, swapchain images, offscreen targets
+        DESCRIPTOR_POOL,
+        GEOMETRY,        // ImGui draw lists and the backend's vertex/index buffers
+        CATEGORY_COUNT
+    };
+
+    struct Texture {
+        const BaseTexData *Handle;
+        std::string Source; // file path, empty when loaded from memory
+        size_t Bytes;
+    };
+
+    // Buffers a window surface is assumed to have, the BufferQueue doesn't tell
+    static constexpr int kEstimatedWindowBuffers = 3;
+
+    size_t Bytes[CATEGORY_COUNT] = {};
+    // Largest first
+    std::vector<Texture> LargestTextures;
+
+    size_t Total() const;
+
+    static const char *CategoryName(Category category);
+};
+
+#endif //ANDROIDIMGUI_MEMORYREPORT_H
@@ -1,10 +1,75 @@
 #include <GLES3/gl3.h>
+#include <android/log.h>
 #include <android/native_window.h>
+#include <cstring>
+#include <vector>
 #include "OpenGLGraphics.h"
 #include "imgui_impl_opengl3.h"
+#include "AnalyticShapes.h"
 
+#define GL_LOG_TAG "OpenGLGraphics"
+#define GL_LOGE(...) __android_log_print(ANDROID_LOG_ERROR, GL_LOG_TAG, __VA_ARGS__)
 
-bool OpenGLGraphics::Create() {
+static const char *kShapeVertexShader = R"(#version 300 es
+precision highp float;
+layout (location = 0) in vec2 Position;
+layout (location = 1) in vec2 Local;
+layout (location = 2) in vec2 Half;
+layout (location = 3) in vec2 Shape;
+layout (location = 4) in vec4 Color;
+uniform mat4 ProjMtx;
+out vec2 Frag_Local;
+out vec2 Frag_Half;
+out vec2 Frag_Shape;
+out vec4 Frag_Color;
+void main() {
+    Frag_Local = Local;
+    Frag_Half = Half;
+    Frag_Shape = Shape;
+    Frag_Color = Color;
+    gl_Position = ProjMtx * vec4(Position.xy, 0, 1);
+}
+)";
+
+static const char *kShapeFragmentShader = R"(#version 300 es
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float; // the distance runs in local pixels, mediump loses sub-pixel steps on large shapes
+#else
+precision mediump float;
+#endif
+in vec2 Frag_Local;
+in vec2 Frag_Half;
+in vec2 Frag_Shape;
+in vec4 Frag_Color;
+layout (location = 0) out vec4 Out_Color;
+void main() {
+    float radius = Frag_Shape.x;
+    vec2 q = abs(Frag_Local) - Frag_Half + radius;
+    float d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+    if (Frag_Shape.y > 0.0)
+        d = abs(d) - Frag_Shape.y * 0.5;
+    Out_Color = vec4(Frag_Color.rgb, Frag_Color.a * clamp(0.5 - d, 0.0, 1.0));
+}
+)";
+
+static GLuint CompileShader(GLenum type, const char *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint status = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[512];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        GL_LOGE("Analytic shape shader compile failed: %s", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+
+bool OpenGLGraphics::CreateDevice() {
     const EGLint egl_attributes[] = {EGL_BLUE_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_RED_SIZE, 8,
                                      EGL_ALPHA_SIZE, 8, EGL_DEPTH_SIZE, 16,
                                      EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, EGL_SURFACE_TYPE,
@@ -14,16 +79,25 @@ bool OpenGLGraphics::Create() {
     eglInitialize(m_EglDisplay, nullptr, nullptr);
     EGLint num_configs = 0;
     eglChooseConfig(m_EglDisplay, egl_attributes, nullptr, 0, &num_configs);
-    EGLConfig egl_config;
-    eglChooseConfig(m_EglDisplay, egl_attributes, &egl_config, 1, &num_configs);
-    EGLint egl_format;
-    eglGetConfigAttrib(m_EglDisplay, egl_config, EGL_NATIVE_VISUAL_ID, &egl_format);
-    ANativeWindow_setBuffersGeometry(m_Window, 0, 0, egl_format);
+    eglChooseConfig(m_EglDisplay, egl_attributes, &m_EglConfig, 1, &num_configs);
 
     const EGLint egl_context_attributes[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
-    m_EglContext = eglCreateContext(m_EglDisplay, egl_config, EGL_NO_CONTEXT,
+    m_EglContext = eglCreateContext(m_EglDisplay, m_EglConfig, EGL_NO_CONTEXT,
                                     egl_context_attributes);
-    m_EglSurface = eglCreateWindowSurface(m_EglDisplay, egl_config, m_Window, nullptr);
+    return m_EglContext != EGL_NO_CONTEXT;
+}
+
+bool OpenGLGraphics::Create() {
+    if (m_EglContext == EGL_NO_CONTEXT && !CreateDevice())
+        return false;
+
+    EGLint egl_format;
+    eglGetConfigAttrib(m_EglDisplay, m_EglConfig, EGL_NATIVE_VISUAL_ID, &egl_format);
+    ANativeWindow_setBuffersGeometry(m_Window, 0, 0, egl_format);
+
+    m_EglSurface = eglCreateWindowSurface(m_EglDisplay, m_EglConfig, m_Window, nullptr);
+    if (m_EglSurface == EGL_NO_SURFACE)
+        return false;
     eglMakeCurrent(m_EglDisplay, m_EglSurface, m_EglSurface, m_EglContext);
     glClearColor(0.0, 0.0, 0.0, 0.0);
     return true;
@@ -39,18 +113,91 @@ void OpenGLGraphics::PrepareFrame(bool resize) {
 
 void OpenGLGraphics::Render(ImDrawData *drawData) {
     glClear(GL_COLOR_BUFFER_BIT);
+    m_CurrentDrawData = drawData;
     ImGui_ImplOpenGL3_RenderDrawData(drawData);
+    CollectReadbacks(false);
+    if (IsCaptureRequested())
+        StartReadback();
     eglSwapBuffers(m_EglDisplay, m_EglSurface);
 }
 
+void OpenGLGraphics::StartReadback() {
+    // All busy: the request waits for a later frame
+    if (m_ReadbackCount == kMaxReadbacks)
+        return;
+    EGLint width = 0, height = 0;
+    eglQuerySurface(m_EglDisplay, m_EglSurface, EGL_WIDTH, &width);
+    eglQuerySurface(m_EglDisplay, m_EglSurface, EGL_HEIGHT, &height);
+    if (width <= 0 || height <= 0)
+        return;
+
+    Readback &readback = m_Readbacks[(m_ReadbackHead + m_ReadbackCount) % kMaxReadbacks];
+    if (!readback.Buffer)
+        glGenBuffers(1, &readback.Buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer);
+    const auto size = (GLsizeiptr) width * height * 4;
+    if (readback.Size != size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        readback.Size = size;
+    }
+    // Into the buffer, so glReadPixels returns without waiting for the frame to finish
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.Width = width;
+    readback.Height = height;
+    m_ReadbackCount++;
+    BeginCapture();
+}
+
+void OpenGLGraphics::CollectReadbacks(bool wait) {
+    while (m_ReadbackCount > 0) {
+        Readback &readback = m_Readbacks[m_ReadbackHead];
+        GLenum status = glClientWaitSync(readback.Fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                         wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return;
+        glDeleteSync(readback.Fence);
+        readback.Fence = nullptr;
+
+        CapturedImage image;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer);
+        void *pixels = status != GL_WAIT_FAILED ? glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.Size,
+                                                                    GL_MAP_READ_BIT) : nullptr;
+        if (pixels) {
+            image.Width = readback.Width;
+            image.Height = readback.Height;
+            image.Pixels.resize((size_t) readback.Width * readback.Height);
+            memcpy(image.Pixels.data(), pixels, (size_t) readback.Size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        m_ReadbackHead = (m_ReadbackHead + 1) % kMaxReadbacks;
+        m_ReadbackCount--;
+        FinishCapture(std::move(image), true, false);
+    }
+}
+
+void OpenGLGraphics::DestroyReadbacks() {
+    CollectReadbacks(true);
+    for (Readback &readback: m_Readbacks) {
+        if (readback.Buffer)
+            glDeleteBuffers(1, &readback.Buffer);
+        readback = Readback();
+    }
+}
+
 void OpenGLGraphics::PrepareShutdown() {
+    DestroyReadbacks();
+    DestroyShapeObjects();
     ImGui_ImplOpenGL3_Shutdown();
 }
 
 void OpenGLGraphics::Cleanup() {
     eglMakeCurrent(m_EglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     eglDestroyContext(m_EglDisplay, m_EglContext);
-    eglDestroySurface(m_EglDisplay, m_EglSurface);
+    if (m_EglSurface != EGL_NO_SURFACE)
+        eglDestroySurface(m_EglDisplay, m_EglSurface);
     eglTerminate(m_EglDisplay);
     m_EglDisplay = EGL_NO_DISPLAY;
     m_EglSurface = EGL_NO_SURFACE;
@@ -76,9 +223,227 @@ BaseTexData *OpenGLGraphics::LoadTexture(BaseTexData *tex, void *pixel_data) {
     return tex_data;
 }
 
+bool OpenGLGraphics::UpdateTexture(BaseTexData *tex_data, const void *pixel_data, int x, int y, int width,
+                                   int height) {
+    glBindTexture(GL_TEXTURE_2D, (GLuint) (intptr_t) tex_data->DS);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, tex_data->Width);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                    (const unsigned char *) pixel_data + ((size_t) y * tex_data->Width + x) * 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    return true;
+}
+
 void OpenGLGraphics::RemoveTexture(BaseTexData *tex) {
     auto tex_data = (OpenglTextureData *) tex;
     auto textureId = (GLuint) (intptr_t) tex_data->DS;
     glDeleteTextures(1, &textureId);
     delete tex_data;
 }
+
+
+BaseTexData *OpenGLGraphics::CreateRenderTarget(int width, int height) {
+    BaseTexData tex{};
+    tex.Width = width;
+    tex.Height = height;
+    tex.Channels = 4;
+    auto tex_data = (OpenglTextureData *) LoadTexture(&tex, nullptr);
+    // FBO rows start at the bottom
+    tex_data->V0 = 1.0f;
+    tex_data->V1 = 0.0f;
+
+    GLint last_framebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &last_framebuffer);
+    glGenFramebuffers(1, &tex_data->Framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, tex_data->Framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           (GLuint) (intptr_t) tex_data->DS, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, last_framebuffer);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        RemoveRenderTarget(tex_data);
+        return nullptr;
+    }
+    return tex_data;
+}
+
+bool OpenGLGraphics::RenderToTarget(BaseTexData *target, ImDrawData *drawData) {
+    auto tex_data = (OpenglTextureData *) target;
+    GLint last_framebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &last_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, tex_data->Framebuffer);
+    glViewport(0, 0, tex_data->Width, tex_data->Height);
+    glClear(GL_COLOR_BUFFER_BIT);
+    ImDrawData *last_draw_data = m_CurrentDrawData;
+    m_CurrentDrawData = drawData;
+    ImGui_ImplOpenGL3_RenderDrawData(drawData);
+    m_CurrentDrawData = last_draw_data;
+    glBindFramebuffer(GL_FRAMEBUFFER, last_framebuffer);
+    return true;
+}
+
+void OpenGLGraphics::RemoveRenderTarget(BaseTexData *target) {
+    auto tex_data = (OpenglTextureData *) target;
+    glDeleteFramebuffers(1, &tex_data->Framebuffer);
+    RemoveTexture(tex_data);
+}
+
+void OpenGLGraphics::WaitIdle() {
+    glFinish();
+}
+
+TextureMemory OpenGLGraphics::GetTextureMemory(BaseTexData *tex_data) {
+    TextureMemory memory;
+    memory.Gpu = (size_t) tex_data->Width * tex_data->Height * 4;
+    return memory;
+}
+
+// Texture storage is the only copy on GL, only the lazily created shape objects and readback buffers can go
+void OpenGLGraphics::TrimMemory(TrimLevel level, const std::vector<BaseTexData *> &textures) {
+    if (level == TRIM_COMPLETE) {
+        DestroyShapeObjects();
+        DestroyReadbacks();
+    }
+}
+
+void OpenGLGraphics::ReportMemory(MemoryReport &report) {
+    report.Bytes[MemoryReport::FRAMEBUFFER] +=
+            (size_t) MemoryReport::kEstimatedWindowBuffers * (size_t) m_Width * (size_t) m_Height * 4;
+    // ImGui_ImplOpenGL3 streams each frame's geometry through one VBO/IBO pair sized to fit it
+    if (ImDrawData *drawData = ImGui::GetDrawData())
+        report.Bytes[MemoryReport::GEOMETRY] += (size_t) drawData->TotalVtxCount * sizeof(ImDrawVert) +
+                                                (size_t) drawData->TotalIdxCount * sizeof(ImDrawIdx);
+    report.Bytes[MemoryReport::GEOMETRY] +=
+            (size_t) m_ShapeIndexCapacity * (4 * sizeof(ShapeVertex) + 6 * sizeof(GLuint));
+    for (const Readback &readback: m_Readbacks)
+        report.Bytes[MemoryReport::STAGING] += (size_t) readback.Size;
+}
+
+bool OpenGLGraphics::CreateShapeObjects() {
+    GLuint vert = CompileShader(GL_VERTEX_SHADER, kShapeVertexShader);
+    GLuint frag = CompileShader(GL_FRAGMENT_SHADER, kShapeFragmentShader);
+    if (vert == 0 || frag == 0) {
+        glDeleteShader(vert);
+        glDeleteShader(frag);
+        return false;
+    }
+    m_ShapeProgram = glCreateProgram();
+    glAttachShader(m_ShapeProgram, vert);
+    glAttachShader(m_ShapeProgram, frag);
+    glLinkProgram(m_ShapeProgram);
+    glDeleteShader(vert);
+    glDeleteShader(frag);
+    GLint status = 0;
+    glGetProgramiv(m_ShapeProgram, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[512];
+        glGetProgramInfoLog(m_ShapeProgram, sizeof(log), nullptr, log);
+        GL_LOGE("Analytic shape program link failed: %s", log);
+        glDeleteProgram(m_ShapeProgram);
+        m_ShapeProgram = 0;
+        return false;
+    }
+    m_ShapeProjLoc = glGetUniformLocation(m_ShapeProgram, "ProjMtx");
+
+    glGenVertexArrays(1, &m_ShapeVao);
+    glGenBuffers(1, &m_ShapeVbo);
+    glGenBuffers(1, &m_ShapeEbo);
+    glBindVertexArray(m_ShapeVao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_ShapeVbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ShapeEbo);
+    const GLsizei stride = sizeof(ShapeVertex);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void *) offsetof(ShapeVertex, X));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void *) offsetof(ShapeVertex, LocalX));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void *) offsetof(ShapeVertex, HalfWidth));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (void *) offsetof(ShapeVertex, Radius));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void *) offsetof(ShapeVertex, Col));
+    glBindVertexArray(0);
+    m_ShapeIndexCapacity = 0;
+    m_ShapeGeneration = 0;
+    return true;
+}
+
+void OpenGLGraphics::DestroyShapeObjects() {
+    if (m_ShapeProgram == 0)
+        return;
+    glDeleteProgram(m_ShapeProgram);
+    glDeleteVertexArrays(1, &m_ShapeVao);
+    glDeleteBuffers(1, &m_ShapeVbo);
+    glDeleteBuffers(1, &m_ShapeEbo);
+    m_ShapeProgram = 0;
+    m_ShapeVao = m_ShapeVbo = m_ShapeEbo = 0;
+    m_ShapeIndexCapacity = 0;
+    m_ShapeGeneration = 0;
+}
+
+// ImGui_ImplOpenGL3_SetupRenderState sets its own blending again on the reset callback
+void OpenGLGraphics::BlendPremultiplied() {
+    glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void OpenGLGraphics::RenderShapes(const ShapeFrame &frame, int firstShape, int shapeCount, const ImVec4 &clipRect) {
+    ImDrawData *drawData = m_CurrentDrawData;
+    if (!drawData || !m_Shapes->IsSupported())
+        return;
+    // Shapes from here on are drawn as ImDrawList geometry
+    if (m_ShapeProgram == 0 && !CreateShapeObjects()) {
+        m_Shapes->SetSupported(false);
+        return;
+    }
+
+    glUseProgram(m_ShapeProgram);
+    glBindVertexArray(m_ShapeVao);
+
+    // The whole frame is uploaded once, every batch then draws its own index range
+    if (m_ShapeGeneration != frame.Generation) {
+        int frameShapes = (int) (frame.Vertices.size() / 4);
+        glBindBuffer(GL_ARRAY_BUFFER, m_ShapeVbo);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (frame.Vertices.size() * sizeof(ShapeVertex)),
+                     frame.Vertices.data(), GL_STREAM_DRAW);
+        if (frameShapes > m_ShapeIndexCapacity) {
+            m_ShapeIndexCapacity = frameShapes * 2;
+            std::vector<GLuint> indices(m_ShapeIndexCapacity * 6);
+            for (int i = 0; i < m_ShapeIndexCapacity; i++) {
+                GLuint v = i * 4;
+                GLuint *idx = &indices[i * 6];
+                idx[0] = v; idx[1] = v + 1; idx[2] = v + 2;
+                idx[3] = v; idx[4] = v + 2; idx[5] = v + 3;
+            }
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr) (indices.size() * sizeof(GLuint)),
+                         indices.data(), GL_STATIC_DRAW);
+        }
+        m_ShapeGeneration = frame.Generation;
+    }
+
+    // Same projection and scissor mapping as ImGui_ImplOpenGL3_SetupRenderState
+    float L = drawData->DisplayPos.x;
+    float R = drawData->DisplayPos.x + drawData->DisplaySize.x;
+    float T = drawData->DisplayPos.y;
+    float B = drawData->DisplayPos.y + drawData->DisplaySize.y;
+    const float ortho_projection[4][4] = {
+            {2.0f / (R - L),    0.0f,              0.0f,  0.0f},
+            {0.0f,              2.0f / (T - B),    0.0f,  0.0f},
+            {0.0f,              0.0f,              -1.0f, 0.0f},
+            {(R + L) / (L - R), (T + B) / (B - T), 0.0f,  1.0f},
+    };
+    glUniformMatrix4fv(m_ShapeProjLoc, 1, GL_FALSE, &ortho_projection[0][0]);
+
+    const float scaleX = drawData->FramebufferScale.x;
+    const float scaleY = drawData->FramebufferScale.y;
+    const float fbHeight = drawData->DisplaySize.y * scaleY;
+    float clipMinX = (clipRect.x - drawData->DisplayPos.x) * scaleX;
+    float clipMinY = (clipRect.y - drawData->DisplayPos.y) * scaleY;
+    float clipMaxX = (clipRect.z - drawData->DisplayPos.x) * scaleX;
+    float clipMaxY = (clipRect.w - drawData->DisplayPos.y) * scaleY;
+    if (clipMaxX <= clipMinX || clipMaxY <= clipMinY)
+        return;
+    glScissor((GLint) clipMinX, (GLint) (fbHeight - clipMaxY),
+              (GLsizei) (clipMaxX - clipMinX), (GLsizei) (clipMaxY - clipMinY));
+
+    glDrawElements(GL_TRIANGLES, shapeCount * 6, GL_UNSIGNED_INT,
+                   (void *) (intptr_t) (firstShape * 6 * sizeof(GLuint)));
+}
@@ -6,17 +6,59 @@
 #define ANDROIDIMGUI_OPENGLGRAPHICS_H
 
 #include <EGL/egl.h>
+#include <GLES3/gl3.h>
 #include "AndroidImgui.h"
 
 class OpenGLGraphics : public AndroidImgui {
 private:
     struct OpenglTextureData : BaseTexData {
+        GLuint Framebuffer = 0;
     };
 
+    // Pixel pack buffer a frame was read into, mapped once its fence signaled
+    struct Readback {
+        GLuint Buffer = 0;
+        GLsizeiptr Size = 0;
+        GLsync Fence = nullptr;
+        int Width = 0;
+        int Height = 0;
+    };
+
+    static constexpr int kMaxReadbacks = 3;
+
     EGLDisplay m_EglDisplay = EGL_NO_DISPLAY;
     EGLSurface m_EglSurface = EGL_NO_SURFACE;
     EGLContext m_EglContext = EGL_NO_CONTEXT;
+    EGLConfig m_EglConfig = nullptr;
+
+    // Analytic shape program, created on first use
+    GLuint m_ShapeProgram = 0;
+    GLint m_ShapeProjLoc = -1;
+    GLuint m_ShapeVao = 0;
+    GLuint m_ShapeVbo = 0;
+    GLuint m_ShapeEbo = 0;
+    int m_ShapeIndexCapacity = 0; // in shapes
+    uint32_t m_ShapeGeneration = 0;
+    ImDrawData *m_CurrentDrawData = nullptr;
+
+    // Ring of readbacks, m_ReadbackCount in flight from m_ReadbackHead on
+    Readback m_Readbacks[kMaxReadbacks];
+    int m_ReadbackHead = 0;
+    int m_ReadbackCount = 0;
+
+    bool CreateShapeObjects();
+
+    void DestroyShapeObjects();
+
+    void StartReadback();
+
+    // Hands finished readbacks to their captures; wait blocks until all are done
+    void CollectReadbacks(bool wait);
+
+    void DestroyReadbacks();
 public:
+    bool CreateDevice() override;
+
     bool Create() override;
 
     void Setup() override;
@@ -31,7 +73,29 @@ public:
 
     BaseTexData *LoadTexture(BaseTexData *tex_data, void *pixel_data) override;
 
+    bool UpdateTexture(BaseTexData *tex_data, const void *pixel_data, int x, int y, int width, int height) override;
+
     void RemoveTexture(BaseTexData *tex_data) override;
+
+    BaseTexData *CreateRenderTarget(int width, int height) override;
+
+    bool RenderToTarget(BaseTexData *target, ImDrawData *drawData) override;
+
+    void RemoveRenderTarget(BaseTexData *target) override;
+
+    void WaitIdle() override;
+
+    TextureMemory GetTextureMemory(BaseTexData *tex_data) override;
+
+    void ReportMemory(MemoryReport &report) override;
+
+    void TrimMemory(TrimLevel level, const std::vector<BaseTexData *> &textures) override;
+
+    void RenderShapes(const ShapeFrame &frame, int firstShape, int shapeCount, const ImVec4 &clipRect) override;
+
+    void BlendPremultiplied() override;
+
+    bool CanCapture() override { return true; }
 };
 
 
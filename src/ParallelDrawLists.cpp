@@ -0,0 +1,126 @@
+#include "imgui_internal.h"
+#include <algorithm>
+#include <cstring>
+#include "ParallelDrawLists.h"
+
+ParallelDrawLists::ParallelDrawLists(int threads) : m_Pool(threads) {
+}
+
+ParallelDrawLists::~ParallelDrawLists() {
+    // Lists unregister from their shared data, so they go first
+    for (Slot &slot: m_Slots)
+        IM_DELETE(slot.DrawList);
+}
+
+void ParallelDrawLists::Build(int count, const std::function<void(int, ImDrawList *)> &builder, Layer layer) {
+    if (count <= 0)
+        return;
+    ImGuiContext *context = ImGui::GetCurrentContext();
+    const ImTextureRef atlas = ImGui::GetIO().Fonts->TexRef;
+
+    const int first = m_Used;
+    m_Used += count;
+    while ((int) m_Slots.size() < m_Used) {
+        Slot slot;
+        slot.Shared = std::make_unique<ImDrawListSharedData>();
+        slot.DrawList = IM_NEW(ImDrawList)(slot.Shared.get());
+        m_Slots.push_back(std::move(slot));
+    }
+    for (int i = first; i < m_Used; i++) {
+        // Fresh copy of the context's settings; the registry of lists stays this slot's own
+        ImDrawListSharedData &shared = *m_Slots[i].Shared;
+        ImVector<ImDrawList *> lists;
+        lists.swap(shared.DrawLists);
+        shared = context->DrawListSharedData;
+        shared.DrawLists.swap(lists);
+        m_Slots[i].Target = layer;
+    }
+
+    m_Pool.ParallelFor(count, [this, first, &atlas, &builder](int index) {
+        ImDrawList *drawList = m_Slots[first + index].DrawList;
+        drawList->_ResetForNewFrame();
+        drawList->PushClipRectFullScreen();
+        drawList->PushTexture(atlas);
+        builder(index, drawList);
+        drawList->PopTexture();
+        drawList->PopClipRect();
+    });
+
+    // Back on the UI thread: bake what the workers couldn't find
+    for (const MissingGlyph &missing: m_Missing)
+        missing.Baked->FindGlyph((ImWchar) missing.Codepoint);
+    m_Missing.clear();
+}
+
+void ParallelDrawLists::AddText(ImDrawList *drawList, ImFontBaked *baked, const ImVec2 &pos, ImU32 col,
+                                const char *text, const char *textEnd) {
+    if (!textEnd)
+        textEnd = text + strlen(text);
+
+    // Only IndexLookup and Glyphs are read: FindGlyph* would load missing glyphs into the atlas
+    auto lookup = [baked](unsigned int c, bool &unknown) -> const ImFontGlyph * {
+        ImU16 i = c < (unsigned int) baked->IndexLookup.Size ? baked->IndexLookup.Data[c] : IM_FONTGLYPH_INDEX_UNUSED;
+        unknown = i == IM_FONTGLYPH_INDEX_UNUSED;
+        if (i == IM_FONTGLYPH_INDEX_UNUSED || i == IM_FONTGLYPH_INDEX_NOT_FOUND)
+            return nullptr;
+        return &baked->Glyphs.Data[i];
+    };
+
+    // First pass sizes the reservation, the second writes the quads
+    int visible = 0;
+    for (const char *s = text; s < textEnd;) {
+        unsigned int c;
+        s += ImTextCharFromUtf8(&c, s, textEnd);
+        bool unknown;
+        const ImFontGlyph *glyph = lookup(c, unknown);
+        if (glyph && glyph->Visible)
+            visible++;
+        if (unknown && c != '\n' && c != '\r' && c < 0x10000) {
+            std::lock_guard<std::mutex> lock(m_MissingLock);
+            m_Missing.push_back({baked, c});
+        }
+    }
+    if (visible == 0)
+        return;
+    drawList->PrimReserve(visible * 6, visible * 4);
+
+    const float left = (float) (int) pos.x;
+    float x = left, y = (float) (int) pos.y;
+    for (const char *s = text; s < textEnd;) {
+        unsigned int c;
+        s += ImTextCharFromUtf8(&c, s, textEnd);
+        if (c == '\n') {
+            x = left;
+            y += baked->Size;
+            continue;
+        }
+        bool unknown;
+        const ImFontGlyph *glyph = lookup(c, unknown);
+        if (!glyph) {
+            x += baked->FallbackAdvanceX;
+            continue;
+        }
+        if (glyph->Visible) {
+            ImU32 glyphCol = glyph->Colored ? (col | ~IM_COL32_A_MASK) : col;
+            drawList->PrimRectUV(ImVec2(x + glyph->X0, y + glyph->Y0), ImVec2(x + glyph->X1, y + glyph->Y1),
+                                 ImVec2(glyph->U0, glyph->V0), ImVec2(glyph->U1, glyph->V1), glyphCol);
+        }
+        x += glyph->AdvanceX;
+    }
+}
+
+void ParallelDrawLists::Attach(ImDrawData *drawData) {
+    int background = 0;
+    for (int i = 0; i < m_Used; i++) {
+        int before = drawData->CmdLists.Size;
+        drawData->AddDrawList(m_Slots[i].DrawList);
+        // Empty lists aren't added
+        if (drawData->CmdLists.Size == before || m_Slots[i].Target != BACKGROUND)
+            continue;
+        // Moved in front of ImGui's lists, keeping build order among background lists
+        ImDrawList **lists = drawData->CmdLists.Data;
+        std::rotate(lists + background, lists + drawData->CmdLists.Size - 1, lists + drawData->CmdLists.Size);
+        background++;
+    }
+    m_Used = 0;
+}
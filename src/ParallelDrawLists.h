@@ -0,0 +1,66 @@
+#ifndef ANDROIDIMGUI_PARALLELDRAWLISTS_H
+#define ANDROIDIMGUI_PARALLELDRAWLISTS_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "imgui.h"
+#include "ThreadPool.h"
+
+struct ImFontBaked;
+
+// Builds independent draw lists on a worker pool between NewFrame and EndFrame. Each list has its own copy of the
+// context's shared data (taken at Build) and keeps its vertex/index buffers across frames. EndFrame adds the lists
+// to the frame in the order they were built.
+//
+// What a builder may touch on a worker:
+// - the ImDrawList it was given: shapes, paths, images, PrimReserve/PrimWrite*
+// - ParallelDrawLists::AddText, with an ImFontBaked the UI thread looked up before Build (ImFont::GetFontBaked)
+// - its own data, read-only data shared with the other builders
+// What it must not: any ImGui:: call, ImDrawList::AddText and every ImFont/ImFontBaked function (they bake
+// glyphs into the shared atlas), another builder's draw list.
+class ParallelDrawLists {
+public:
+    enum Layer {
+        BACKGROUND, // behind everything ImGui draws
+        FOREGROUND  // above everything ImGui draws
+    };
+
+    explicit ParallelDrawLists(int threads = 0);
+
+    ~ParallelDrawLists();
+
+    // UI thread, inside the frame: builder(i, drawList) for i in [0, count), returns when all are built
+    void Build(int count, const std::function<void(int index, ImDrawList *drawList)> &builder,
+               Layer layer = FOREGROUND);
+
+    // Worker-safe text from glyphs already in the atlas. Missing glyphs are skipped this frame and baked by the UI
+    // thread once Build returns, so they show up from the next frame on.
+    void AddText(ImDrawList *drawList, ImFontBaked *baked, const ImVec2 &pos, ImU32 col, const char *text,
+                 const char *textEnd = nullptr);
+
+    // Called by EndFrame after ImGui::Render
+    void Attach(ImDrawData *drawData);
+
+private:
+    struct Slot {
+        std::unique_ptr<ImDrawListSharedData> Shared;
+        ImDrawList *DrawList = nullptr;
+        Layer Target = FOREGROUND;
+    };
+
+    struct MissingGlyph {
+        ImFontBaked *Baked;
+        unsigned int Codepoint;
+    };
+
+    ThreadPool m_Pool;
+    std::vector<Slot> m_Slots;
+    int m_Used = 0;
+
+    std::mutex m_MissingLock;
+    std::vector<MissingGlyph> m_Missing;
+};
+
+#endif //ANDROIDIMGUI_PARALLELDRAWLISTS_H
@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <cstring>
+#include "RecordedDrawList.h"
+
+// Nothing gets culled while recording, clipping happens against the list replayed into
+static constexpr float kUnclipped = 1.0e6f;
+
+RecordedDrawList::RecordedDrawList(std::function<void(ImDrawList *)> record) : m_Record(std::move(record)) {
+}
+
+static inline bool SameTexture(const ImTextureRef &a, const ImTextureRef &b) {
+    return a._TexData == b._TexData && a._TexID == b._TexID;
+}
+
+static inline ImU32 MultiplyColor(ImU32 a, ImU32 b) {
+    ImU32 result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        ImU32 product = ((a >> shift) & 0xFF) * ((b >> shift) & 0xFF);
+        result |= ((product + 127) / 255) << shift;
+    }
+    return result;
+}
+
+void RecordedDrawList::Record() {
+    ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+    ImDrawList *drawList = IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData());
+    drawList->_ResetForNewFrame();
+    drawList->PushClipRect(ImVec2(-kUnclipped, -kUnclipped), ImVec2(kUnclipped, kUnclipped));
+    drawList->PushTexture(atlas->TexRef);
+    m_Record(drawList);
+    drawList->PopTexture();
+    drawList->PopClipRect();
+
+    m_Vertices = drawList->VtxBuffer;
+    m_Indices = drawList->IdxBuffer;
+    m_Commands.clear();
+    for (const ImDrawCmd &cmd: drawList->CmdBuffer) {
+        if (cmd.ElemCount == 0)
+            continue;
+        if (cmd.UserCallback != nullptr) {
+            fprintf(stderr, "RecordedDrawList: callbacks can't be recorded, skipped\n");
+            continue;
+        }
+        m_Commands.push_back({cmd.TexRef, cmd.VtxOffset, cmd.IdxOffset, cmd.ElemCount});
+    }
+    IM_DELETE(drawList);
+
+    m_AtlasTextureId = atlas->TexData ? atlas->TexData->UniqueID : 0;
+    m_Valid = true;
+}
+
+void RecordedDrawList::Replay(ImDrawList *drawList, const ImVec2 &offset, ImU32 tint) {
+    ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+    if (!m_Valid || (atlas->TexData && atlas->TexData->UniqueID != m_AtlasTextureId))
+        Record();
+    if (m_Commands.empty())
+        return;
+
+    const bool transform = offset.x != 0.0f || offset.y != 0.0f || tint != IM_COL32_WHITE;
+    bool pushedTexture = false;
+    size_t first = 0;
+    while (first < m_Commands.size()) {
+        // Commands sharing a vertex range: the range is copied once, then their indices
+        const unsigned int vtxOffset = m_Commands[first].VtxOffset;
+        size_t end = first;
+        while (end < m_Commands.size() && m_Commands[end].VtxOffset == vtxOffset)
+            end++;
+        const int vtxCount = (end < m_Commands.size() ? (int) m_Commands[end].VtxOffset : m_Vertices.Size) -
+                             (int) vtxOffset;
+
+        // May start a new vertex range on the target, which makes base 0
+        drawList->PrimReserve(0, vtxCount);
+        const unsigned int base = drawList->_VtxCurrentIdx;
+        const ImDrawVert *src = m_Vertices.Data + vtxOffset;
+        if (!transform) {
+            memcpy(drawList->_VtxWritePtr, src, (size_t) vtxCount * sizeof(ImDrawVert));
+        } else {
+            for (int i = 0; i < vtxCount; i++) {
+                ImDrawVert &dst = drawList->_VtxWritePtr[i];
+                dst.pos = ImVec2(src[i].pos.x + offset.x, src[i].pos.y + offset.y);
+                dst.uv = src[i].uv;
+                dst.col = tint == IM_COL32_WHITE ? src[i].col : MultiplyColor(src[i].col, tint);
+            }
+        }
+        drawList->_VtxWritePtr += vtxCount;
+        drawList->_VtxCurrentIdx += vtxCount;
+
+        for (size_t c = first; c < end; c++) {
+            const Command &command = m_Commands[c];
+            if (!SameTexture(command.TexRef, drawList->_CmdHeader.TexRef)) {
+                if (pushedTexture)
+                    drawList->PopTexture();
+                pushedTexture = !SameTexture(command.TexRef, drawList->_CmdHeader.TexRef);
+                if (pushedTexture)
+                    drawList->PushTexture(command.TexRef);
+            }
+            // Written directly, PrimReserve could open another vertex range in between
+            const int count = (int) command.ElemCount;
+            const int old = drawList->IdxBuffer.Size;
+            drawList->IdxBuffer.resize(old + count);
+            ImDrawIdx *dst = drawList->IdxBuffer.Data + old;
+            const ImDrawIdx *indices = m_Indices.Data + command.IdxOffset;
+            if (base == 0) {
+                memcpy(dst, indices, (size_t) count * sizeof(ImDrawIdx));
+            } else {
+                for (int i = 0; i < count; i++)
+                    dst[i] = (ImDrawIdx) (indices[i] + base);
+            }
+            drawList->CmdBuffer.Data[drawList->CmdBuffer.Size - 1].ElemCount += count;
+            drawList->_IdxWritePtr = drawList->IdxBuffer.Data + drawList->IdxBuffer.Size;
+        }
+        first = end;
+    }
+    if (pushedTexture)
+        drawList->PopTexture();
+}
@@ -0,0 +1,41 @@
+#ifndef ANDROIDIMGUI_RECORDEDDRAWLIST_H
+#define ANDROIDIMGUI_RECORDEDDRAWLIST_H
+
+#include <functional>
+#include <vector>
+#include "imgui.h"
+
+// Geometry that stays the same between frames (grids, frames, static labels) tessellated once and appended to a
+// draw list with memcpy. Recording happens on the first Replay, after Invalidate and whenever the font atlas got
+// a new texture, which would leave recorded glyph UVs pointing into the old one. UI thread, inside a frame.
+class RecordedDrawList {
+public:
+    explicit RecordedDrawList(std::function<void(ImDrawList *drawList)> record);
+
+    // Records again on the next Replay, e.g. after the data the record function draws changed
+    void Invalidate() { m_Valid = false; }
+
+    // Appends the recorded geometry moved by offset, its colors multiplied by tint. Clipped by drawList's clip rect.
+    void Replay(ImDrawList *drawList, const ImVec2 &offset = ImVec2(0.0f, 0.0f), ImU32 tint = IM_COL32_WHITE);
+
+    int GetVertexCount() const { return m_Vertices.Size; }
+
+private:
+    struct Command {
+        ImTextureRef TexRef;
+        unsigned int VtxOffset;
+        unsigned int IdxOffset;
+        unsigned int ElemCount;
+    };
+
+    void Record();
+
+    std::function<void(ImDrawList *)> m_Record;
+    bool m_Valid = false;
+    int m_AtlasTextureId = 0;
+    ImVector<ImDrawVert> m_Vertices;
+    ImVector<ImDrawIdx> m_Indices;
+    std::vector<Command> m_Commands;
+};
+
+#endif //ANDROIDIMGUI_RECORDEDDRAWLIST_H
@@ -0,0 +1,509 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include "SamplingProfiler.h"
+#include "ELF/elf_util.h"
+#include "imgui.h"
+
+// Older glibc only has the union member
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+static int CurrentTid() {
+    return (int) syscall(SYS_gettid);
+}
+
+SamplingProfiler &SamplingProfiler::Get() {
+    static SamplingProfiler profiler;
+    return profiler;
+}
+
+SamplingProfiler::~SamplingProfiler() {
+    Stop();
+}
+
+void SamplingProfiler::OnSignal(int signal, siginfo_t *info, void *context) {
+    int savedErrno = errno;
+    Get().TakeSample(context);
+    errno = savedErrno;
+}
+
+// Signal handler: no locks, no allocation
+void SamplingProfiler::TakeSample(void *context) {
+    if (!m_Running.load(std::memory_order_acquire))
+        return;
+    const int tid = CurrentTid();
+    int thread = 0;
+    while (thread < kMaxThreads && m_Threads[thread].Tid.load(std::memory_order_acquire) != tid)
+        thread++;
+    if (thread == kMaxThreads)
+        return;
+    ThreadSlot &slot = m_Threads[thread];
+    // Each perf_event overflow disables the counter until refreshed
+    int perfFd = slot.PerfFd.load(std::memory_order_relaxed);
+    if (perfFd >= 0)
+        ioctl(perfFd, PERF_EVENT_IOC_REFRESH, 1);
+
+    uint64_t ticket = m_Write.load(std::memory_order_relaxed);
+    do {
+        if (ticket - m_Read.load(std::memory_order_acquire) >= kCapacity) {
+            m_Dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    } while (!m_Write.compare_exchange_weak(ticket, ticket + 1, std::memory_order_acq_rel));
+    Sample &sample = m_Samples[ticket % kCapacity];
+
+    auto *ucontext = (ucontext_t *) context;
+    uintptr_t pc, fp, sp;
+#if defined(__aarch64__)
+    pc = ucontext->uc_mcontext.pc;
+    fp = ucontext->uc_mcontext.regs[29];
+    sp = ucontext->uc_mcontext.sp;
+#elif defined(__x86_64__)
+    pc = ucontext->uc_mcontext.gregs[REG_RIP];
+    fp = ucontext->uc_mcontext.gregs[REG_RBP];
+    sp = ucontext->uc_mcontext.gregs[REG_RSP];
+#elif defined(__i386__)
+    pc = ucontext->uc_mcontext.gregs[REG_EIP];
+    fp = ucontext->uc_mcontext.gregs[REG_EBP];
+    sp = ucontext->uc_mcontext.gregs[REG_ESP];
+#else
+    // 32-bit arm frame records depend on ARM/Thumb code, only the pc is taken
+    pc = ucontext->uc_mcontext.arm_pc;
+    fp = 0;
+    sp = 0;
+#endif
+    int depth = 0;
+    sample.Frames[depth++] = pc;
+    // Frame records are {previous fp, return address}; every step stays inside the thread's stack and goes up
+    while (depth < kMaxDepth && fp >= sp && fp >= slot.StackLow && fp + 2 * sizeof(uintptr_t) <= slot.StackHigh &&
+           fp % sizeof(uintptr_t) == 0) {
+        auto *record = (const uintptr_t *) fp;
+        uintptr_t ret = record[1];
+#if defined(__aarch64__)
+        // Pointer authentication bits above the 48-bit address space
+        ret &= 0x0000FFFFFFFFFFFFull;
+#endif
+        if (ret == 0)
+            break;
+        // Inside the call instruction rather than after it
+        sample.Frames[depth++] = ret - 1;
+        if (record[0] <= fp)
+            break;
+        fp = record[0];
+    }
+    sample.Thread = thread;
+    sample.Depth = depth;
+    sample.Sequence.store(ticket + 1, std::memory_order_release);
+}
+
+bool SamplingProfiler::Arm(ThreadSlot &slot) {
+    const int tid = slot.Tid.load(std::memory_order_relaxed);
+    const uint64_t period = 1000000000ull / (uint64_t) m_Hz;
+
+    perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_TASK_CLOCK;
+    attr.sample_period = period;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    int fd = (int) syscall(SYS_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd >= 0) {
+        f_owner_ex owner = {F_OWNER_TID, tid};
+        if (fcntl(fd, F_SETOWN_EX, &owner) == 0 && fcntl(fd, F_SETSIG, SIGPROF) == 0 &&
+            fcntl(fd, F_SETFL, O_ASYNC | O_NONBLOCK) == 0) {
+            slot.PerfFd.store(fd, std::memory_order_relaxed);
+            if (ioctl(fd, PERF_EVENT_IOC_REFRESH, 1) == 0) {
+                m_Source = "perf_event";
+                return true;
+            }
+            slot.PerfFd.store(-1, std::memory_order_relaxed);
+        }
+        close(fd);
+    }
+
+    // Without perf_event (perf_event_paranoid, seccomp): a timer on the thread's CPU clock, the clock id built
+    // like pthread_getcpuclockid does
+    auto clock = (clockid_t) ((~(unsigned int) tid << 3) | 6);
+    sigevent event = {};
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = tid;
+    if (timer_create(clock, &event, &slot.Timer) != 0) {
+        fprintf(stderr, "SamplingProfiler: can't sample thread %d: %s\n", tid, strerror(errno));
+        return false;
+    }
+    itimerspec spec = {};
+    spec.it_interval.tv_sec = (time_t) (period / 1000000000ull);
+    spec.it_interval.tv_nsec = (long) (period % 1000000000ull);
+    spec.it_value = spec.it_interval;
+    timer_settime(slot.Timer, 0, &spec, nullptr);
+    slot.HasTimer = true;
+    m_Source = "timer";
+    return true;
+}
+
+void SamplingProfiler::Disarm(ThreadSlot &slot) {
+    int fd = slot.PerfFd.exchange(-1, std::memory_order_relaxed);
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        close(fd);
+    }
+    if (slot.HasTimer) {
+        timer_delete(slot.Timer);
+        slot.HasTimer = false;
+    }
+}
+
+bool SamplingProfiler::AddThreadLocked(const char *name) {
+    const int tid = CurrentTid();
+    ThreadSlot *slot = nullptr;
+    for (ThreadSlot &candidate: m_Threads) {
+        int slotTid = candidate.Tid.load(std::memory_order_relaxed);
+        if (slotTid == tid) {
+            if (name)
+                candidate.Name = name;
+            return true;
+        }
+        if (slotTid == 0 && !slot)
+            slot = &candidate;
+    }
+    if (!slot) {
+        fprintf(stderr, "SamplingProfiler: more than %d threads\n", kMaxThreads);
+        return false;
+    }
+
+    slot->StackLow = slot->StackHigh = 0;
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        void *stack = nullptr;
+        size_t size = 0;
+        if (pthread_attr_getstack(&attr, &stack, &size) == 0) {
+            slot->StackLow = (uintptr_t) stack;
+            slot->StackHigh = (uintptr_t) stack + size;
+        }
+        pthread_attr_destroy(&attr);
+    }
+    slot->Name = name ? name : "thread " + std::to_string(tid);
+    slot->Tid.store(tid, std::memory_order_release);
+    return !m_Running.load(std::memory_order_relaxed) || Arm(*slot);
+}
+
+bool SamplingProfiler::AddCurrentThread(const char *name) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return AddThreadLocked(name);
+}
+
+void SamplingProfiler::RemoveCurrentThread() {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    const int tid = CurrentTid();
+    for (ThreadSlot &slot: m_Threads) {
+        if (slot.Tid.load(std::memory_order_relaxed) == tid) {
+            Disarm(slot);
+            slot.Tid.store(0, std::memory_order_release);
+        }
+    }
+}
+
+bool SamplingProfiler::Start(int hz) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    if (m_Running.load(std::memory_order_relaxed))
+        return true;
+    m_Hz = std::max(hz, 1);
+    if (!m_Samples)
+        m_Samples = std::make_unique<Sample[]>(kCapacity);
+    if (!m_HandlerInstalled) {
+        struct sigaction action = {};
+        action.sa_sigaction = OnSignal;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, nullptr) != 0) {
+            fprintf(stderr, "SamplingProfiler: no SIGPROF handler: %s\n", strerror(errno));
+            return false;
+        }
+        m_HandlerInstalled = true;
+    }
+    if (!AddThreadLocked(nullptr))
+        return false;
+
+    m_Running.store(true, std::memory_order_release);
+    bool armed = false;
+    for (ThreadSlot &slot: m_Threads) {
+        if (slot.Tid.load(std::memory_order_relaxed) != 0)
+            armed |= Arm(slot);
+    }
+    if (!armed)
+        m_Running.store(false, std::memory_order_release);
+    return armed;
+}
+
+void SamplingProfiler::Stop() {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    m_Running.store(false, std::memory_order_release);
+    for (ThreadSlot &slot: m_Threads)
+        Disarm(slot);
+}
+
+uint64_t SamplingProfiler::GetSampleCount() const {
+    return m_Nodes.empty() ? 0 : m_Nodes[0].Total;
+}
+
+static bool IsElfFile(const std::string &path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+        return false;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    char magic[4] = {};
+    bool elf = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, ELFMAG, SELFMAG) == 0;
+    fclose(file);
+    return elf;
+}
+
+void SamplingProfiler::ReadMappings() {
+    m_Mappings.clear();
+    FILE *maps = fopen("/proc/self/maps", "r");
+    if (!maps)
+        return;
+    std::unordered_map<std::string, uintptr_t> bases;
+    char line[512];
+    while (fgets(line, sizeof(line), maps)) {
+        unsigned long start, end;
+        char perms[5] = {};
+        int pathOffset = 0;
+        if (sscanf(line, "%lx-%lx %4s %*s %*s %*s %n", &start, &end, perms, &pathOffset) < 3 || pathOffset == 0)
+            continue;
+        std::string path = line + pathOffset;
+        while (!path.empty() && (path.back() == '\n' || path.back() == ' '))
+            path.pop_back();
+        if (path.empty() || path[0] != '/')
+            continue;
+        auto base = bases.emplace(path, start).first;
+        base->second = std::min<uintptr_t>(base->second, start);
+        if (perms[2] == 'x')
+            m_Mappings.push_back({start, end, 0, path});
+    }
+    fclose(maps);
+    for (Mapping &mapping: m_Mappings)
+        mapping.Base = bases[mapping.Path];
+    std::sort(m_Mappings.begin(), m_Mappings.end(), [](const Mapping &a, const Mapping &b) {
+        return a.Start < b.Start;
+    });
+}
+
+int SamplingProfiler::FunctionId(const std::string &name) {
+    auto found = m_FunctionIds.find(name);
+    if (found != m_FunctionIds.end())
+        return found->second;
+    m_Functions.push_back(name);
+    return m_FunctionIds[name] = (int) m_Functions.size() - 1;
+}
+
+int SamplingProfiler::Symbolize(uintptr_t address) {
+    auto cached = m_AddressFunctions.find(address);
+    if (cached != m_AddressFunctions.end())
+        return cached->second;
+
+    auto findMapping = [this, address]() -> const Mapping * {
+        auto next = std::upper_bound(m_Mappings.begin(), m_Mappings.end(), address,
+                                     [](uintptr_t value, const Mapping &mapping) { return value < mapping.Start; });
+        if (next == m_Mappings.begin() || address >= (next - 1)->End)
+            return nullptr;
+        return &*(next - 1);
+    };
+    const Mapping *mapping = findMapping();
+    // Libraries loaded since the last read
+    if (!mapping) {
+        ReadMappings();
+        mapping = findMapping();
+    }
+
+    char buffer[64];
+    std::string name;
+    if (mapping) {
+        std::unique_ptr<ElfImg> &image = m_Images[mapping->Path];
+        if (!image && IsElfFile(mapping->Path))
+            image = std::make_unique<ElfImg>(mapping->Path);
+        std::string_view symbol;
+        if (image && image->isValid())
+            symbol = image->getSymbName(address);
+        if (!symbol.empty()) {
+            name = symbol;
+            int status = 0;
+            if (char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status)) {
+                name = demangled;
+                free(demangled);
+            }
+        } else {
+            snprintf(buffer, sizeof(buffer), "+0x%lx", (unsigned long) (address - mapping->Base));
+            name = mapping->Path.substr(mapping->Path.find_last_of('/') + 1) + buffer;
+        }
+    } else {
+        snprintf(buffer, sizeof(buffer), "0x%lx", (unsigned long) address);
+        name = buffer;
+    }
+    return m_AddressFunctions[address] = FunctionId(name);
+}
+
+int SamplingProfiler::Child(int parent, int function) {
+    for (int child: m_Nodes[parent].Children) {
+        if (m_Nodes[child].Function == function)
+            return child;
+    }
+    m_Nodes.push_back({function, parent});
+    int child = (int) m_Nodes.size() - 1;
+    m_Nodes[parent].Children.push_back(child);
+    return child;
+}
+
+void SamplingProfiler::Collect() {
+    if (!m_Samples)
+        return;
+    if (m_Nodes.empty())
+        m_Nodes.push_back({FunctionId("all"), -1});
+    std::vector<std::string> threadNames(kMaxThreads);
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        for (int i = 0; i < kMaxThreads; i++)
+            threadNames[i] = m_Threads[i].Name;
+    }
+
+    uint64_t read = m_Read.load(std::memory_order_relaxed);
+    const uint64_t write = m_Write.load(std::memory_order_acquire);
+    for (; read < write; read++) {
+        const Sample &sample = m_Samples[read % kCapacity];
+        // Still being written, picked up next time
+        if (sample.Sequence.load(std::memory_order_acquire) != read + 1)
+            break;
+        int node = Child(0, FunctionId(threadNames[sample.Thread]));
+        m_Nodes[0].Total++;
+        m_Nodes[node].Total++;
+        for (int i = sample.Depth - 1; i >= 0; i--) {
+            node = Child(node, Symbolize(sample.Frames[i]));
+            m_Nodes[node].Total++;
+        }
+        m_Nodes[node].Self++;
+    }
+    m_Read.store(read, std::memory_order_release);
+}
+
+void SamplingProfiler::Clear() {
+    Collect();
+    m_Nodes.clear();
+    m_Zoom = 0;
+}
+
+void SamplingProfiler::WriteFolded(FILE *file, int node, std::string &path) {
+    size_t length = path.size();
+    if (!path.empty())
+        path += ';';
+    path += m_Functions[m_Nodes[node].Function];
+    if (m_Nodes[node].Self)
+        fprintf(file, "%s %llu\n", path.c_str(), (unsigned long long) m_Nodes[node].Self);
+    for (int child: m_Nodes[node].Children)
+        WriteFolded(file, child, path);
+    path.resize(length);
+}
+
+bool SamplingProfiler::ExportCollapsed(const char *path) {
+    Collect();
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "SamplingProfiler: can't write %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    std::string stack;
+    if (!m_Nodes.empty()) {
+        for (int child: m_Nodes[0].Children)
+            WriteFolded(file, child, stack);
+    }
+    return fclose(file) == 0;
+}
+
+float SamplingProfiler::DrawNode(int node, float x, float y, float width, float rowHeight, uint64_t rootTotal) {
+    const Node &current = m_Nodes[node];
+    const std::string &name = m_Functions[current.Function];
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    ImVec2 min(x, y), max(x + width - 1.0f, y + rowHeight - 1.0f);
+
+    // Warm colors, stable per function
+    size_t hash = std::hash<std::string>()(name);
+    ImU32 col = IM_COL32(205 + hash % 50, 80 + (hash >> 8) % 140, 40 + (hash >> 16) % 50, 255);
+    drawList->AddRectFilled(min, max, col);
+    if (width > 24.0f) {
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2(x + 3.0f, y), IM_COL32_BLACK, name.c_str());
+        drawList->PopClipRect();
+    }
+    if (ImGui::IsWindowHovered() && ImGui::IsMouseHoveringRect(min, max)) {
+        ImGui::SetTooltip("%s\n%llu samples (%.1f%%), %llu self", name.c_str(), (unsigned long long) current.Total,
+                          100.0 * (double) current.Total / (double) rootTotal, (unsigned long long) current.Self);
+        if (ImGui::IsMouseClicked(0))
+            m_Zoom = node;
+    }
+
+    float bottom = y + rowHeight;
+    float childX = x;
+    for (int child: current.Children) {
+        float childWidth = width * (float) m_Nodes[child].Total / (float) current.Total;
+        if (childWidth >= 1.0f)
+            bottom = std::max(bottom, DrawNode(child, childX, y + rowHeight, childWidth, rowHeight, rootTotal));
+        childX += childWidth;
+    }
+    return bottom;
+}
+
+void SamplingProfiler::ShowWindow(const char *title, bool *open) {
+    Collect();
+    if (!ImGui::Begin(title, open)) {
+        ImGui::End();
+        return;
+    }
+    if (IsRunning()) {
+        if (ImGui::Button("Stop"))
+            Stop();
+    } else if (ImGui::Button("Start")) {
+        Start(m_Hz);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear"))
+        Clear();
+    ImGui::SameLine();
+    if (ImGui::Button("Export"))
+        ExportCollapsed(m_ExportPath);
+    ImGui::SameLine();
+    ImGui::InputText("##path", m_ExportPath, sizeof(m_ExportPath));
+    ImGui::Text("%s, %llu samples, %llu dropped", m_Source, (unsigned long long) GetSampleCount(),
+                (unsigned long long) GetDroppedCount());
+    if (m_Zoom != 0) {
+        ImGui::SameLine();
+        if (ImGui::Button("Unzoom"))
+            m_Zoom = 0;
+    }
+
+    ImGui::BeginChild("##flame", ImVec2(0.0f, 0.0f));
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = ImGui::GetContentRegionAvail().x;
+    float bottom = origin.y;
+    if (m_Zoom < (int) m_Nodes.size() && m_Nodes[m_Zoom].Total > 0) {
+        bottom = DrawNode(m_Zoom, origin.x, origin.y, width, ImGui::GetTextLineHeightWithSpacing(),
+                          m_Nodes[m_Zoom].Total);
+    }
+    ImGui::Dummy(ImVec2(width, bottom - origin.y));
+    ImGui::EndChild();
+    ImGui::End();
+}
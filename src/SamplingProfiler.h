@@ -0,0 +1,145 @@
+#ifndef ANDROIDIMGUI_SAMPLINGPROFILER_H
+#define ANDROIDIMGUI_SAMPLINGPROFILER_H
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ElfImg;
+
+// In-process CPU profiler: registered threads are interrupted every 1/hz seconds of their CPU time and their stack
+// is walked by frame pointer: configure with ANDROIDIMGUI_PROFILER for the library and build the app's own code with
+// -fno-omit-frame-pointer. Samples go through a lock-free ring and are symbolized with ElfImg and /proc/self/maps
+// when collected
+class SamplingProfiler {
+public:
+    static SamplingProfiler &Get();
+
+    ~SamplingProfiler();
+
+    // Registers the calling thread, then samples every registered thread
+    bool Start(int hz = 1000);
+
+    void Stop();
+
+    bool IsRunning() const { return m_Running.load(std::memory_order_relaxed); }
+
+    // On the thread to profile, which stays registered until RemoveCurrentThread. Sampled while running
+    bool AddCurrentThread(const char *name = nullptr);
+
+    // Before a registered thread exits
+    void RemoveCurrentThread();
+
+    // Moves new samples into the call tree. UI thread, like the rest below
+    void Collect();
+
+    void Clear();
+
+    // Folded stacks, "thread;outer;...;inner count" per line, for flamegraph.pl or speedscope
+    bool ExportCollapsed(const char *path);
+
+    // Collects, then draws the call tree as a flame graph with start/stop and export controls
+    void ShowWindow(const char *title = "Profiler", bool *open = nullptr);
+
+    // "perf_event" or "timer" once started
+    const char *GetSource() const { return m_Source; }
+
+    uint64_t GetSampleCount() const;
+
+    uint64_t GetDroppedCount() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int kMaxThreads = 32;
+    static constexpr int kMaxDepth = 64;
+    static constexpr uint64_t kCapacity = 2048;
+
+    struct ThreadSlot {
+        std::atomic<int> Tid{0};
+        uintptr_t StackLow = 0;
+        uintptr_t StackHigh = 0;
+        std::atomic<int> PerfFd{-1};
+        timer_t Timer{};
+        bool HasTimer = false;
+        std::string Name;
+    };
+
+    struct Sample {
+        std::atomic<uint64_t> Sequence{0};
+        int Thread;
+        int Depth;
+        uintptr_t Frames[kMaxDepth];
+    };
+
+    struct Node {
+        int Function;
+        int Parent;
+        std::vector<int> Children;
+        uint64_t Total = 0;
+        uint64_t Self = 0;
+    };
+
+    struct Mapping {
+        uintptr_t Start;
+        uintptr_t End;
+        uintptr_t Base; // lowest mapping of the file
+        std::string Path;
+    };
+
+    SamplingProfiler() = default;
+
+    static void OnSignal(int signal, siginfo_t *info, void *context);
+
+    void TakeSample(void *context);
+
+    bool AddThreadLocked(const char *name);
+
+    bool Arm(ThreadSlot &slot);
+
+    void Disarm(ThreadSlot &slot);
+
+    void ReadMappings();
+
+    int Symbolize(uintptr_t address);
+
+    int FunctionId(const std::string &name);
+
+    int Child(int parent, int function);
+
+    void WriteFolded(FILE *file, int node, std::string &path);
+
+    float DrawNode(int node, float x, float y, float width, float rowHeight, uint64_t rootTotal);
+
+    std::mutex m_Lock;
+    ThreadSlot m_Threads[kMaxThreads];
+    std::atomic<bool> m_Running{false};
+    bool m_HandlerInstalled = false;
+    int m_Hz = 1000;
+    const char *m_Source = "";
+
+    std::unique_ptr<Sample[]> m_Samples;
+    std::atomic<uint64_t> m_Write{0};
+    std::atomic<uint64_t> m_Read{0};
+    std::atomic<uint64_t> m_Dropped{0};
+
+    std::vector<Mapping> m_Mappings;
+    std::unordered_map<std::string, std::unique_ptr<ElfImg>> m_Images;
+    std::unordered_map<uintptr_t, int> m_AddressFunctions;
+    std::unordered_map<std::string, int> m_FunctionIds;
+    std::vector<std::string> m_Functions;
+    std::vector<Node> m_Nodes;
+    int m_Zoom = 0;
+#ifdef __ANDROID__
+    char m_ExportPath[256] = "/data/local/tmp/profile.folded";
+#else
+    char m_ExportPath[256] = "/tmp/profile.folded";
+#endif
+};
+
+#endif //ANDROIDIMGUI_SAMPLINGPROFILER_H
@@ -0,0 +1,172 @@
+#include "imgui_internal.h"
+#include <algorithm>
+#include <cmath>
+#include "ShapeBatch.h"
+#include "TextLayoutCache.h"
+
+// 16-bit indices: every reservation has to stay below 65536 vertices
+static constexpr int kMaxChunkVertices = 60000;
+
+thread_local std::vector<unsigned int> ShapeBatch::t_Indices;
+thread_local std::vector<float> ShapeBatch::t_UnitX;
+thread_local std::vector<float> ShapeBatch::t_UnitY;
+
+// Closed outline of Points points, repeated on Rings rings at Offsets (outward from the shape's edge)
+struct ShapeOutline {
+    int Points;
+    int Rings;
+    float Offsets[4];
+    float Alpha[4];
+    bool Filled;
+};
+
+static ShapeOutline FillOutline(int points, bool antiAliased) {
+    if (!antiAliased)
+        return {points, 1, {0.0f}, {1.0f}, true};
+    // A 1px fringe fading to transparent around the solid part
+    return {points, 2, {-0.5f, 0.5f}, {1.0f, 0.0f}, true};
+}
+
+static ShapeOutline StrokeOutline(const ImDrawList *drawList, int points, float thickness, float center) {
+    if (!(drawList->Flags & ImDrawListFlags_AntiAliasedLines)) {
+        float h = thickness * 0.5f;
+        return {points, 2, {center - h, center + h}, {1.0f, 1.0f}, false};
+    }
+    // Thin strokes keep a 1px core and get fainter instead
+    float core = ImMax(thickness - 1.0f, 0.0f) * 0.5f;
+    float alpha = ImMin(thickness, 1.0f);
+    return {points, 4, {center - core - 1.0f, center - core, center + core, center + core + 1.0f},
+            {0.0f, alpha, alpha, 0.0f}, false};
+}
+
+static inline ImU32 ScaleAlpha(ImU32 col, float scale) {
+    ImU32 alpha = (ImU32) ((float) ((col & IM_COL32_A_MASK) >> IM_COL32_A_SHIFT) * scale);
+    return (col & ~IM_COL32_A_MASK) | (alpha << IM_COL32_A_SHIFT);
+}
+
+// unitX/unitY: the outline's points for a shape of half extent 1 around 0. Rects are given by their min corner.
+void ShapeBatch::AddShapes(ImDrawList *drawList, const ShapeSpans &shapes, const ShapeOutline &outline,
+                           const float *unitX, const float *unitY, bool rect) {
+    if (shapes.Count <= 0)
+        return;
+    const int n = outline.Points;
+    const int vtxPerShape = n * outline.Rings;
+
+    // The same indices for every shape, only the base vertex differs
+    std::vector<unsigned int> &indices = t_Indices;
+    indices.clear();
+    if (outline.Filled) {
+        for (int i = 1; i < n - 1; i++)
+            indices.insert(indices.end(), {0u, (unsigned int) i, (unsigned int) i + 1});
+    }
+    for (int ring = 0; ring + 1 < outline.Rings; ring++) {
+        unsigned int inner = ring * n, outer = inner + n;
+        for (unsigned int i = 0; i < (unsigned int) n; i++) {
+            unsigned int next = (i + 1) % n;
+            indices.insert(indices.end(), {inner + i, inner + next, outer + next, inner + i, outer + next, outer + i});
+        }
+    }
+    const int idxPerShape = (int) indices.size();
+
+    const ImVec2 uv = drawList->_Data->TexUvWhitePixel;
+    const int perChunk = ImMax(kMaxChunkVertices / vtxPerShape, 1);
+    for (int first = 0; first < shapes.Count; first += perChunk) {
+        const int count = ImMin(perChunk, shapes.Count - first);
+        drawList->PrimReserve(count * idxPerShape, count * vtxPerShape);
+        ImDrawVert *vtx = drawList->_VtxWritePtr;
+        ImDrawIdx *idx = drawList->_IdxWritePtr;
+        unsigned int base = drawList->_VtxCurrentIdx;
+
+        for (int s = first; s < first + count; s++) {
+            const ImU32 col = shapes.Col ? shapes.Col[s] : shapes.DefaultCol;
+            const float w = shapes.Width ? shapes.Width[s] : shapes.DefaultSize.x;
+            float extentX = w, extentY = w, cx = shapes.X[s], cy = shapes.Y[s];
+            if (rect) {
+                const float h = shapes.Height ? shapes.Height[s] : shapes.DefaultSize.y;
+                extentX = w * 0.5f;
+                extentY = h * 0.5f;
+                cx += extentX;
+                cy += extentY;
+            }
+            for (int ring = 0; ring < outline.Rings; ring++) {
+                const float ex = ImMax(extentX + outline.Offsets[ring], 0.0f);
+                const float ey = ImMax(extentY + outline.Offsets[ring], 0.0f);
+                const ImU32 ringCol = outline.Alpha[ring] == 1.0f ? col : ScaleAlpha(col, outline.Alpha[ring]);
+                for (int i = 0; i < n; i++) {
+                    vtx[i].pos.x = cx + unitX[i] * ex;
+                    vtx[i].pos.y = cy + unitY[i] * ey;
+                    vtx[i].uv = uv;
+                    vtx[i].col = ringCol;
+                }
+                vtx += n;
+            }
+            for (int i = 0; i < idxPerShape; i++)
+                idx[i] = (ImDrawIdx) (base + indices[i]);
+            idx += idxPerShape;
+            base += vtxPerShape;
+        }
+        drawList->_VtxWritePtr = vtx;
+        drawList->_IdxWritePtr = idx;
+        drawList->_VtxCurrentIdx = base;
+    }
+}
+
+static const float kRectUnitX[4] = {-1.0f, 1.0f, 1.0f, -1.0f};
+static const float kRectUnitY[4] = {-1.0f, -1.0f, 1.0f, 1.0f};
+
+void ShapeBatch::AddCircleShapes(ImDrawList *drawList, const ShapeSpans &shapes, float thickness, bool filled) {
+    float maxRadius = shapes.DefaultSize.x;
+    if (shapes.Width) {
+        maxRadius = 0.0f;
+        for (int i = 0; i < shapes.Count; i++)
+            maxRadius = ImMax(maxRadius, shapes.Width[i]);
+    }
+    const int n = ImMax(drawList->_CalcCircleAutoSegmentCount(maxRadius), 3);
+    t_UnitX.resize(n);
+    t_UnitY.resize(n);
+    for (int i = 0; i < n; i++) {
+        float a = (float) i * (2.0f * IM_PI / (float) n);
+        t_UnitX[i] = std::cos(a);
+        t_UnitY[i] = std::sin(a);
+    }
+    ShapeOutline outline = filled ? FillOutline(n, (drawList->Flags & ImDrawListFlags_AntiAliasedFill) != 0)
+                             : StrokeOutline(drawList, n, thickness, 0.0f);
+    AddShapes(drawList, shapes, outline, t_UnitX.data(), t_UnitY.data(), false);
+}
+
+void ShapeBatch::AddRectsFilled(ImDrawList *drawList, const ShapeSpans &shapes) {
+    // Axis-aligned, so not anti-aliased, like ImDrawList::AddRectFilled
+    AddShapes(drawList, shapes, FillOutline(4, false), kRectUnitX, kRectUnitY, true);
+    AddLabels(drawList, shapes);
+}
+
+void ShapeBatch::AddRects(ImDrawList *drawList, const ShapeSpans &shapes, float thickness) {
+    // Centered half a pixel inside the rect, like ImDrawList::AddRect
+    AddShapes(drawList, shapes, StrokeOutline(drawList, 4, thickness, -0.5f), kRectUnitX, kRectUnitY, true);
+    AddLabels(drawList, shapes);
+}
+
+void ShapeBatch::AddCirclesFilled(ImDrawList *drawList, const ShapeSpans &shapes) {
+    AddCircleShapes(drawList, shapes, 0.0f, true);
+    AddLabels(drawList, shapes);
+}
+
+void ShapeBatch::AddCircles(ImDrawList *drawList, const ShapeSpans &shapes, float thickness) {
+    AddCircleShapes(drawList, shapes, thickness, false);
+    AddLabels(drawList, shapes);
+}
+
+void ShapeBatch::AddLabels(ImDrawList *drawList, const ShapeSpans &shapes) {
+    if (!shapes.Labels)
+        return;
+    for (int i = 0; i < shapes.Count; i++) {
+        const char *label = shapes.Labels[i];
+        if (!label || !*label)
+            continue;
+        ImVec2 pos(shapes.X[i] + shapes.LabelOffset.x, shapes.Y[i] + shapes.LabelOffset.y);
+        if (shapes.LabelCache)
+            shapes.LabelCache->AddText(drawList, nullptr, 0.0f, pos, shapes.LabelCol, label);
+        else
+            drawList->AddText(pos, shapes.LabelCol, label);
+    }
+}
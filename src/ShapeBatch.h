@@ -0,0 +1,58 @@
+#ifndef ANDROIDIMGUI_SHAPEBATCH_H
+#define ANDROIDIMGUI_SHAPEBATCH_H
+
+#include <vector>
+#include "imgui.h"
+
+class TextLayoutCache;
+struct ShapeOutline;
+
+// Many shapes of one kind in structure-of-arrays form. X, Y are the rect's min corner or the circle's center;
+// Width is the circle's radius. Arrays left nullptr take the Default* value for every shape.
+struct ShapeSpans {
+    int Count = 0;
+    const float *X = nullptr;
+    const float *Y = nullptr;
+    const float *Width = nullptr;
+    const float *Height = nullptr;
+    const ImU32 *Col = nullptr;
+    ImVec2 DefaultSize = ImVec2(8.0f, 8.0f);
+    ImU32 DefaultCol = IM_COL32_WHITE;
+
+    // Optional, entries may be nullptr. Drawn above the shapes at (X, Y) + LabelOffset
+    const char *const *Labels = nullptr;
+    ImVec2 LabelOffset = ImVec2(0.0f, 0.0f);
+    ImU32 LabelCol = IM_COL32_WHITE;
+    // Lays the labels out once instead of every frame when set
+    TextLayoutCache *LabelCache = nullptr;
+};
+
+// Bulk versions of ImDrawList::AddRect*/AddCircle*: the exact vertex and index count is reserved once per 60000
+// vertices and every shape is written from one outline template, instead of a path per call. Looks the same as
+// the per-call functions (anti-aliasing follows the draw list's flags); circles of a batch all use the segment
+// count of the largest one.
+class ShapeBatch {
+public:
+    static void AddRectsFilled(ImDrawList *drawList, const ShapeSpans &shapes);
+
+    static void AddRects(ImDrawList *drawList, const ShapeSpans &shapes, float thickness = 1.0f);
+
+    static void AddCirclesFilled(ImDrawList *drawList, const ShapeSpans &shapes);
+
+    static void AddCircles(ImDrawList *drawList, const ShapeSpans &shapes, float thickness = 1.0f);
+
+private:
+    // Reused by every call on the thread instead of allocated per call; draw lists may be built on workers
+    static thread_local std::vector<unsigned int> t_Indices;
+    static thread_local std::vector<float> t_UnitX;
+    static thread_local std::vector<float> t_UnitY;
+
+    static void AddShapes(ImDrawList *drawList, const ShapeSpans &shapes, const ShapeOutline &outline,
+                          const float *unitX, const float *unitY, bool rect);
+
+    static void AddCircleShapes(ImDrawList *drawList, const ShapeSpans &shapes, float thickness, bool filled);
+
+    static void AddLabels(ImDrawList *drawList, const ShapeSpans &shapes);
+};
+
+#endif //ANDROIDIMGUI_SHAPEBATCH_H
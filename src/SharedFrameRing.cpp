@@ -0,0 +1,264 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <new>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SharedFrameRing.h"
+
+static constexpr uint32_t kRingMagic = 0x47524941; // "AIRG"
+static constexpr uint32_t kRingVersion = 1;
+static constexpr uint32_t kRecordPadding = 1u << 0;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring positions must be lock-free across processes");
+
+struct SharedRingHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t VertexSize;
+    uint32_t IndexSize;
+    uint64_t Capacity;
+    std::atomic<uint32_t> ProducerClosed;
+    std::atomic<uint32_t> ResyncRequested;
+    std::atomic<uint64_t> DroppedFrames;
+    // Each on its own cache line, written by one side only
+    alignas(64) std::atomic<uint64_t> WritePosition;
+    alignas(64) std::atomic<uint64_t> ReadPosition;
+};
+
+static constexpr size_t kDataOffset = (sizeof(SharedRingHeader) + 63) & ~(size_t) 63;
+
+// Precedes every record; Size excludes this header and keeps the next record 8-byte aligned
+struct RingRecord {
+    uint32_t Size;
+    uint32_t Flags;
+};
+
+static inline size_t AlignUp(size_t value) {
+    return (value + 7) & ~(size_t) 7;
+}
+
+SharedFrameRing::~SharedFrameRing() {
+    Close();
+}
+
+bool SharedFrameRing::Map(int fd, size_t size) {
+    void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    m_Header = (SharedRingHeader *) map;
+    m_Data = (uint8_t *) map + kDataOffset;
+    m_MappingSize = size;
+    return true;
+}
+
+bool SharedFrameRing::Create(const char *path, size_t capacity) {
+    Close();
+    capacity = AlignUp(capacity);
+    // A new file, so a consumer still attached to the old one never sees it shrink under its mapping
+    unlink(path);
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 || ftruncate(fd, (off_t) (kDataOffset + capacity)) != 0) {
+        fprintf(stderr, "SharedFrameRing: can't create %s\n", path);
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    if (!Map(fd, kDataOffset + capacity)) {
+        fprintf(stderr, "SharedFrameRing: can't map %s\n", path);
+        return false;
+    }
+    new(m_Header) SharedRingHeader{};
+    m_Header->Version = kRingVersion;
+    m_Header->VertexSize = sizeof(ImDrawVert);
+    m_Header->IndexSize = sizeof(ImDrawIdx);
+    m_Header->Capacity = capacity;
+    // Last, so a consumer opening right now doesn't accept a half-initialized ring
+    __atomic_store_n(&m_Header->Magic, kRingMagic, __ATOMIC_RELEASE);
+    m_Producer = true;
+    return true;
+}
+
+bool SharedFrameRing::Open(const char *path) {
+    Close();
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "SharedFrameRing: can't open %s\n", path);
+        return false;
+    }
+    struct stat st = {};
+    fstat(fd, &st);
+    if ((size_t) st.st_size < kDataOffset || !Map(fd, (size_t) st.st_size)) {
+        if ((size_t) st.st_size < kDataOffset)
+            close(fd);
+        fprintf(stderr, "SharedFrameRing: can't map %s\n", path);
+        return false;
+    }
+    if (__atomic_load_n(&m_Header->Magic, __ATOMIC_ACQUIRE) != kRingMagic || m_Header->Version != kRingVersion ||
+        m_Header->VertexSize != sizeof(ImDrawVert) || m_Header->IndexSize != sizeof(ImDrawIdx) ||
+        kDataOffset + m_Header->Capacity > m_MappingSize) {
+        fprintf(stderr, "SharedFrameRing: %s is not a compatible ring\n", path);
+        Close();
+        return false;
+    }
+    // Textures created before we attached are only sent again on request
+    m_Header->ResyncRequested.store(1, std::memory_order_release);
+    return true;
+}
+
+void SharedFrameRing::Close() {
+    if (!m_Header)
+        return;
+    if (m_Producer)
+        m_Header->ProducerClosed.store(1, std::memory_order_release);
+    munmap(m_Header, m_MappingSize);
+    m_Header = nullptr;
+    m_Data = nullptr;
+    m_MappingSize = 0;
+    m_Producer = false;
+}
+
+uint8_t *SharedFrameRing::Reserve(size_t size, int timeoutMs) {
+    const uint64_t capacity = m_Header->Capacity;
+    const size_t needed = sizeof(RingRecord) + AlignUp(size);
+    if (needed > capacity || AlignUp(size) > UINT32_MAX) {
+        fprintf(stderr, "SharedFrameRing: %zu byte frame doesn't fit a %llu byte ring\n", size,
+                (unsigned long long) capacity);
+        return nullptr;
+    }
+
+    uint64_t write = m_Header->WritePosition.load(std::memory_order_relaxed);
+    const size_t tail = (size_t) (capacity - write % capacity);
+    const size_t required = needed + (tail < needed ? tail : 0);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (capacity - (write - m_Header->ReadPosition.load(std::memory_order_acquire)) < required) {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return nullptr;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    if (tail < needed) {
+        auto *padding = (RingRecord *) (m_Data + write % capacity);
+        padding->Size = (uint32_t) (tail - sizeof(RingRecord));
+        padding->Flags = kRecordPadding;
+        write += tail;
+    }
+    auto *record = (RingRecord *) (m_Data + write % capacity);
+    record->Size = (uint32_t) AlignUp(size);
+    record->Flags = 0;
+    m_PendingEnd = write + needed;
+    return (uint8_t *) (record + 1);
+}
+
+void SharedFrameRing::Commit() {
+    m_Header->WritePosition.store(m_PendingEnd, std::memory_order_release);
+}
+
+void SharedFrameRing::CountDroppedFrame() {
+    m_Header->DroppedFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool SharedFrameRing::TakeResyncRequest() {
+    return m_Header->ResyncRequested.exchange(0, std::memory_order_acq_rel) != 0;
+}
+
+const uint8_t *SharedFrameRing::Next(uint64_t &position, size_t &size) {
+    const uint64_t capacity = m_Header->Capacity;
+    const uint64_t write = m_Header->WritePosition.load(std::memory_order_acquire);
+    while (position < write) {
+        const auto *record = (const RingRecord *) (m_Data + position % capacity);
+        if (record->Size > capacity - sizeof(RingRecord)) {
+            // Not something the producer wrote, give up on everything published so far
+            position = write;
+            return nullptr;
+        }
+        position += sizeof(RingRecord) + record->Size;
+        if (!(record->Flags & kRecordPadding)) {
+            size = record->Size;
+            return (const uint8_t *) (record + 1);
+        }
+    }
+    return nullptr;
+}
+
+void SharedFrameRing::Release(uint64_t position) {
+    m_Header->ReadPosition.store(position, std::memory_order_release);
+}
+
+bool SharedFrameRing::Wait(uint64_t position, int timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (m_Header->WritePosition.load(std::memory_order_acquire) <= position) {
+        if (IsProducerClosed() || std::chrono::steady_clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+uint64_t SharedFrameRing::GetReadPosition() const {
+    return m_Header->ReadPosition.load(std::memory_order_acquire);
+}
+
+uint64_t SharedFrameRing::GetDroppedFrames() const {
+    return m_Header ? m_Header->DroppedFrames.load(std::memory_order_relaxed) : 0;
+}
+
+bool SharedFrameRing::IsProducerClosed() const {
+    return !m_Header || m_Header->ProducerClosed.load(std::memory_order_acquire) != 0;
+}
+
+// --- SharedFrameConsumer ---
+
+bool SharedFrameConsumer::Open(const char *path) {
+    if (!m_Ring.Open(path))
+        return false;
+    m_Position = m_Ring.GetReadPosition();
+    m_Skipped = 0;
+    return true;
+}
+
+void SharedFrameConsumer::Close() {
+    m_Replay.Close();
+    m_Ring.Close();
+}
+
+ImDrawData *SharedFrameConsumer::Acquire(int timeoutMs) {
+    if (!m_Ring.Wait(m_Position, timeoutMs))
+        return nullptr;
+
+    const uint8_t *latest = nullptr;
+    uint64_t latestStart = m_Position;
+    uint64_t position = m_Position;
+    for (;;) {
+        uint64_t start = position;
+        size_t size = 0;
+        const uint8_t *frame = m_Ring.Next(position, size);
+        if (!frame)
+            break;
+        if (!DrawDataRecorder::IsFrame(frame, size))
+            continue;
+        if (latest) {
+            m_Replay.SkipFrame(latest);
+            m_Skipped++;
+        }
+        latest = frame;
+        latestStart = start;
+    }
+    m_Position = position;
+    if (!latest) {
+        m_Ring.Release(position);
+        return nullptr;
+    }
+    // Skipped frames were copied out already, only the newest one is still borrowed from the ring
+    m_Ring.Release(latestStart);
+    return m_Replay.DecodeFrame(latest);
+}
+
+void SharedFrameConsumer::Release() {
+    m_Replay.FrameRendered();
+    m_Ring.Release(m_Position);
+}
@@ -0,0 +1,96 @@
+#ifndef ANDROIDIMGUI_SHAREDFRAMERING_H
+#define ANDROIDIMGUI_SHAREDFRAMERING_H
+
+#include <cstddef>
+#include <cstdint>
+#include "DrawDataCapture.h"
+
+struct SharedRingHeader;
+
+// Single-producer single-consumer ring of serialized frames (DrawDataRecorder::EncodeFrame) in a file mapped by two
+// processes, e.g. under /dev/shm or /data/local/tmp. Positions only grow; a record never wraps, the tail of the
+// ring it doesn't fit in is skipped. No locks: each side owns one position and publishes it with release stores.
+class SharedFrameRing {
+public:
+    ~SharedFrameRing();
+
+    // Producer: creates or resets the file
+    bool Create(const char *path, size_t capacity);
+
+    // Consumer: attaches to a ring a producer created, starting after everything it already consumed
+    bool Open(const char *path);
+
+    void Close();
+
+    // Producer: room for size bytes, waiting up to timeoutMs for the consumer to free it. nullptr when it didn't
+    // (or the frame can never fit); the frame is then dropped.
+    uint8_t *Reserve(size_t size, int timeoutMs);
+
+    // Producer: publishes the record from the last Reserve
+    void Commit();
+
+    void CountDroppedFrame();
+
+    // Producer: true once after the consumer asked for every texture again (it attached late or restarted)
+    bool TakeResyncRequest();
+
+    // Consumer: next record after position, which is moved past it; nullptr when the producer hasn't written more
+    const uint8_t *Next(uint64_t &position, size_t &size);
+
+    // Consumer: everything before position may be overwritten
+    void Release(uint64_t position);
+
+    // Consumer: waits until there is a record after position or the producer closed
+    bool Wait(uint64_t position, int timeoutMs);
+
+    uint64_t GetReadPosition() const;
+
+    uint64_t GetDroppedFrames() const;
+
+    bool IsProducerClosed() const;
+
+    size_t GetMappingSize() const { return m_MappingSize; }
+
+private:
+    bool Map(int fd, size_t size);
+
+    SharedRingHeader *m_Header = nullptr;
+    uint8_t *m_Data = nullptr;
+    size_t m_MappingSize = 0;
+    bool m_Producer = false;
+    uint64_t m_PendingEnd = 0;
+};
+
+// Receiving side of SharedMemoryGraphics: replays the newest frame through any backend with RenderDrawData.
+class SharedFrameConsumer {
+public:
+    bool Open(const char *path);
+
+    void Close();
+
+    // Newest published frame; older pending frames only contribute their texture events and count as dropped.
+    // nullptr when nothing arrived within timeoutMs. Valid until Release.
+    ImDrawData *Acquire(int timeoutMs);
+
+    // Call once the frame from Acquire has been rendered, frees its space in the ring
+    void Release();
+
+    // Empty frame releasing every texture, see DrawDataReplay::ShutdownFrame; render it, then call Release
+    ImDrawData *ShutdownFrame() { return m_Replay.ShutdownFrame(); }
+
+    // Frames skipped here because the producer was ahead
+    uint64_t GetSkippedFrames() const { return m_Skipped; }
+
+    // Frames the producer dropped because the ring stayed full
+    uint64_t GetDroppedFrames() const { return m_Ring.GetDroppedFrames(); }
+
+    bool IsProducerClosed() const { return m_Ring.IsProducerClosed(); }
+
+private:
+    SharedFrameRing m_Ring;
+    DrawDataReplay m_Replay;
+    uint64_t m_Position = 0;
+    uint64_t m_Skipped = 0;
+};
+
+#endif //ANDROIDIMGUI_SHAREDFRAMERING_H
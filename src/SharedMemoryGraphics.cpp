@@ -0,0 +1,100 @@
+#include <cstdio>
+#include "SharedMemoryGraphics.h"
+#include "imgui.h"
+
+SharedMemoryGraphics::SharedMemoryGraphics(const char *path, size_t capacity, int timeoutMs)
+        : m_Path(path), m_Capacity(capacity), m_TimeoutMs(timeoutMs) {
+}
+
+bool SharedMemoryGraphics::Create() {
+    return m_Ring.Create(m_Path.c_str(), m_Capacity);
+}
+
+void SharedMemoryGraphics::Setup() {
+    ImGuiIO &io = ImGui::GetIO();
+    io.BackendRendererName = "imgui_impl_shared_memory";
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures | ImGuiBackendFlags_RendererHasVtxOffset;
+}
+
+void SharedMemoryGraphics::PrepareFrame(bool resize) {
+}
+
+void SharedMemoryGraphics::Render(ImDrawData *drawData) {
+    if (!drawData)
+        return;
+
+    // Serialized in place: one pass to size the record, one to write it into the ring
+    bool resync = m_Resync || m_Ring.TakeResyncRequest();
+    size_t size = DrawDataRecorder::EncodeFrame(drawData, nullptr, resync);
+    if (uint8_t *out = m_Ring.Reserve(size, m_TimeoutMs)) {
+        DrawDataRecorder::EncodeFrame(drawData, out, resync);
+        m_Ring.Commit();
+        m_Resync = false;
+    } else {
+        m_Ring.CountDroppedFrame();
+        m_Resync = true;
+    }
+
+    // The consumer owns the GPU side, ImGui only needs its requests answered
+    if (drawData->Textures == nullptr)
+        return;
+    for (ImTextureData *tex: *drawData->Textures) {
+        if (tex->Status == ImTextureStatus_WantCreate) {
+            tex->SetTexID((ImTextureID) (intptr_t) tex);
+            tex->SetStatus(ImTextureStatus_OK);
+        } else if (tex->Status == ImTextureStatus_WantUpdates) {
+            tex->SetStatus(ImTextureStatus_OK);
+        } else if (tex->Status == ImTextureStatus_WantDestroy && tex->UnusedFrames > 0) {
+            tex->SetTexID(ImTextureID_Invalid);
+            tex->SetStatus(ImTextureStatus_Destroyed);
+        }
+    }
+}
+
+void SharedMemoryGraphics::PrepareShutdown() {
+    for (ImTextureData *tex: ImGui::GetPlatformIO().Textures) {
+        tex->SetTexID(ImTextureID_Invalid);
+        tex->SetStatus(ImTextureStatus_Destroyed);
+    }
+    ImGuiIO &io = ImGui::GetIO();
+    io.BackendRendererName = nullptr;
+    io.BackendFlags &= ~(ImGuiBackendFlags_RendererHasTextures | ImGuiBackendFlags_RendererHasVtxOffset);
+}
+
+void SharedMemoryGraphics::Cleanup() {
+    m_Ring.Close();
+}
+
+BaseTexData *SharedMemoryGraphics::LoadTexture(BaseTexData *tex_data, void *pixel_data) {
+    fprintf(stderr, "SharedMemoryGraphics: textures can't be loaded on the UI side\n");
+    return nullptr;
+}
+
+void SharedMemoryGraphics::RemoveTexture(BaseTexData *tex_data) {
+}
+
+BaseTexData *SharedMemoryGraphics::CreateRenderTarget(int width, int height) {
+    return nullptr;
+}
+
+bool SharedMemoryGraphics::RenderToTarget(BaseTexData *target, ImDrawData *drawData) {
+    return false;
+}
+
+void SharedMemoryGraphics::RemoveRenderTarget(BaseTexData *target) {
+}
+
+TextureMemory SharedMemoryGraphics::GetTextureMemory(BaseTexData *tex_data) {
+    return {};
+}
+
+void SharedMemoryGraphics::ReportMemory(MemoryReport &report) {
+    report.Bytes[MemoryReport::STAGING] += m_Ring.GetMappingSize();
+}
+
+void SharedMemoryGraphics::TrimMemory(TrimLevel level, const std::vector<BaseTexData *> &textures) {
+}
+
+void SharedMemoryGraphics::RenderShapes(const ShapeFrame &frame, int firstShape, int shapeCount,
+                                        const ImVec4 &clipRect) {
+}
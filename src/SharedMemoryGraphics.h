@@ -0,0 +1,42 @@
+#ifndef ANDROIDIMGUI_SHAREDMEMORYGRAPHICS_H
+#define ANDROIDIMGUI_SHAREDMEMORYGRAPHICS_H
+
+#include <string>
+#include "AndroidImgui.h"
+#include "SharedFrameRing.h"
+
+// UI side of cross-process rendering: every frame is serialized straight into a shared ring instead of being
+// drawn, a SharedFrameConsumer in another process renders it. Init with a null window. When the consumer falls
+// behind EndFrame waits up to timeoutMs, then drops the frame and resends all textures with the next one.
+// Like captures, this carries neither analytic shapes nor images from LoadTexture*.
+class SharedMemoryGraphics : public AndroidImgui {
+public:
+    explicit SharedMemoryGraphics(const char *path, size_t capacity = 32 << 20, int timeoutMs = 16);
+
+    uint64_t GetDroppedFrames() const { return m_Ring.GetDroppedFrames(); }
+
+private:
+    bool Create() override;
+    void Setup() override;
+    void PrepareFrame(bool resize) override;
+    void Render(ImDrawData *drawData) override;
+    void PrepareShutdown() override;
+    void Cleanup() override;
+    BaseTexData *LoadTexture(BaseTexData *tex_data, void *pixel_data) override;
+    void RemoveTexture(BaseTexData *tex_data) override;
+    BaseTexData *CreateRenderTarget(int width, int height) override;
+    bool RenderToTarget(BaseTexData *target, ImDrawData *drawData) override;
+    void RemoveRenderTarget(BaseTexData *target) override;
+    TextureMemory GetTextureMemory(BaseTexData *tex_data) override;
+    void ReportMemory(MemoryReport &report) override;
+    void TrimMemory(TrimLevel level, const std::vector<BaseTexData *> &textures) override;
+    void RenderShapes(const ShapeFrame &frame, int firstShape, int shapeCount, const ImVec4 &clipRect) override;
+
+    std::string m_Path;
+    size_t m_Capacity;
+    int m_TimeoutMs;
+    SharedFrameRing m_Ring;
+    bool m_Resync = false;
+};
+
+#endif //ANDROIDIMGUI_SHAREDMEMORYGRAPHICS_H
@@ -1,5 +1,8 @@
+#ifdef __ANDROID__
 #include <android/native_window.h>
 #include <android/log.h>
+#endif
+#include <cstdio>
 #include <cstring>
 #include <cmath>
 #include <algorithm>
@@ -7,8 +10,13 @@
 #include "imgui.h"
 
 #define SW_LOG_TAG "SoftwareGraphics"
+#ifdef __ANDROID__
 #define SW_LOGI(...) __android_log_print(ANDROID_LOG_INFO, SW_LOG_TAG, __VA_ARGS__)
 #define SW_LOGE(...) __android_log_print(ANDROID_LOG_ERROR, SW_LOG_TAG, __VA_ARGS__)
+#else
+#define SW_LOGI(...) (fprintf(stdout, SW_LOG_TAG ": " __VA_ARGS__), fputc('\n', stdout))
+#define SW_LOGE(...) (fprintf(stderr, SW_LOG_TAG ": " __VA_ARGS__), fputc('\n', stderr))
+#endif
 
 // --- Helpers ---
 
@@ -48,7 +56,10 @@ static inline uint32_t PackRGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
 bool SoftwareGraphics::Create() {
     m_FbWidth = (int)m_Width;
     m_FbHeight = (int)m_Height;
-    ANativeWindow_setBuffersGeometry(m_Window, m_FbWidth, m_FbHeight, WINDOW_FORMAT_RGBA_8888);
+#ifdef __ANDROID__
+    if (m_Window)
+        ANativeWindow_setBuffersGeometry(m_Window, m_FbWidth, m_FbHeight, WINDOW_FORMAT_RGBA_8888);
+#endif
     m_Framebuffer.resize(m_FbWidth * m_FbHeight, 0);
     SW_LOGI("Software renderer created: %dx%d", m_FbWidth, m_FbHeight);
     return true;
@@ -65,7 +76,10 @@ void SoftwareGraphics::PrepareFrame(bool resize) {
     if (resize) {
         m_FbWidth = (int)m_Width;
         m_FbHeight = (int)m_Height;
-        ANativeWindow_setBuffersGeometry(m_Window, m_FbWidth, m_FbHeight, WINDOW_FORMAT_RGBA_8888);
+#ifdef __ANDROID__
+        if (m_Window)
+            ANativeWindow_setBuffersGeometry(m_Window, m_FbWidth, m_FbHeight, WINDOW_FORMAT_RGBA_8888);
+#endif
         m_Framebuffer.resize(m_FbWidth * m_FbHeight);
     }
     // Clear framebuffer to transparent black
@@ -73,44 +87,31 @@ void SoftwareGraphics::PrepareFrame(bool resize) {
 }
 
 void SoftwareGraphics::Render(ImDrawData *drawData) {
-    if (!drawData || drawData->CmdListsCount == 0)
+    if (!drawData)
         return;
+    if (drawData->CmdListsCount == 0) {
+        // Texture requests still need an answer, e.g. destroys with nothing left to draw
+        UpdateTextures(drawData);
+    } else {
+        RasterizeDrawData(drawData);
+        Present();
+    }
 
-    // Catch up with texture updates (mirrors ImGui_ImplOpenGL3_RenderDrawData pattern)
-    if (drawData->Textures != nullptr)
-        for (ImTextureData *tex : *drawData->Textures)
-            if (tex->Status != ImTextureStatus_OK)
-                SoftwareUpdateTexture(tex);
-
-    for (int n = 0; n < drawData->CmdListsCount; n++) {
-        const ImDrawList *cmdList = drawData->CmdLists[n];
-        const ImDrawVert *vtxBuffer = cmdList->VtxBuffer.Data;
-        const ImDrawIdx *idxBuffer = cmdList->IdxBuffer.Data;
-
-        for (int cmdIdx = 0; cmdIdx < cmdList->CmdBuffer.Size; cmdIdx++) {
-            const ImDrawCmd &pcmd = cmdList->CmdBuffer[cmdIdx];
-
-            if (pcmd.UserCallback) {
-                pcmd.UserCallback(cmdList, &pcmd);
-                continue;
-            }
-
-            const auto *tex = (const SoftwareTextureData *)(intptr_t)pcmd.GetTexID();
-            ImVec4 clipRect = pcmd.ClipRect;
-
-            for (unsigned int i = 0; i < pcmd.ElemCount; i += 3) {
-                const ImDrawVert &v0 = vtxBuffer[idxBuffer[pcmd.IdxOffset + i + 0]];
-                const ImDrawVert &v1 = vtxBuffer[idxBuffer[pcmd.IdxOffset + i + 1]];
-                const ImDrawVert &v2 = vtxBuffer[idxBuffer[pcmd.IdxOffset + i + 2]];
-
-                RenderTriangle(
-                    v0.pos, v1.pos, v2.pos,
-                    v0.uv, v1.uv, v2.uv,
-                    v0.col, v1.col, v2.col,
-                    tex, clipRect);
-            }
-        }
+    // The frame is already in memory, a copy is all a capture takes
+    if (IsCaptureRequested()) {
+        BeginCapture();
+        CapturedImage image;
+        image.Width = m_FbWidth;
+        image.Height = m_FbHeight;
+        image.Pixels = m_Framebuffer;
+        FinishCapture(std::move(image), false, false);
     }
+}
+
+void SoftwareGraphics::Present() {
+#ifdef __ANDROID__
+    if (!m_Window)
+        return;
 
     // Blit framebuffer to ANativeWindow
     ANativeWindow_Buffer buffer;
@@ -126,6 +127,7 @@ void SoftwareGraphics::Render(ImDrawData *drawData) {
     } else {
         SW_LOGE("Failed to lock ANativeWindow");
     }
+#endif
 }
 
 void SoftwareGraphics::PrepareShutdown() {
@@ -161,11 +163,127 @@ BaseTexData *SoftwareGraphics::LoadTexture(BaseTexData *tex, void *pixel_data) {
     return texData;
 }
 
+bool SoftwareGraphics::UpdateTexture(BaseTexData *tex, const void *pixel_data, int x, int y, int width, int height) {
+    auto *texData = (SoftwareTextureData *)tex;
+    for (int row = y; row < y + height; row++) {
+        size_t offset = (size_t)row * texData->Width + x;
+        memcpy(texData->Pixels.data() + offset, (const unsigned char *)pixel_data + offset * 4, (size_t)width * 4);
+    }
+    return true;
+}
+
 void SoftwareGraphics::RemoveTexture(BaseTexData *tex) {
     auto *texData = (SoftwareTextureData *)tex;
     delete texData;
 }
 
+BaseTexData *SoftwareGraphics::CreateRenderTarget(int width, int height) {
+    auto *texData = new SoftwareTextureData();
+    texData->Width = width;
+    texData->Height = height;
+    texData->Channels = 4;
+    texData->TexWidth = width;
+    texData->TexHeight = height;
+    texData->Pixels.resize(width * height);
+    texData->DS = (void *)texData;
+    return texData;
+}
+
+bool SoftwareGraphics::RenderToTarget(BaseTexData *target, ImDrawData *drawData) {
+    auto *texData = (SoftwareTextureData *)target;
+
+    // Rasterize straight into the target pixels by swapping them in as the framebuffer
+    std::swap(m_Framebuffer, texData->Pixels);
+    std::swap(m_FbWidth, texData->TexWidth);
+    std::swap(m_FbHeight, texData->TexHeight);
+    memset(m_Framebuffer.data(), 0, m_Framebuffer.size() * sizeof(uint32_t));
+    RasterizeDrawData(drawData);
+    std::swap(m_Framebuffer, texData->Pixels);
+    std::swap(m_FbWidth, texData->TexWidth);
+    std::swap(m_FbHeight, texData->TexHeight);
+    return true;
+}
+
+void SoftwareGraphics::RemoveRenderTarget(BaseTexData *target) {
+    RemoveTexture(target);
+}
+
+TextureMemory SoftwareGraphics::GetTextureMemory(BaseTexData *tex_data) {
+    TextureMemory memory;
+    memory.Cpu = ((SoftwareTextureData *) tex_data)->Pixels.capacity() * sizeof(uint32_t);
+    return memory;
+}
+
+void SoftwareGraphics::ReportMemory(MemoryReport &report) {
+    report.Bytes[MemoryReport::FRAMEBUFFER] += m_Framebuffer.capacity() * sizeof(uint32_t);
+    if (m_Window)
+        report.Bytes[MemoryReport::FRAMEBUFFER] +=
+                (size_t) MemoryReport::kEstimatedWindowBuffers * m_FbWidth * m_FbHeight * sizeof(uint32_t);
+}
+
+void SoftwareGraphics::TrimMemory(TrimLevel level, const std::vector<BaseTexData *> &textures) {
+    // Left over from a larger window size
+    m_Framebuffer.shrink_to_fit();
+    for (BaseTexData *tex: textures)
+        ((SoftwareTextureData *) tex)->Pixels.shrink_to_fit();
+}
+
+void SoftwareGraphics::UpdateTextures(ImDrawData *drawData) {
+    // Catch up with texture updates (mirrors ImGui_ImplOpenGL3_RenderDrawData pattern)
+    if (drawData->Textures != nullptr)
+        for (ImTextureData *tex : *drawData->Textures)
+            if (tex->Status != ImTextureStatus_OK)
+                SoftwareUpdateTexture(tex);
+}
+
+void SoftwareGraphics::RasterizeDrawData(ImDrawData *drawData) {
+    UpdateTextures(drawData);
+
+    // Framebuffer origin is drawData->DisplayPos (non-zero when rendering into an offscreen target)
+    const float offX = drawData->DisplayPos.x;
+    const float offY = drawData->DisplayPos.y;
+    m_RasterOffX = offX;
+    m_RasterOffY = offY;
+    m_Premultiplied = false;
+
+    for (int n = 0; n < drawData->CmdListsCount; n++) {
+        const ImDrawList *cmdList = drawData->CmdLists[n];
+        const ImDrawVert *vtxBuffer = cmdList->VtxBuffer.Data;
+        const ImDrawIdx *idxBuffer = cmdList->IdxBuffer.Data;
+
+        for (int cmdIdx = 0; cmdIdx < cmdList->CmdBuffer.Size; cmdIdx++) {
+            const ImDrawCmd &pcmd = cmdList->CmdBuffer[cmdIdx];
+
+            if (pcmd.UserCallback) {
+                // The blend mode is the only state kept between commands
+                if (pcmd.UserCallback == ImDrawCallback_ResetRenderState)
+                    m_Premultiplied = false;
+                else
+                    pcmd.UserCallback(cmdList, &pcmd);
+                continue;
+            }
+
+            const auto *tex = (const SoftwareTextureData *)(intptr_t)pcmd.GetTexID();
+            ImVec4 clipRect(pcmd.ClipRect.x - offX, pcmd.ClipRect.y - offY,
+                            pcmd.ClipRect.z - offX, pcmd.ClipRect.w - offY);
+
+            for (unsigned int i = 0; i < pcmd.ElemCount; i += 3) {
+                const ImDrawVert &v0 = vtxBuffer[idxBuffer[pcmd.IdxOffset + i + 0]];
+                const ImDrawVert &v1 = vtxBuffer[idxBuffer[pcmd.IdxOffset + i + 1]];
+                const ImDrawVert &v2 = vtxBuffer[idxBuffer[pcmd.IdxOffset + i + 2]];
+
+                RenderTriangle(
+                    ImVec2(v0.pos.x - offX, v0.pos.y - offY),
+                    ImVec2(v1.pos.x - offX, v1.pos.y - offY),
+                    ImVec2(v2.pos.x - offX, v2.pos.y - offY),
+                    v0.uv, v1.uv, v2.uv,
+                    v0.col, v1.col, v2.col,
+                    tex, clipRect);
+            }
+        }
+    }
+}
+
 // --- Software texture management (mirrors ImGui_ImplOpenGL3_UpdateTexture) ---
 
 void SoftwareGraphics::SoftwareDestroyTexture(ImTextureData *tex) {
@@ -301,6 +419,9 @@ void SoftwareGraphics::RenderTriangle(
     // === Optimization 4: Check if all 3 vertex colors are identical (common case: flat color) ===
     const bool flatColor = (col0 == col1 && col1 == col2);
 
+    // Premultiplied sources (render targets) already carry their alpha in the colour
+    const bool premultiplied = m_Premultiplied;
+
     // Framebuffer pointer
     uint32_t *fb = m_Framebuffer.data();
     const int fbWidth = m_FbWidth;
@@ -371,9 +492,16 @@ void SoftwareGraphics::RenderTriangle(
                     uint32_t da = (dst >> 24) & 0xFF;
 
                     uint32_t invSa = 255 - sa;
-                    uint32_t outR = div255(sr * sa + dr * invSa);
-                    uint32_t outG = div255(sg * sa + dg * invSa);
-                    uint32_t outB = div255(sb * sa + db * invSa);
+                    uint32_t outR, outG, outB;
+                    if (premultiplied) {
+                        outR = std::min(sr + div255(dr * invSa), 255u);
+                        outG = std::min(sg + div255(dg * invSa), 255u);
+                        outB = std::min(sb + div255(db * invSa), 255u);
+                    } else {
+                        outR = div255(sr * sa + dr * invSa);
+                        outG = div255(sg * sa + dg * invSa);
+                        outB = div255(sb * sa + db * invSa);
+                    }
                     uint32_t outA = sa + div255(da * invSa);
 
                     fbRow[x] = (outA << 24) | (outB << 16) | (outG << 8) | outR;
@@ -391,6 +519,79 @@ void SoftwareGraphics::RenderTriangle(
     }
 }
 
+// --- Analytic shapes ---
+
+void SoftwareGraphics::RenderShapes(const ShapeFrame &frame, int firstShape, int shapeCount, const ImVec4 &clipRect) {
+    ImVec4 clip(clipRect.x - m_RasterOffX, clipRect.y - m_RasterOffY,
+                clipRect.z - m_RasterOffX, clipRect.w - m_RasterOffY);
+    for (int i = 0; i < shapeCount; i++) {
+        RenderShape(&frame.Vertices[(firstShape + i) * 4], clip);
+    }
+}
+
+void SoftwareGraphics::RenderShape(const ShapeVertex *quad, const ImVec4 &clipRect) {
+    float x0 = quad[0].X - m_RasterOffX, y0 = quad[0].Y - m_RasterOffY;
+    float minXf = x0, minYf = y0, maxXf = x0, maxYf = y0;
+    for (int i = 1; i < 4; i++) {
+        minXf = std::min(minXf, quad[i].X - m_RasterOffX);
+        minYf = std::min(minYf, quad[i].Y - m_RasterOffY);
+        maxXf = std::max(maxXf, quad[i].X - m_RasterOffX);
+        maxYf = std::max(maxYf, quad[i].Y - m_RasterOffY);
+    }
+
+    int minX = imaxVal((int)minXf, imaxVal((int)clipRect.x, 0));
+    int minY = imaxVal((int)minYf, imaxVal((int)clipRect.y, 0));
+    int maxX = iminVal((int)maxXf, iminVal((int)clipRect.z - 1, m_FbWidth - 1));
+    int maxY = iminVal((int)maxYf, iminVal((int)clipRect.w - 1, m_FbHeight - 1));
+    if (minX > maxX || minY > maxY)
+        return;
+
+    // The quad is an affine image of the local box: local = local0 + M * (p - p0), M from edges 0->1 and 0->3
+    const float e1x = quad[1].X - quad[0].X, e1y = quad[1].Y - quad[0].Y;
+    const float e3x = quad[3].X - quad[0].X, e3y = quad[3].Y - quad[0].Y;
+    const float det = e1x * e3y - e1y * e3x;
+    if (det == 0.0f)
+        return;
+    const float invDet = 1.0f / det;
+    const float l1x = quad[1].LocalX - quad[0].LocalX, l1y = quad[1].LocalY - quad[0].LocalY;
+    const float l3x = quad[3].LocalX - quad[0].LocalX, l3y = quad[3].LocalY - quad[0].LocalY;
+    const float m00 = (l1x * e3y - l3x * e1y) * invDet;
+    const float m01 = (l3x * e1x - l1x * e3x) * invDet;
+    const float m10 = (l1y * e3y - l3y * e1y) * invDet;
+    const float m11 = (l3y * e1x - l1y * e3x) * invDet;
+
+    const float halfW = quad[0].HalfWidth;
+    const float halfH = quad[0].HalfHeight;
+    const float radius = quad[0].Radius;
+    const float halfStroke = quad[0].Stroke * 0.5f;
+    uint8_t cr, cg, cb, ca;
+    UnpackColor(quad[0].Col, cr, cg, cb, ca);
+
+    for (int y = minY; y <= maxY; y++) {
+        const float py = (float)y + 0.5f - y0;
+        uint32_t *fbRow = m_Framebuffer.data() + y * m_FbWidth;
+        for (int x = minX; x <= maxX; x++) {
+            const float px = (float)x + 0.5f - x0;
+            const float lx = quad[0].LocalX + m00 * px + m01 * py;
+            const float ly = quad[0].LocalY + m10 * px + m11 * py;
+
+            // Rounded box signed distance, negative inside
+            const float qx = std::fabs(lx) - halfW + radius;
+            const float qy = std::fabs(ly) - halfH + radius;
+            const float ox = std::max(qx, 0.0f);
+            const float oy = std::max(qy, 0.0f);
+            float d = std::sqrt(ox * ox + oy * oy) + std::min(std::max(qx, qy), 0.0f) - radius;
+            if (halfStroke > 0.0f)
+                d = std::fabs(d) - halfStroke;
+
+            const float coverage = fclamp(0.5f - d, 0.0f, 1.0f);
+            if (coverage <= 0.0f)
+                continue;
+            fbRow[x] = BlendPixel(fbRow[x], PackRGBA(cr, cg, cb, (uint8_t)(ca * coverage + 0.5f)));
+        }
+    }
+}
+
 uint32_t SoftwareGraphics::SampleTexture(const SoftwareTextureData *tex, float u, float v) {
     u = fclamp(u, 0.0f, 1.0f);
     v = fclamp(v, 0.0f, 1.0f);
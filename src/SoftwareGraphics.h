@@ -5,19 +5,28 @@
 #include <cstdint>
 #include <vector>
 #include "imgui.h"
+#include "AnalyticShapes.h"
 
 class SoftwareGraphics : public AndroidImgui {
 public:
     struct SoftwareTextureData : BaseTexData {
-        std::vector<uint32_t> Pixels; // RGBA8888 CPU-side pixel data
+        PixelBuffer Pixels; // RGBA8888 CPU-side pixel data
         int TexWidth = 0;
         int TexHeight = 0;
     };
 
-private:
-    std::vector<uint32_t> m_Framebuffer;
+protected:
+    PixelBuffer m_Framebuffer;
     int m_FbWidth = 0;
     int m_FbHeight = 0;
+    // DisplayPos of the draw data being rasterized, for shape callbacks
+    float m_RasterOffX = 0.0f;
+    float m_RasterOffY = 0.0f;
+    // Set by BlendPremultiplied until the next ImDrawCallback_ResetRenderState
+    bool m_Premultiplied = false;
+
+    // Copies m_Framebuffer to the window, no-op when headless
+    void Present();
 
 public:
     bool Create() override;
@@ -27,9 +36,23 @@ public:
     void PrepareShutdown() override;
     void Cleanup() override;
     BaseTexData *LoadTexture(BaseTexData *tex_data, void *pixel_data) override;
+    bool UpdateTexture(BaseTexData *tex_data, const void *pixel_data, int x, int y, int width, int height) override;
     void RemoveTexture(BaseTexData *tex_data) override;
+    BaseTexData *CreateRenderTarget(int width, int height) override;
+    bool RenderToTarget(BaseTexData *target, ImDrawData *drawData) override;
+    void RemoveRenderTarget(BaseTexData *target) override;
+    void RenderShapes(const ShapeFrame &frame, int firstShape, int shapeCount, const ImVec4 &clipRect) override;
+    void BlendPremultiplied() override { m_Premultiplied = true; }
+    TextureMemory GetTextureMemory(BaseTexData *tex_data) override;
+    void ReportMemory(MemoryReport &report) override;
+    void TrimMemory(TrimLevel level, const std::vector<BaseTexData *> &textures) override;
+    bool CanCapture() override { return true; }
 
 private:
+    void UpdateTextures(ImDrawData *drawData);
+
+    void RasterizeDrawData(ImDrawData *drawData);
+
     void SoftwareUpdateTexture(ImTextureData *tex);
     void SoftwareDestroyTexture(ImTextureData *tex);
 
@@ -40,6 +63,8 @@ private:
         const SoftwareTextureData *tex,
         const ImVec4 &clipRect);
 
+    void RenderShape(const ShapeVertex *quad, const ImVec4 &clipRect);
+
     static uint32_t BlendPixel(uint32_t dst, uint32_t src);
     static uint32_t SampleTexture(const SoftwareTextureData *tex, float u, float v);
     static uint32_t MultiplyColor(uint32_t texel, uint32_t vertColor);
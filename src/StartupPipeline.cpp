@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include "StartupPipeline.h"
+#include "AndroidImgui.h"
+#include "my_imgui.h"
+#include "stb_image.h"
+#include "ThreadPool.h"
+
+StartupPipeline::StartupPipeline(AndroidImgui *owner, StartupOptions options, float fontScale)
+        : m_Owner(owner), m_Options(std::move(options)), m_Start(Clock::now()) {
+    m_Images.resize(m_Options.Textures.size());
+    m_TexturesLeft = (int) m_Images.size();
+    // Device and font in parallel, then the textures on whatever cores remain
+    int cores = std::max((int) std::thread::hardware_concurrency() - 1, 1);
+    m_Pool = std::make_unique<ThreadPool>(std::min(2 + (int) m_Images.size(), std::max(cores, 2)));
+
+    m_Pool->Post([this] {
+        bool ok = m_Owner->CreateDevice();
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_DeviceOk = ok;
+        m_DeviceDone = true;
+        m_DeviceMs = Elapsed();
+        m_Done.notify_all();
+    });
+    m_Pool->Post([this, fontScale] {
+        if (m_Options.FontSize > 0.0f)
+            BuildFontAtlas(fontScale);
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_FontDone = true;
+        m_FontMs = Elapsed();
+        m_Done.notify_all();
+    });
+    for (size_t i = 0; i < m_Images.size(); i++) {
+        m_Pool->Post([this, i] {
+            Image &image = m_Images[i];
+            image.Pixels = stbi_load(m_Options.Textures[i].c_str(), &image.Width, &image.Height, nullptr, 4);
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_TexturesLeft--;
+            m_TexturesMs = Elapsed();
+            m_Done.notify_all();
+        });
+    }
+}
+
+StartupPipeline::~StartupPipeline() {
+    m_Pool.reset();
+    for (Image &image: m_Images) {
+        if (image.Pixels)
+            stbi_image_free(image.Pixels);
+    }
+    IM_DELETE(m_Atlas);
+    free(m_FontData);
+}
+
+double StartupPipeline::Elapsed() const {
+    return std::chrono::duration<double, std::milli>(Clock::now() - m_Start).count();
+}
+
+void StartupPipeline::BuildFontAtlas(float fontScale) {
+    m_FontData = ImGui::Android_ReadSystemFont(&m_FontDataSize);
+    if (!m_FontData) {
+        fprintf(stderr, "StartupPipeline: no system font\n");
+        return;
+    }
+    // Nothing else sees this atlas until Init hands it to ImGui::CreateContext
+    m_Atlas = IM_NEW(ImFontAtlas)();
+    ImFontConfig config;
+    config.FontDataOwnedByAtlas = false;
+    config.SizePixels = m_Options.FontSize;
+    m_Font = m_Atlas->AddFontFromMemoryTTF(m_FontData, (int) m_FontDataSize, m_Options.FontSize, &config);
+    if (!m_Font) {
+        fprintf(stderr, "StartupPipeline: can't load the system font\n");
+        IM_DELETE(m_Atlas);
+        m_Atlas = nullptr;
+        return;
+    }
+    if (!m_Options.PrebakeRanges)
+        return;
+    // At the size the UI will ask for, so the first frame finds the glyphs in place
+    ImFontBaked *baked = m_Font->GetFontBaked(m_Options.FontSize * fontScale);
+    for (const ImWchar *range = m_Options.PrebakeRanges; range[0]; range += 2) {
+        for (unsigned int c = range[0]; c <= range[1]; c++)
+            baked->FindGlyph((ImWchar) c);
+    }
+}
+
+bool StartupPipeline::WaitDevice() {
+    std::unique_lock<std::mutex> lock(m_Lock);
+    m_Done.wait(lock, [this] { return m_DeviceDone; });
+    return m_DeviceOk;
+}
+
+ImFontAtlas *StartupPipeline::WaitFontAtlas(ImFont **font) {
+    std::unique_lock<std::mutex> lock(m_Lock);
+    m_Done.wait(lock, [this] { return m_FontDone; });
+    *font = m_Font;
+    return m_Atlas;
+}
+
+std::vector<BaseTexData *> StartupPipeline::UploadTextures() {
+    {
+        std::unique_lock<std::mutex> lock(m_Lock);
+        m_Done.wait(lock, [this] { return m_TexturesLeft == 0; });
+    }
+    std::vector<BaseTexData *> textures(m_Images.size());
+    for (size_t i = 0; i < m_Images.size(); i++) {
+        Image &image = m_Images[i];
+        if (!image.Pixels) {
+            fprintf(stderr, "StartupPipeline: can't load %s\n", m_Options.Textures[i].c_str());
+            continue;
+        }
+        textures[i] = m_Owner->LoadTextureData([&image](BaseTexData *tex_data) {
+            tex_data->Width = image.Width;
+            tex_data->Height = image.Height;
+            return std::exchange(image.Pixels, nullptr);
+        });
+        if (textures[i])
+            m_Owner->m_TextureSources[textures[i]] = m_Options.Textures[i];
+    }
+    return textures;
+}
+
+void StartupPipeline::GetTimings(StartupTimings &timings) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    timings.DeviceMs = m_DeviceMs;
+    timings.FontMs = m_FontMs;
+    timings.TexturesMs = m_TexturesMs;
+}
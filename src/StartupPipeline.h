@@ -0,0 +1,81 @@
+#ifndef ANDROIDIMGUI_STARTUPPIPELINE_H
+#define ANDROIDIMGUI_STARTUPPIPELINE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "imgui.h"
+#include "StartupTimings.h"
+
+class AndroidImgui;
+class ThreadPool;
+struct BaseTexData;
+
+struct StartupOptions {
+    // > 0: the system CJK font at this size becomes the default font, its atlas built on a worker
+    float FontSize = 0.0f;
+    // Glyphs baked into that atlas before the first frame, e.g. ImGui::GetGlyphRangesChineseSimplifiedOfficial()
+    const ImWchar *PrebakeRanges = nullptr;
+    // Decoded on workers, uploaded by the first NewFrame
+    std::vector<std::string> Textures;
+};
+
+// Work of AndroidImgui::StartInit, running on its own workers until the first frame
+class StartupPipeline {
+public:
+    StartupPipeline(AndroidImgui *owner, StartupOptions options, float fontScale);
+
+    // Waits for the workers, then frees the atlas: after ImGui::DestroyContext
+    ~StartupPipeline();
+
+    bool WaitDevice();
+
+    // The atlas for ImGui::CreateContext and its font, nullptr without a font or when it couldn't be built
+    ImFontAtlas *WaitFontAtlas(ImFont **font);
+
+    // Uploads the decoded textures in StartupOptions order, nullptr where decoding failed. UI thread
+    std::vector<BaseTexData *> UploadTextures();
+
+    // Worker phases into timings
+    void GetTimings(StartupTimings &timings);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Image {
+        int Width = 0;
+        int Height = 0;
+        unsigned char *Pixels = nullptr;
+    };
+
+    void BuildFontAtlas(float fontScale);
+
+    double Elapsed() const;
+
+    AndroidImgui *m_Owner;
+    StartupOptions m_Options;
+    Clock::time_point m_Start;
+
+    std::mutex m_Lock;
+    std::condition_variable m_Done;
+    bool m_DeviceDone = false;
+    bool m_DeviceOk = false;
+    bool m_FontDone = false;
+    int m_TexturesLeft = 0;
+    double m_DeviceMs = 0.0;
+    double m_FontMs = 0.0;
+    double m_TexturesMs = 0.0;
+
+    void *m_FontData = nullptr;
+    size_t m_FontDataSize = 0;
+    ImFontAtlas *m_Atlas = nullptr;
+    ImFont *m_Font = nullptr;
+    std::vector<Image> m_Images;
+
+    std::unique_ptr<ThreadPool> m_Pool;
+};
+
+#endif //ANDROIDIMGUI_STARTUPPIPELINE_H
@@ -0,0 +1,23 @@
+#ifndef ANDROIDIMGUI_STARTUPTIMINGS_H
+#define ANDROIDIMGUI_STARTUPTIMINGS_H
+
+// Milliseconds. Without StartInit only the Init phases are filled and SurfaceMs includes the device
+struct StartupTimings {
+    double DeviceMs = 0.0;    // CreateDevice, worker
+    double FontMs = 0.0;      // font file, atlas and prebaked glyphs, worker
+    double TexturesMs = 0.0;  // until every startup texture was decoded, workers
+    double CallerMs = 0.0;    // StartInit to Init: the application's own setup, e.g. JNI and the window
+    double SurfaceMs = 0.0;   // Create: surface and swapchain
+    double ContextMs = 0.0;   // ImGui context and platform layer
+    double SetupMs = 0.0;     // backend Setup
+    double InitWaitMs = 0.0;  // Init blocked on the device and the atlas
+    double FrameWaitMs = 0.0; // first NewFrame blocked on the textures, plus uploading them
+    double TotalMs = 0.0;     // StartInit (or Init) to the end of the first NewFrame's join
+
+    // The same phases one after another
+    double SerialMs() const {
+        return DeviceMs + FontMs + TexturesMs + CallerMs + SurfaceMs + ContextMs + SetupMs;
+    }
+};
+
+#endif //ANDROIDIMGUI_STARTUPTIMINGS_H
@@ -0,0 +1,523 @@
+#include "imgui_internal.h"
+#ifdef __ANDROID__
+#include <android/native_window.h>
+#include "my_imgui_impl_android.h"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "SwitchableGraphics.h"
+#include "AnalyticShapes.h"
+#include "BackendProbe.h"
+#include "WindowRenderCache.h"
+#include "my_imgui.h"
+#include "stb_image.h"
+
+SwitchableGraphics::SwitchableGraphics(GraphicsManager::GraphicsAPI api)
+    : m_Api(api), m_Active(GraphicsManager::getGraphicsInterface(api)), m_StartupTarget(api) {}
+
+SwitchableGraphics::~SwitchableGraphics() {
+    JoinWorker();
+}
+
+void SwitchableGraphics::SetStartupTarget(GraphicsManager::GraphicsAPI target, float systemFontSize) {
+    m_StartupTarget = target;
+    m_HasStartupTarget = target != m_Api;
+    m_FontSize = systemFontSize;
+    m_KeepPixels = m_HasStartupTarget;
+}
+
+void SwitchableGraphics::SetAutoSelect(const char *cachePath) {
+    m_AutoSelect = true;
+    m_AutoCachePath = cachePath;
+    m_KeepPixels = true;
+}
+
+void SwitchableGraphics::Attach(AndroidImgui *backend) {
+    backend->m_Window = m_Window;
+    backend->m_Width = m_Width;
+    backend->m_Height = m_Height;
+}
+
+void SwitchableGraphics::JoinWorker() {
+    if (m_Worker.joinable())
+        m_Worker.join();
+}
+
+bool SwitchableGraphics::Create() {
+    if (!m_Active)
+        return false;
+    Attach(m_Active.get());
+    if (!m_Active->Create())
+        return false;
+
+    if (m_HasStartupTarget) {
+        m_Pending = GraphicsManager::getGraphicsInterface(m_StartupTarget);
+        if (m_Pending)
+            Attach(m_Pending.get());
+    }
+    if (m_AutoSelect) {
+        for (auto api: {GraphicsManager::SOFTWARE, GraphicsManager::OPENGL, GraphicsManager::VULKAN}) {
+            if (api == m_Api)
+                continue;
+            Candidate candidate{api, GraphicsManager::getGraphicsInterface(api)};
+            if (!candidate.Backend)
+                continue;
+            Attach(candidate.Backend.get());
+            m_Candidates.push_back(std::move(candidate));
+        }
+    }
+
+    if (m_Pending || m_AutoSelect) {
+        m_WorkerDone = false;
+        m_Worker = std::thread([this] {
+            if (m_Pending)
+                m_PendingOk = m_Pending->CreateDevice();
+            // Capability probe: a backend whose device can't be created is never switched to
+            for (auto &candidate: m_Candidates)
+                candidate.Ok = candidate.Backend->CreateDevice();
+            if (m_Pending && m_FontSize > 0.0f)
+                m_FontData = ImGui::Android_ReadSystemFont(&m_FontDataSize);
+            m_WorkerDone.store(true, std::memory_order_release);
+        });
+    }
+    return true;
+}
+
+void SwitchableGraphics::Setup() {
+    m_Active->Setup();
+}
+
+void SwitchableGraphics::PrepareFrame(bool resize) {
+    // Between frames, before ImGui::NewFrame, so the atlas and draw lists hold nothing of the old backend
+    if (m_Worker.joinable() && m_WorkerDone.load(std::memory_order_acquire)) {
+        JoinWorker();
+        if (m_Pending)
+            FinishStartup();
+        // The initial backend is measured first
+        m_Probing = m_AutoSelect;
+        m_ProbeFrame = 0;
+        m_ProbeResults.clear();
+    }
+    if (m_ProbeAdvance) {
+        m_ProbeAdvance = false;
+        NextProbe();
+    }
+    if (!m_Failed)
+        m_Active->PrepareFrame(resize);
+}
+
+void SwitchableGraphics::FinishStartup() {
+    std::unique_ptr<AndroidImgui> next = std::move(m_Pending);
+    if (!m_PendingOk || !SwitchTo(next, m_StartupTarget)) {
+        fprintf(stderr, "SwitchableGraphics: staying on backend %d\n", (int) m_Api);
+        if (next)
+            next->Cleanup();
+    }
+
+    if (m_FontData) {
+        ImFont *font = ImGui::Android_AddSystemFont(m_FontData, m_FontDataSize, m_FontSize);
+        if (font)
+            ImGui::GetIO().FontDefault = font;
+    }
+
+    if (!m_AutoSelect)
+        DropPixelCache();
+}
+
+void SwitchableGraphics::DropPixelCache() {
+    m_KeepPixels = false;
+    if (m_PersistentPixels)
+        return;
+    for (auto &entry: m_Entries) {
+        entry.Pixels.clear();
+        entry.Pixels.shrink_to_fit();
+    }
+}
+
+void SwitchableGraphics::ProbeFrame() {
+    int frame = m_ProbeFrame++;
+    if (frame < kProbeWarmupFrames)
+        return;
+    if (frame < kProbeWarmupFrames + kProbeFrames) {
+        double ms = MeasureWorkload();
+        if (ms < 0.0) {
+            fprintf(stderr, "SwitchableGraphics: backend %d can't run the probe\n", (int) m_Api);
+            m_ProbeSamples.clear();
+            m_ProbeAdvance = true;
+            return;
+        }
+        m_ProbeSamples.push_back(ms);
+        return;
+    }
+
+    // Recorded one frame after the last measurement, which on Vulkan begins the next frame's command buffer, so the
+    // backend is never switched away in the middle of a frame
+    std::sort(m_ProbeSamples.begin(), m_ProbeSamples.end());
+    m_ProbeResults.push_back({m_Api, m_ProbeSamples[m_ProbeSamples.size() / 2]});
+    m_ProbeSamples.clear();
+    m_ProbeAdvance = true;
+}
+
+double SwitchableGraphics::MeasureWorkload() {
+    if (!m_ProbeList) {
+        m_ProbeList = std::make_unique<ImDrawList>(ImGui::GetDrawListSharedData());
+        BackendProbe::BuildWorkload(m_ProbeList.get(), m_Width, m_Height);
+    }
+    if (!m_ProbeTarget)
+        m_ProbeTarget = m_Active->CreateRenderTarget((int) m_Width, (int) m_Height);
+    if (!m_ProbeTarget)
+        return -1.0;
+
+    ImDrawData drawData;
+    drawData.Valid = true;
+    drawData.CmdLists.push_back(m_ProbeList.get());
+    drawData.CmdListsCount = 1;
+    drawData.TotalVtxCount = m_ProbeList->VtxBuffer.Size;
+    drawData.TotalIdxCount = m_ProbeList->IdxBuffer.Size;
+    drawData.DisplayPos = ImVec2(0.0f, 0.0f);
+    drawData.DisplaySize = ImVec2(m_Width, m_Height);
+    drawData.FramebufferScale = ImVec2(1.0f, 1.0f);
+
+    // Untimed pass: lazily created pipelines and, on Vulkan, waiting for the next swapchain image
+    if (!m_Active->RenderToTarget(m_ProbeTarget, &drawData))
+        return -1.0;
+    m_Active->WaitIdle();
+
+    auto start = std::chrono::steady_clock::now();
+    m_Active->RenderToTarget(m_ProbeTarget, &drawData);
+    m_Active->WaitIdle();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SwitchableGraphics::ReleaseProbeTarget() {
+    if (m_ProbeTarget)
+        m_Active->RemoveRenderTarget(m_ProbeTarget);
+    m_ProbeTarget = nullptr;
+}
+
+void SwitchableGraphics::NextProbe() {
+    ReleaseProbeTarget();
+    while (!m_Candidates.empty()) {
+        Candidate candidate = std::move(m_Candidates.front());
+        m_Candidates.erase(m_Candidates.begin());
+        if (candidate.Ok && SwitchTo(candidate.Backend, candidate.Api)) {
+            m_ProbeFrame = 0;
+            return;
+        }
+        candidate.Backend->Cleanup();
+    }
+    FinishProbe();
+}
+
+void SwitchableGraphics::FinishProbe() {
+    m_Probing = false;
+    m_ProbeList.reset();
+
+    GraphicsManager::GraphicsAPI best = m_Api;
+    double bestMs = -1.0;
+    bool gpuMeasured = false;
+    for (auto &result: m_ProbeResults) {
+        if (bestMs < 0.0 || result.Ms < bestMs) {
+            best = result.Api;
+            bestMs = result.Ms;
+        }
+        gpuMeasured |= result.Api != GraphicsManager::SOFTWARE;
+    }
+
+    // The winner was torn down when the probe moved on, its device is created again here once
+    if (best != m_Api) {
+        std::unique_ptr<AndroidImgui> next = GraphicsManager::getGraphicsInterface(best);
+        if (next && !SwitchTo(next, best))
+            next->Cleanup();
+    }
+    if (gpuMeasured)
+        BackendProbe::SaveDecision(m_AutoCachePath.c_str(), m_Api);
+    else
+        fprintf(stderr, "SwitchableGraphics: no GPU backend could be measured, the choice isn't saved\n");
+    DropPixelCache();
+}
+
+void SwitchableGraphics::ReleaseInnerTextures() {
+    for (auto &entry: m_Entries) {
+        if (entry.Inner)
+            m_Active->RemoveTexture(entry.Inner);
+        entry.Inner = nullptr;
+        entry.Handle->DS = nullptr;
+    }
+}
+
+// Pixels dropped by TrimMemory are decoded again from the file they came from
+bool SwitchableGraphics::ReloadPixels(TextureEntry &entry) {
+    auto source = m_TextureSources.find(entry.Handle);
+    if (source == m_TextureSources.end())
+        return false;
+    int width, height;
+    unsigned char *pixels = stbi_load(source->second.c_str(), &width, &height, nullptr, entry.Handle->Channels);
+    if (!pixels)
+        return false;
+    if (width == entry.Handle->Width && height == entry.Handle->Height)
+        entry.Pixels.assign(pixels, pixels + (size_t) width * height * entry.Handle->Channels);
+    stbi_image_free(pixels);
+    return !entry.Pixels.empty();
+}
+
+bool SwitchableGraphics::Start(AndroidImgui *backend) {
+    Attach(backend);
+    if (!backend->Create())
+        return false;
+    backend->Setup();
+    for (auto &entry: m_Entries) {
+        if (entry.Pixels.empty() && !ReloadPixels(entry)) {
+            fprintf(stderr, "SwitchableGraphics: texture %dx%d has no cached pixels\n", entry.Handle->Width,
+                    entry.Handle->Height);
+            continue;
+        }
+        BaseTexData desc{};
+        desc.Width = entry.Handle->Width;
+        desc.Height = entry.Handle->Height;
+        desc.Channels = entry.Handle->Channels;
+        entry.Inner = backend->LoadTexture(&desc, entry.Pixels.data());
+        if (entry.Inner)
+            *entry.Handle = *entry.Inner;
+    }
+    return true;
+}
+
+// The old backend goes away first: a window has one producer at a time
+bool SwitchableGraphics::SwitchTo(std::unique_ptr<AndroidImgui> &next, GraphicsManager::GraphicsAPI api) {
+    ANativeWindow *previousWindow = m_Window;
+    ANativeWindow *window = m_Window;
+#ifdef __ANDROID__
+    if (m_Window && m_Api == GraphicsManager::SOFTWARE && api != GraphicsManager::SOFTWARE) {
+        window = m_SurfaceProvider ? m_SurfaceProvider() : nullptr;
+        if (!window) {
+            fprintf(stderr, "SwitchableGraphics: no new surface to leave the software backend\n");
+            return false;
+        }
+        ANativeWindow_acquire(window);
+    }
+#endif
+
+    if (m_WindowCache)
+        m_WindowCache->Clear();
+    ReleaseInnerTextures();
+    if (!m_Failed) {
+        m_Active->PrepareShutdown();
+        m_Active->Cleanup();
+    }
+
+    // On failure next stays with the caller to be cleaned up and m_Active is brought back
+    m_Window = window;
+    bool started = Start(next.get());
+    m_Window = previousWindow;
+#ifdef __ANDROID__
+    if (window != previousWindow) {
+        ANativeWindow_release(started ? previousWindow : window);
+        if (started) {
+            m_Window = window;
+            My_ImGui_ImplAndroid_Init(window);
+        }
+    }
+#endif
+    if (!started) {
+        if (m_Failed || !Start(m_Active.get())) {
+            // Nothing renders, ImGui keeps its texture requests for the next backend
+            fprintf(stderr, "SwitchableGraphics: backend %d can't be restored either\n", (int) m_Api);
+            ImGui::GetIO().BackendFlags |= ImGuiBackendFlags_RendererHasTextures;
+            m_Failed = true;
+        }
+        return false;
+    }
+    m_Active = std::move(next);
+    m_Api = api;
+    m_Failed = false;
+    m_Shapes->SetSupported(m_Active->m_Shapes->IsSupported());
+    return true;
+}
+
+bool SwitchableGraphics::SwitchBackend(GraphicsManager::GraphicsAPI api) {
+    if (api == m_Api)
+        return true;
+    ImGuiContext *context = ImGui::GetCurrentContext();
+    if (api == GraphicsManager::AUTO || !context || context->WithinFrameScope || IsSwitchPending())
+        return false;
+
+    std::unique_ptr<AndroidImgui> next = GraphicsManager::getGraphicsInterface(api);
+    if (!next)
+        return false;
+    if (SwitchTo(next, api))
+        return true;
+    next->Cleanup();
+    return false;
+}
+
+void SwitchableGraphics::Render(ImDrawData *drawData) {
+    if (m_Failed)
+        return;
+    // The active backend reads the frame back and runs the callbacks
+    if (CanCapture() && IsCaptureRequested()) {
+        std::scoped_lock lock(m_CaptureLock, m_Active->m_CaptureLock);
+        for (CaptureCallback &callback: m_CaptureRequests)
+            m_Active->m_CaptureRequests.push_back(std::move(callback));
+        m_CaptureRequests.clear();
+    }
+    m_Active->Render(drawData);
+    if (m_Probing && !m_ProbeAdvance)
+        ProbeFrame();
+}
+
+void SwitchableGraphics::PrepareShutdown() {
+    JoinWorker();
+    if (m_Pending) {
+        m_Pending->Cleanup();
+        m_Pending.reset();
+    }
+    for (auto &candidate: m_Candidates)
+        candidate.Backend->Cleanup();
+    m_Candidates.clear();
+    // Registered with the context's shared draw list data, must go before ImGui::DestroyContext
+    m_Probing = false;
+    m_ProbeList.reset();
+    ReleaseProbeTarget();
+    if (!m_Failed)
+        m_Active->PrepareShutdown();
+}
+
+void SwitchableGraphics::Cleanup() {
+    if (!m_Failed)
+        m_Active->Cleanup();
+    m_Failed = false;
+    // The atlas references the font data until ImGui::DestroyContext, which runs before Cleanup
+    free(m_FontData);
+    m_FontData = nullptr;
+    m_FontDataSize = 0;
+}
+
+BaseTexData *SwitchableGraphics::LoadTexture(BaseTexData *tex_data, void *pixel_data) {
+    if (m_Failed)
+        return nullptr;
+    BaseTexData *inner = m_Active->LoadTexture(tex_data, pixel_data);
+    if (!inner)
+        return nullptr;
+
+    TextureEntry entry;
+    entry.Handle = new BaseTexData(*inner);
+    entry.Inner = inner;
+    if (m_KeepPixels || m_PersistentPixels) {
+        auto *pixels = (unsigned char *) pixel_data;
+        entry.Pixels.assign(pixels, pixels + (size_t) tex_data->Width * tex_data->Height * tex_data->Channels);
+    }
+    m_Entries.push_back(std::move(entry));
+    return m_Entries.back().Handle;
+}
+
+bool SwitchableGraphics::UpdateTexture(BaseTexData *tex_data, const void *pixel_data, int x, int y, int width,
+                                       int height) {
+    for (TextureEntry &entry: m_Entries) {
+        if (entry.Handle != tex_data)
+            continue;
+        auto *pixels = (const unsigned char *) pixel_data;
+        size_t size = (size_t) tex_data->Width * tex_data->Height * tex_data->Channels;
+        if (entry.Pixels.size() == size) {
+            size_t stride = (size_t) tex_data->Width * tex_data->Channels;
+            for (int row = y; row < y + height; row++) {
+                size_t offset = row * stride + (size_t) x * tex_data->Channels;
+                memcpy(entry.Pixels.data() + offset, pixels + offset, (size_t) width * tex_data->Channels);
+            }
+        } else if (m_KeepPixels || m_PersistentPixels) {
+            entry.Pixels.assign(pixels, pixels + size);
+        }
+        if (m_Failed)
+            return false;
+        if (entry.Inner)
+            return m_Active->UpdateTexture(entry.Inner, pixel_data, x, y, width, height);
+        // Lost by a switch without cached pixels, these bring it back
+        BaseTexData desc;
+        desc.Width = tex_data->Width;
+        desc.Height = tex_data->Height;
+        desc.Channels = tex_data->Channels;
+        entry.Inner = m_Active->LoadTexture(&desc, (void *) pixel_data);
+        if (!entry.Inner)
+            return false;
+        *entry.Handle = *entry.Inner;
+        return true;
+    }
+    return false;
+}
+
+void SwitchableGraphics::RemoveTexture(BaseTexData *tex_data) {
+    for (auto it = m_Entries.begin(); it != m_Entries.end(); ++it) {
+        if (it->Handle != tex_data)
+            continue;
+        if (it->Inner)
+            m_Active->RemoveTexture(it->Inner);
+        delete it->Handle;
+        m_Entries.erase(it);
+        return;
+    }
+}
+
+// Render targets belong to WindowRenderCache, which is cleared before every switch
+BaseTexData *SwitchableGraphics::CreateRenderTarget(int width, int height) {
+    if (m_Failed)
+        return nullptr;
+    return m_Active->CreateRenderTarget(width, height);
+}
+
+bool SwitchableGraphics::RenderToTarget(BaseTexData *target, ImDrawData *drawData) {
+    return m_Active->RenderToTarget(target, drawData);
+}
+
+void SwitchableGraphics::RemoveRenderTarget(BaseTexData *target) {
+    m_Active->RemoveRenderTarget(target);
+}
+
+void SwitchableGraphics::RenderShapes(const ShapeFrame &frame, int firstShape, int shapeCount,
+                                      const ImVec4 &clipRect) {
+    if (m_Failed)
+        return;
+    m_Active->RenderShapes(frame, firstShape, shapeCount, clipRect);
+    // The helpers ask the context's instance, which is this one
+    if (!m_Active->m_Shapes->IsSupported())
+        m_Shapes->SetSupported(false);
+}
+
+TextureMemory SwitchableGraphics::GetTextureMemory(BaseTexData *tex_data) {
+    for (auto &entry: m_Entries) {
+        if (entry.Handle != tex_data)
+            continue;
+        TextureMemory memory = entry.Inner ? m_Active->GetTextureMemory(entry.Inner) : TextureMemory();
+        memory.Cpu += entry.Pixels.capacity();
+        return memory;
+    }
+    // Render targets are the inner backend's own
+    if (m_Failed)
+        return TextureMemory();
+    return m_Active->GetTextureMemory(tex_data);
+}
+
+void SwitchableGraphics::ReportMemory(MemoryReport &report) {
+    if (m_Failed)
+        return;
+    if (m_ProbeTarget)
+        report.Bytes[MemoryReport::FRAMEBUFFER] += m_Active->GetTextureMemory(m_ProbeTarget).Total();
+    m_Active->ReportMemory(report);
+}
+
+void SwitchableGraphics::TrimMemory(TrimLevel level, const std::vector<BaseTexData *> &textures) {
+    std::vector<BaseTexData *> inner;
+    for (auto &entry: m_Entries) {
+        if (entry.Inner)
+            inner.push_back(entry.Inner);
+        // Kept for switches, ReloadPixels brings them back from the file
+        if (level == TRIM_COMPLETE && !m_KeepPixels && m_TextureSources.count(entry.Handle)) {
+            entry.Pixels.clear();
+            entry.Pixels.shrink_to_fit();
+        }
+    }
+    if (!m_Failed)
+        m_Active->TrimMemory(level, inner);
+}
@@ -0,0 +1,182 @@
+#ifndef ANDROIDIMGUI_SWITCHABLEGRAPHICS_H
+#define ANDROIDIMGUI_SWITCHABLEGRAPHICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GraphicsManager.h"
+
+struct ImDrawList;
+
+// Forwards to an inner backend that can be replaced between frames without losing the ImGui context. Textures
+// handed out are stable copies whose DS/UVs are rewritten when the inner backend changes.
+class SwitchableGraphics : public AndroidImgui {
+public:
+    struct ProbeResult {
+        GraphicsManager::GraphicsAPI Api;
+        double Ms; // median time of BackendProbe's workload
+    };
+
+    explicit SwitchableGraphics(GraphicsManager::GraphicsAPI api);
+
+    ~SwitchableGraphics() override;
+
+    // Call before Init. Frames render with the initial backend while a worker thread creates the device of target
+    // and, with systemFontSize > 0, reads the system font; both are swapped in at the first frame after that.
+    void SetStartupTarget(GraphicsManager::GraphicsAPI target, float systemFontSize = 0.0f);
+
+    // Call before Init. Once the worker has created the devices of the other backends, each available backend renders
+    // a few frames while BackendProbe's workload is timed on it; the fastest one stays and is saved to cachePath.
+    // Nothing is saved unless a GPU backend was measured, so a run that couldn't leave SOFTWARE probes again.
+    void SetAutoSelect(const char *cachePath);
+
+    // SoftwareGraphics connects the window as a CPU producer, which only the Surface's destruction undoes, so EGL and
+    // Vulkan can't use that window afterwards. A switch from software to a GPU backend asks provider for a new window
+    // (recreate the app's Surface); like with Init, the caller keeps its own reference. Without a provider, or when it
+    // returns nullptr, such a switch fails and the software backend stays
+    void SetSurfaceProvider(GraphicsManager::SurfaceProvider provider) { m_SurfaceProvider = std::move(provider); }
+
+    // Keeps the decoded pixels of textures loaded from now on, so SwitchBackend can upload them again
+    void SetKeepPixels(bool keep) { m_PersistentPixels = keep; }
+
+    // Between EndFrame and NewFrame: tears the current backend down and brings api up under the same ImGui context.
+    // BaseTexData handles stay valid with new DS/UVs, the font atlas is re-created from ImGui's own copy. Textures
+    // loaded without SetKeepPixels come back with a null DS. On failure the previous backend is restored; if that
+    // fails too, IsFailed turns true: frames are still built but not drawn and no textures load until a later
+    // SwitchBackend succeeds.
+    bool SwitchBackend(GraphicsManager::GraphicsAPI api);
+
+    bool IsFailed() const { return m_Failed; }
+
+    bool IsSwitchPending() const { return m_Pending != nullptr || m_Probing || m_Worker.joinable(); }
+
+    GraphicsManager::GraphicsAPI GetBackend() const { return m_Api; }
+
+    // Backends timed by the SetAutoSelect probe in probe order, complete once IsSwitchPending turns false
+    const std::vector<ProbeResult> &GetProbeResults() const { return m_ProbeResults; }
+
+private:
+    struct Candidate {
+        GraphicsManager::GraphicsAPI Api;
+        std::unique_ptr<AndroidImgui> Backend;
+        bool Ok = false;
+    };
+
+    static constexpr int kProbeWarmupFrames = 3;
+    // One timed pass per frame: backends size their per-frame geometry for two probe passes (VulkanGraphics)
+    static constexpr int kProbeFrames = 15;
+
+    struct TextureEntry {
+        BaseTexData *Handle = nullptr;
+        BaseTexData *Inner = nullptr;
+        std::vector<unsigned char> Pixels;
+    };
+
+    GraphicsManager::GraphicsAPI m_Api;
+    std::unique_ptr<AndroidImgui> m_Active;
+    // m_Active is torn down and couldn't be brought back
+    bool m_Failed = false;
+    GraphicsManager::SurfaceProvider m_SurfaceProvider;
+    std::vector<TextureEntry> m_Entries;
+    // Pixels are needed to upload textures again after a switch, kept while one is planned or for good
+    bool m_KeepPixels = false;
+    bool m_PersistentPixels = false;
+
+    GraphicsManager::GraphicsAPI m_StartupTarget;
+    bool m_HasStartupTarget = false;
+    std::unique_ptr<AndroidImgui> m_Pending;
+    std::thread m_Worker;
+    std::atomic<bool> m_WorkerDone{false};
+    bool m_PendingOk = false;
+
+    bool m_AutoSelect = false;
+    std::string m_AutoCachePath;
+    std::vector<Candidate> m_Candidates;
+    bool m_Probing = false;
+    bool m_ProbeAdvance = false;
+    int m_ProbeFrame = 0;
+    std::vector<double> m_ProbeSamples;
+    std::vector<ProbeResult> m_ProbeResults;
+    std::unique_ptr<ImDrawList> m_ProbeList;
+    BaseTexData *m_ProbeTarget = nullptr;
+
+    float m_FontSize = 0.0f;
+    void *m_FontData = nullptr;
+    size_t m_FontDataSize = 0;
+
+    void Attach(AndroidImgui *backend);
+
+    void FinishStartup();
+
+    void DropPixelCache();
+
+    void ProbeFrame();
+
+    double MeasureWorkload();
+
+    void NextProbe();
+
+    void FinishProbe();
+
+    void ReleaseProbeTarget();
+
+    bool SwitchTo(std::unique_ptr<AndroidImgui> &next, GraphicsManager::GraphicsAPI api);
+
+    bool Start(AndroidImgui *backend);
+
+    void ReleaseInnerTextures();
+
+    bool ReloadPixels(TextureEntry &entry);
+
+    void JoinWorker();
+
+    bool Create() override;
+
+    void Setup() override;
+
+    void PrepareFrame(bool resize) override;
+
+    void Render(ImDrawData *drawData) override;
+
+    void PrepareShutdown() override;
+
+    void Cleanup() override;
+
+    BaseTexData *LoadTexture(BaseTexData *tex_data, void *pixel_data) override;
+
+    bool UpdateTexture(BaseTexData *tex_data, const void *pixel_data, int x, int y, int width, int height) override;
+
+    void RemoveTexture(BaseTexData *tex_data) override;
+
+    BaseTexData *CreateRenderTarget(int width, int height) override;
+
+    bool RenderToTarget(BaseTexData *target, ImDrawData *drawData) override;
+
+    void RemoveRenderTarget(BaseTexData *target) override;
+
+    void WaitIdle() override {
+        if (!m_Failed)
+            m_Active->WaitIdle();
+    }
+
+    void RenderShapes(const ShapeFrame &frame, int firstShape, int shapeCount, const ImVec4 &clipRect) override;
+
+    void BlendPremultiplied() override {
+        if (!m_Failed)
+            m_Active->BlendPremultiplied();
+    }
+
+    TextureMemory GetTextureMemory(BaseTexData *tex_data) override;
+
+    void ReportMemory(MemoryReport &report) override;
+
+    void TrimMemory(TrimLevel level, const std::vector<BaseTexData *> &textures) override;
+
+    bool CanCapture() override { return !m_Failed && m_Active->CanCapture(); }
+};
+
+#endif //ANDROIDIMGUI_SWITCHABLEGRAPHICS_H
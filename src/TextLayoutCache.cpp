@@ -0,0 +1,160 @@
+#include "imgui_internal.h"
+#include <cstring>
+#include "TextLayoutCache.h"
+
+TextLayoutCache::TextLayoutCache(size_t maxBytes) {
+    m_Stats.MaxBytes = maxBytes;
+}
+
+static uint64_t HashText(const ImFont *font, float fontSize, const char *text, const char *textEnd) {
+    // FNV-1a over the key
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void *data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= ((const uint8_t *) data)[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    mix(&font, sizeof(font));
+    mix(&fontSize, sizeof(fontSize));
+    mix(text, (size_t) (textEnd - text));
+    return hash;
+}
+
+const TextLayoutCache::Entry &TextLayoutCache::Find(ImFont *font, float fontSize, const char *text,
+                                                    const char *textEnd) {
+    ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+    if (atlas->TexData && atlas->TexData->UniqueID != m_AtlasTextureId) {
+        Clear();
+        m_AtlasTextureId = atlas->TexData->UniqueID;
+    }
+
+    const size_t length = (size_t) (textEnd - text);
+    const uint64_t hash = HashText(font, fontSize, text, textEnd);
+    auto found = m_Index.find(hash);
+    if (found != m_Index.end()) {
+        Entry &entry = *found->second;
+        if (entry.Font == font && entry.FontSize == fontSize && entry.Text.size() == length &&
+            memcmp(entry.Text.data(), text, length) == 0) {
+            m_Stats.Hits++;
+            m_Entries.splice(m_Entries.begin(), m_Entries, found->second);
+            return entry;
+        }
+        // Hash collision, the newer string takes the slot
+        m_Stats.Bytes -= entry.Bytes;
+        m_Entries.erase(found->second);
+        m_Index.erase(found);
+    }
+
+    m_Stats.Misses++;
+    m_Entries.push_front({hash, font, fontSize, std::string(text, length), ImVec2(0.0f, 0.0f), {}, 0});
+    Entry &entry = m_Entries.front();
+    Layout(entry);
+    if (atlas->TexData && atlas->TexData->UniqueID != m_AtlasTextureId) {
+        // Loading the new glyphs grew the atlas: every other entry is stale, this one was laid out after
+        m_Entries.erase(std::next(m_Entries.begin()), m_Entries.end());
+        m_Index.clear();
+        m_Stats.Bytes = 0;
+        m_AtlasTextureId = atlas->TexData->UniqueID;
+    }
+    m_Index[hash] = m_Entries.begin();
+    m_Stats.Bytes += entry.Bytes;
+    Evict();
+    return entry;
+}
+
+void TextLayoutCache::Layout(Entry &entry) {
+    // Loads missing glyphs, hence UI thread only
+    ImFontBaked *baked = entry.Font->GetFontBaked(entry.FontSize);
+    const float scale = entry.FontSize / baked->Size;
+    const char *text = entry.Text.data();
+    const char *textEnd = text + entry.Text.size();
+
+    float x = 0.0f, y = 0.0f, width = 0.0f;
+    for (const char *s = text; s < textEnd;) {
+        unsigned int c;
+        s += ImTextCharFromUtf8(&c, s, textEnd);
+        if (c == '\n') {
+            width = ImMax(width, x);
+            x = 0.0f;
+            y += entry.FontSize;
+            continue;
+        }
+        if (c == '\r')
+            continue;
+        const ImFontGlyph *glyph = baked->FindGlyph((ImWchar) c);
+        if (!glyph)
+            continue;
+        if (glyph->Visible)
+            entry.Quads.push_back({x + glyph->X0 * scale, y + glyph->Y0 * scale, x + glyph->X1 * scale,
+                                   y + glyph->Y1 * scale, glyph->U0, glyph->V0, glyph->U1, glyph->V1,
+                                   glyph->Colored != 0});
+        x += glyph->AdvanceX * scale;
+    }
+    entry.TextSize = ImVec2(ImMax(width, x), y + entry.FontSize);
+    entry.Quads.shrink_to_fit();
+    entry.Bytes = sizeof(Entry) + entry.Text.capacity() + entry.Quads.capacity() * sizeof(Quad) +
+                  sizeof(decltype(m_Index)::value_type);
+}
+
+void TextLayoutCache::Evict() {
+    // The newest entry stays even when it alone exceeds the limit
+    while (m_Stats.Bytes > m_Stats.MaxBytes && m_Entries.size() > 1) {
+        const Entry &oldest = m_Entries.back();
+        m_Stats.Bytes -= oldest.Bytes;
+        m_Index.erase(oldest.Hash);
+        m_Entries.pop_back();
+    }
+    m_Stats.Entries = (int) m_Entries.size();
+}
+
+ImVec2 TextLayoutCache::CalcTextSize(ImFont *font, float fontSize, const char *text, const char *textEnd) {
+    if (!font)
+        font = ImGui::GetFont();
+    if (fontSize <= 0.0f)
+        fontSize = ImGui::GetFontSize();
+    if (!textEnd)
+        textEnd = text + strlen(text);
+    return Find(font, fontSize, text, textEnd).TextSize;
+}
+
+void TextLayoutCache::AddText(ImDrawList *drawList, ImFont *font, float fontSize, const ImVec2 &pos, ImU32 col,
+                              const char *text, const char *textEnd) {
+    if ((col & IM_COL32_A_MASK) == 0)
+        return;
+    if (!font)
+        font = ImGui::GetFont();
+    if (fontSize <= 0.0f)
+        fontSize = ImGui::GetFontSize();
+    if (!textEnd)
+        textEnd = text + strlen(text);
+    if (text == textEnd)
+        return;
+
+    const Entry &entry = Find(font, fontSize, text, textEnd);
+    if (entry.Quads.empty())
+        return;
+    // Pixel-aligned like ImFont::RenderText
+    const float x = (float) (int) pos.x, y = (float) (int) pos.y;
+    drawList->PrimReserve((int) entry.Quads.size() * 6, (int) entry.Quads.size() * 4);
+    for (const Quad &q: entry.Quads)
+        drawList->PrimRectUV(ImVec2(x + q.X0, y + q.Y0), ImVec2(x + q.X1, y + q.Y1), ImVec2(q.U0, q.V0),
+                             ImVec2(q.U1, q.V1), q.Colored ? (col | ~IM_COL32_A_MASK) : col);
+}
+
+void TextLayoutCache::SetMaxBytes(size_t maxBytes) {
+    m_Stats.MaxBytes = maxBytes;
+    Evict();
+}
+
+void TextLayoutCache::Clear() {
+    m_Entries.clear();
+    m_Index.clear();
+    m_Stats.Bytes = 0;
+    m_Stats.Entries = 0;
+}
+
+void TextLayoutCache::ResetStats() {
+    m_Stats.Hits = 0;
+    m_Stats.Misses = 0;
+}
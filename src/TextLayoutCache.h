@@ -0,0 +1,73 @@
+#ifndef ANDROIDIMGUI_TEXTLAYOUTCACHE_H
+#define ANDROIDIMGUI_TEXTLAYOUTCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "imgui.h"
+
+struct TextCacheStats {
+    uint64_t Hits = 0;
+    uint64_t Misses = 0;
+    size_t Bytes = 0;
+    size_t MaxBytes = 0;
+    int Entries = 0;
+
+    float HitRate() const { return Hits + Misses ? (float) Hits / (float) (Hits + Misses) : 0.0f; }
+};
+
+// Measured size and glyph quads of recently drawn strings, keyed by (font, size, text) and evicted least recently
+// used first once over maxBytes. A hit appends the quads with one translation instead of looking up and laying out
+// every glyph again. Everything is dropped when the atlas texture is recreated, which moves glyph UVs. UI thread.
+class TextLayoutCache {
+public:
+    explicit TextLayoutCache(size_t maxBytes = 256 * 1024);
+
+    // font nullptr / fontSize 0 = the current font / size
+    ImVec2 CalcTextSize(ImFont *font, float fontSize, const char *text, const char *textEnd = nullptr);
+
+    // Same as ImDrawList::AddText without wrapping or CPU clipping, drawList's texture has to be the atlas
+    void AddText(ImDrawList *drawList, ImFont *font, float fontSize, const ImVec2 &pos, ImU32 col,
+                 const char *text, const char *textEnd = nullptr);
+
+    void SetMaxBytes(size_t maxBytes);
+
+    void Clear();
+
+    const TextCacheStats &GetStats() const { return m_Stats; }
+
+    void ResetStats();
+
+private:
+    struct Quad {
+        float X0, Y0, X1, Y1;
+        float U0, V0, U1, V1;
+        bool Colored;
+    };
+
+    struct Entry {
+        uint64_t Hash;
+        ImFont *Font;
+        float FontSize;
+        std::string Text;
+        ImVec2 TextSize;
+        std::vector<Quad> Quads;
+        size_t Bytes;
+    };
+
+    const Entry &Find(ImFont *font, float fontSize, const char *text, const char *textEnd);
+
+    void Layout(Entry &entry);
+
+    void Evict();
+
+    std::list<Entry> m_Entries; // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_Index;
+    int m_AtlasTextureId = 0;
+    TextCacheStats m_Stats;
+};
+
+#endif //ANDROIDIMGUI_TEXTLAYOUTCACHE_H
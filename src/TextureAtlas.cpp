@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include "TextureAtlas.h"
+#include "AndroidImgui.h"
+
+TextureAtlas::~TextureAtlas() {
+    Clear();
+}
+
+void TextureAtlas::SetEnabled(bool enabled, int maxImageSize, int pageSize) {
+    m_Enabled = enabled;
+    m_MaxImageSize = maxImageSize;
+    m_PageSize = pageSize;
+}
+
+// Top of a width x height rect whose left edge sits on skyline[index], -1 if it leaves the page
+int TextureAtlas::Fit(const std::vector<Node> &skyline, size_t index, int size, int width, int height) {
+    if (skyline[index].X + width > size)
+        return -1;
+    int y = 0;
+    for (size_t i = index; width > 0; i++) {
+        y = std::max(y, skyline[i].Y);
+        if (y + height > size)
+            return -1;
+        width -= skyline[i].Width;
+    }
+    return y;
+}
+
+// Bottom-left skyline: the position with the lowest top wins, ties go to the narrowest node
+bool TextureAtlas::Pack(std::vector<Node> &skyline, int size, int width, int height, int &x, int &y) {
+    int best = -1;
+    int bestTop = INT_MAX;
+    int bestWidth = INT_MAX;
+    for (size_t i = 0; i < skyline.size(); i++) {
+        int top = Fit(skyline, i, size, width, height);
+        if (top < 0)
+            continue;
+        if (top + height < bestTop || (top + height == bestTop && skyline[i].Width < bestWidth)) {
+            best = (int) i;
+            bestTop = top + height;
+            bestWidth = skyline[i].Width;
+        }
+    }
+    if (best < 0)
+        return false;
+
+    x = skyline[best].X;
+    y = bestTop - height;
+    skyline.insert(skyline.begin() + best, {x, bestTop, width});
+    // Nodes under the new one shrink or go
+    for (size_t i = best + 1; i < skyline.size();) {
+        Node &node = skyline[i];
+        int overlap = x + width - node.X;
+        if (overlap <= 0)
+            break;
+        if (overlap < node.Width) {
+            node.X += overlap;
+            node.Width -= overlap;
+            break;
+        }
+        skyline.erase(skyline.begin() + i);
+    }
+    for (size_t i = 0; i + 1 < skyline.size();) {
+        if (skyline[i].Y == skyline[i + 1].Y) {
+            skyline[i].Width += skyline[i + 1].Width;
+            skyline.erase(skyline.begin() + i + 1);
+        } else {
+            i++;
+        }
+    }
+    return true;
+}
+
+int TextureAtlas::SkylineArea(const Page &page) {
+    int area = 0;
+    for (const Node &node: page.Skyline)
+        area += node.Y * node.Width;
+    return area;
+}
+
+void TextureAtlas::Touch(Page &page, int x, int y, int width, int height) {
+    if (page.DirtyX1 <= page.DirtyX0) {
+        page.DirtyX0 = x;
+        page.DirtyY0 = y;
+        page.DirtyX1 = x + width;
+        page.DirtyY1 = y + height;
+        return;
+    }
+    page.DirtyX0 = std::min(page.DirtyX0, x);
+    page.DirtyY0 = std::min(page.DirtyY0, y);
+    page.DirtyX1 = std::max(page.DirtyX1, x + width);
+    page.DirtyY1 = std::max(page.DirtyY1, y + height);
+}
+
+void TextureAtlas::Blit(Page &page, const Slot &slot, const unsigned char *pixels, int stride) {
+    int width = slot.Width - 2 * kBorder;
+    int height = slot.Height - 2 * kBorder;
+    for (int row = 0; row < slot.Height; row++) {
+        const unsigned char *src = pixels + (size_t) std::clamp(row - kBorder, 0, height - 1) * stride * 4;
+        unsigned char *dst = page.Pixels.data() + ((size_t) (slot.Y + row) * page.Size + slot.X) * 4;
+        for (int i = 0; i < kBorder; i++) {
+            memcpy(dst + i * 4, src, 4);
+            memcpy(dst + (kBorder + width + i) * 4, src + (width - 1) * 4, 4);
+        }
+        memcpy(dst + kBorder * 4, src, (size_t) width * 4);
+    }
+    Touch(page, slot.X, slot.Y, slot.Width, slot.Height);
+}
+
+void TextureAtlas::Place(BaseTexData *tex, const Slot &slot) {
+    const Page &page = *slot.Host;
+    float scale = 1.0f / (float) page.Size;
+    tex->DS = page.Texture->DS;
+    tex->U0 = (float) (slot.X + kBorder) * scale;
+    tex->V0 = (float) (slot.Y + kBorder) * scale;
+    tex->U1 = (float) (slot.X + slot.Width - kBorder) * scale;
+    tex->V1 = (float) (slot.Y + slot.Height - kBorder) * scale;
+}
+
+void TextureAtlas::PlaceAll(Page &page) {
+    page.DS = page.Texture->DS;
+    for (auto &[tex, slot]: m_Slots) {
+        if (slot.Host == &page)
+            Place(tex, slot);
+    }
+}
+
+bool TextureAtlas::Reload(Page &page) {
+    BaseTexData desc;
+    desc.Width = page.Size;
+    desc.Height = page.Size;
+    desc.Channels = 4;
+    BaseTexData *texture = m_Owner.LoadTexture(&desc, page.Pixels.data());
+    if (!texture)
+        return false;
+    m_Owner.m_Textures.push_back(texture);
+    // Draw data built earlier this frame still points at the old one
+    if (page.Texture)
+        m_Retired.push_back(page.Texture);
+    page.Texture = texture;
+    page.DirtyX1 = page.DirtyX0;
+    m_Uploads++;
+    PlaceAll(page);
+    return true;
+}
+
+bool TextureAtlas::Grow(Page &page) {
+    int oldSize = page.Size;
+    int size = std::min(oldSize * 2, m_PageSize);
+    if (size <= oldSize)
+        return false;
+    std::vector<unsigned char> pixels((size_t) size * size * 4);
+    for (int y = 0; y < oldSize; y++)
+        memcpy(pixels.data() + (size_t) y * size * 4, page.Pixels.data() + (size_t) y * oldSize * 4,
+               (size_t) oldSize * 4);
+    page.Pixels.swap(pixels);
+    page.Size = size;
+    if (!Reload(page)) {
+        page.Pixels.swap(pixels);
+        page.Size = oldSize;
+        return false;
+    }
+    page.Skyline.push_back({oldSize, 0, size - oldSize});
+    return true;
+}
+
+bool TextureAtlas::Repack(Page &page) {
+    std::vector<std::pair<BaseTexData *, Slot *>> slots;
+    for (auto &[tex, slot]: m_Slots) {
+        if (slot.Host == &page)
+            slots.emplace_back(tex, &slot);
+    }
+    // Tallest first keeps the skyline flat
+    std::sort(slots.begin(), slots.end(), [](const auto &a, const auto &b) {
+        if (a.second->Height != b.second->Height)
+            return a.second->Height > b.second->Height;
+        return a.second->Width > b.second->Width;
+    });
+    std::vector<Node> skyline{{0, 0, page.Size}};
+    std::vector<Slot> placed;
+    placed.reserve(slots.size());
+    for (auto &[tex, slot]: slots) {
+        Slot moved = *slot;
+        if (!Pack(skyline, page.Size, moved.Width, moved.Height, moved.X, moved.Y))
+            return false;
+        placed.push_back(moved);
+    }
+
+    std::vector<unsigned char> pixels((size_t) page.Size * page.Size * 4);
+    page.Pixels.swap(pixels);
+    for (size_t i = 0; i < slots.size(); i++) {
+        const Slot &old = *slots[i].second;
+        Blit(page, placed[i], pixels.data() + ((size_t) (old.Y + kBorder) * page.Size + old.X + kBorder) * 4,
+             page.Size);
+        *slots[i].second = placed[i];
+        Place(slots[i].first, placed[i]);
+    }
+    page.Skyline = std::move(skyline);
+    // Space the images moved out of is cleared too
+    Touch(page, 0, 0, page.Size, page.Size);
+    return true;
+}
+
+BaseTexData *TextureAtlas::Add(int width, int height, const unsigned char *pixels) {
+    if (!m_Enabled || width <= 0 || height <= 0 || width > m_MaxImageSize || height > m_MaxImageSize)
+        return nullptr;
+    Slot slot;
+    slot.Width = width + 2 * kBorder;
+    slot.Height = height + 2 * kBorder;
+    if (slot.Width > m_PageSize || slot.Height > m_PageSize)
+        return nullptr;
+
+    for (auto &page: m_Pages) {
+        if (Pack(page->Skyline, page->Size, slot.Width, slot.Height, slot.X, slot.Y)) {
+            slot.Host = page.get();
+            break;
+        }
+    }
+    // Growing keeps the images in one texture
+    for (size_t i = 0; !slot.Host && i < m_Pages.size(); i++) {
+        Page &page = *m_Pages[i];
+        while (Grow(page)) {
+            if (Pack(page.Skyline, page.Size, slot.Width, slot.Height, slot.X, slot.Y)) {
+                slot.Host = &page;
+                break;
+            }
+        }
+    }
+
+    if (slot.Host) {
+        Blit(*slot.Host, slot, pixels, width);
+    } else {
+        auto page = std::make_unique<Page>();
+        page->Size = std::min(kInitialPageSize, m_PageSize);
+        while (page->Size < slot.Width || page->Size < slot.Height)
+            page->Size = std::min(page->Size * 2, m_PageSize);
+        page->Pixels.resize((size_t) page->Size * page->Size * 4);
+        page->Skyline.push_back({0, 0, page->Size});
+        Pack(page->Skyline, page->Size, slot.Width, slot.Height, slot.X, slot.Y);
+        slot.Host = page.get();
+        Blit(*page, slot, pixels, width);
+        if (!Reload(*page))
+            return nullptr;
+        m_Pages.push_back(std::move(page));
+    }
+
+    auto *tex = new BaseTexData();
+    tex->Width = width;
+    tex->Height = height;
+    tex->Channels = 4;
+    Place(tex, slot);
+    slot.Host->UsedArea += slot.Width * slot.Height;
+    slot.Host->Images++;
+    m_Slots[tex] = slot;
+    return tex;
+}
+
+void TextureAtlas::Remove(BaseTexData *tex) {
+    auto it = m_Slots.find(tex);
+    if (it == m_Slots.end())
+        return;
+    Page *page = it->second.Host;
+    page->UsedArea -= it->second.Width * it->second.Height;
+    page->Images--;
+    m_Slots.erase(it);
+    delete tex;
+
+    if (page->Images == 0) {
+        m_Retired.push_back(page->Texture);
+        m_Pages.erase(std::find_if(m_Pages.begin(), m_Pages.end(), [page](const std::unique_ptr<Page> &p) {
+            return p.get() == page;
+        }));
+    } else if (page->UsedArea * 2 < SkylineArea(*page)) {
+        page->Sparse = true;
+    }
+}
+
+void TextureAtlas::Compact() {
+    // Backends keep them alive until frames in flight are done sampling them
+    for (BaseTexData *texture: m_Retired)
+        m_Owner.DeleteTexture(texture);
+    m_Retired.clear();
+    for (auto &page: m_Pages) {
+        if (page->Sparse) {
+            page->Sparse = false;
+            Repack(*page);
+        }
+    }
+}
+
+void TextureAtlas::Update() {
+    for (auto &page: m_Pages) {
+        // Released with the backend's resources, e.g. by a switch that kept no pixels
+        if (!page->Texture->DS)
+            Touch(*page, 0, 0, page->Size, page->Size);
+        if (page->DirtyX1 > page->DirtyX0) {
+            if (m_Owner.UpdateTexture(page->Texture, page->Pixels.data(), page->DirtyX0, page->DirtyY0,
+                                      page->DirtyX1 - page->DirtyX0, page->DirtyY1 - page->DirtyY0)) {
+                page->DirtyX1 = page->DirtyX0;
+                m_Uploads++;
+            } else {
+                Reload(*page);
+            }
+        }
+        if (page->Texture->DS != page->DS)
+            PlaceAll(*page);
+    }
+}
+
+void TextureAtlas::Clear() {
+    for (auto &[tex, slot]: m_Slots)
+        delete tex;
+    m_Slots.clear();
+    m_Pages.clear();
+    m_Retired.clear();
+}
+
+size_t TextureAtlas::GetCpuBytes() const {
+    size_t bytes = 0;
+    for (const auto &page: m_Pages)
+        bytes += page->Pixels.capacity();
+    return bytes;
+}
+
+TextureAtlasStats TextureAtlas::GetStats() const {
+    TextureAtlasStats stats;
+    stats.Images = (int) m_Slots.size();
+    stats.Pages = (int) m_Pages.size();
+    double used = 0.0;
+    double area = 0.0;
+    for (const auto &page: m_Pages) {
+        used += page->UsedArea;
+        area += (double) page->Size * page->Size;
+    }
+    stats.Occupancy = area > 0.0 ? (float) (used / area) : 0.0f;
+    stats.Uploads = m_Uploads;
+    return stats;
+}
@@ -0,0 +1,118 @@
+#ifndef ANDROIDIMGUI_TEXTUREATLAS_H
+#define ANDROIDIMGUI_TEXTUREATLAS_H
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class AndroidImgui;
+struct BaseTexData;
+
+struct TextureAtlasStats {
+    int Images = 0;         // textures packed into pages
+    int Pages = 0;          // backend textures holding them, Images - Pages texture objects saved
+    float Occupancy = 0.0f; // share of the page area taken by images
+    int Uploads = 0;        // page uploads so far
+};
+
+// Packs small RGBA images into shared pages, so ImGui draws images of one page in a single command. A handle is a
+// plain BaseTexData with the page's DS and the image's UV rect, kept in sync when the page's texture changes. Each
+// image gets a 1px extruded border against bleeding under linear filtering. Pages start small and double up to
+// the page size while they run full, pages that removals left half empty are repacked between frames.
+class TextureAtlas {
+public:
+    explicit TextureAtlas(AndroidImgui &owner) : m_Owner(owner) {}
+
+    ~TextureAtlas();
+
+    // Applies to images added from now on
+    void SetEnabled(bool enabled, int maxImageSize, int pageSize);
+
+    // RGBA8. nullptr when disabled or the image is too large, the caller loads it as a texture of its own
+    BaseTexData *Add(int width, int height, const unsigned char *pixels);
+
+    bool Owns(BaseTexData *tex) const { return m_Slots.count(tex) != 0; }
+
+    void Remove(BaseTexData *tex);
+
+    // Between frames: releases textures replaced by growth and repacks sparse pages
+    void Compact();
+
+    // Uploads changed pages and follows textures the backend re-created. Before anything samples the pages
+    void Update();
+
+    // Frees every handle, the pages go with the owner's textures
+    void Clear();
+
+    size_t GetCpuBytes() const;
+
+    TextureAtlasStats GetStats() const;
+
+private:
+    struct Node {
+        int X;
+        int Y;
+        int Width;
+    };
+
+    struct Page {
+        BaseTexData *Texture = nullptr;
+        void *DS = nullptr; // as the images last got it
+        int Size = 0;
+        std::vector<unsigned char> Pixels;
+        std::vector<Node> Skyline;
+        int UsedArea = 0;
+        int Images = 0;
+        // Pixels changed since the last upload, empty when DirtyX1 <= DirtyX0
+        int DirtyX0 = 0;
+        int DirtyY0 = 0;
+        int DirtyX1 = 0;
+        int DirtyY1 = 0;
+        bool Sparse = false; // repacked by the next Compact
+    };
+
+    // Rect of the image and its border in the page
+    struct Slot {
+        Page *Host = nullptr;
+        int X = 0;
+        int Y = 0;
+        int Width = 0;
+        int Height = 0;
+    };
+
+    static constexpr int kInitialPageSize = 256;
+    static constexpr int kBorder = 1;
+
+    static int Fit(const std::vector<Node> &skyline, size_t index, int size, int width, int height);
+
+    static bool Pack(std::vector<Node> &skyline, int size, int width, int height, int &x, int &y);
+
+    static int SkylineArea(const Page &page);
+
+    static void Touch(Page &page, int x, int y, int width, int height);
+
+    static void Blit(Page &page, const Slot &slot, const unsigned char *pixels, int stride);
+
+    // A new texture from the page's pixels, the old one is released by the next Compact
+    bool Reload(Page &page);
+
+    bool Grow(Page &page);
+
+    bool Repack(Page &page);
+
+    void Place(BaseTexData *tex, const Slot &slot);
+
+    void PlaceAll(Page &page);
+
+    AndroidImgui &m_Owner;
+    bool m_Enabled = false;
+    int m_MaxImageSize = 128;
+    int m_PageSize = 1024;
+    std::vector<std::unique_ptr<Page>> m_Pages;
+    std::unordered_map<BaseTexData *, Slot> m_Slots;
+    std::vector<BaseTexData *> m_Retired;
+    int m_Uploads = 0;
+};
+
+#endif //ANDROIDIMGUI_TEXTUREATLAS_H
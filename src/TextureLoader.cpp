@@ -0,0 +1,118 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include "TextureLoader.h"
+#include "AndroidImgui.h"
+#include "stb_image.h"
+#include "ThreadPool.h"
+
+TextureLoader::TextureLoader(AndroidImgui &owner) : m_Owner(owner) {
+}
+
+TextureLoader::~TextureLoader() {
+    *m_Alive = false;
+    m_Cancelled = true;
+    m_Pool.reset();
+    for (auto &texture: m_Decoded) {
+        if (texture->m_Pixels)
+            stbi_image_free(texture->m_Pixels);
+    }
+}
+
+BaseTexData *TextureLoader::GetPlaceholder() {
+    if (!m_Placeholder) {
+        // Grey 2x2 checker, freed by LoadTextureData like stbi's output (stbi_image_free is free)
+        m_Placeholder = m_Owner.LoadTextureData([](BaseTexData *tex_data) {
+            tex_data->Width = 2;
+            tex_data->Height = 2;
+            auto *pixels = (unsigned char *) malloc(2 * 2 * 4);
+            const unsigned char shades[4] = {0xC0, 0x90, 0x90, 0xC0};
+            for (int i = 0; i < 4; i++) {
+                pixels[i * 4] = pixels[i * 4 + 1] = pixels[i * 4 + 2] = shades[i];
+                pixels[i * 4 + 3] = 0xFF;
+            }
+            return pixels;
+        });
+    }
+    return m_Placeholder;
+}
+
+std::shared_ptr<AsyncTexture> TextureLoader::Load(const std::string &path, TextureCallback callback) {
+    auto texture = std::make_shared<AsyncTexture>();
+    texture->m_Path = path;
+    texture->m_Callback = std::move(callback);
+    texture->m_Placeholder = GetPlaceholder();
+    texture->m_LoaderAlive = m_Alive;
+    m_Pending.fetch_add(1, std::memory_order_relaxed);
+    if (!m_Pool)
+        m_Pool = std::make_unique<ThreadPool>();
+    m_Pool->Post([this, texture] {
+        if (!m_Cancelled.load(std::memory_order_relaxed)) {
+            texture->m_Pixels = stbi_load(texture->m_Path.c_str(), &texture->m_Width, &texture->m_Height, nullptr, 4);
+        }
+        texture->m_State.store(AsyncTexture::DECODED, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Decoded.push_back(texture);
+    });
+    return texture;
+}
+
+void TextureLoader::Finish(const std::shared_ptr<AsyncTexture> &texture, BaseTexData *result) {
+    texture->m_Texture = result;
+    texture->m_State.store(result ? AsyncTexture::READY : AsyncTexture::FAILED, std::memory_order_release);
+    m_Pending.fetch_sub(1, std::memory_order_relaxed);
+    if (TextureCallback callback = std::exchange(texture->m_Callback, nullptr))
+        callback(result);
+}
+
+void TextureLoader::Upload() {
+    auto start = std::chrono::steady_clock::now();
+    for (bool first = true;; first = false) {
+        if (!first && std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >=
+                      m_UploadBudgetMs)
+            break;
+        std::shared_ptr<AsyncTexture> texture;
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            if (m_Decoded.empty())
+                break;
+            texture = std::move(m_Decoded.front());
+            m_Decoded.pop_front();
+        }
+        BaseTexData *result = nullptr;
+        if (texture->m_Pixels) {
+            result = m_Owner.LoadTextureData([&texture](BaseTexData *tex_data) {
+                tex_data->Width = texture->m_Width;
+                tex_data->Height = texture->m_Height;
+                return std::exchange(texture->m_Pixels, nullptr);
+            });
+            if (result)
+                m_Owner.m_TextureSources[result] = texture->m_Path;
+        } else {
+            fprintf(stderr, "TextureLoader: can't load %s\n", texture->m_Path.c_str());
+        }
+        Finish(texture, result);
+    }
+}
+
+void TextureLoader::Cancel() {
+    m_Cancelled = true;
+    // Queued decodes skip their file and land in m_Decoded
+    m_Pool.reset();
+    std::deque<std::shared_ptr<AsyncTexture>> decoded;
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        decoded.swap(m_Decoded);
+    }
+    for (auto &texture: decoded) {
+        if (texture->m_Pixels)
+            stbi_image_free(std::exchange(texture->m_Pixels, nullptr));
+        Finish(texture, nullptr);
+    }
+    // Removed with the other textures
+    m_Placeholder = nullptr;
+    *m_Alive = false;
+    m_Alive = std::make_shared<bool>(true);
+    m_Cancelled = false;
+}
@@ -0,0 +1,95 @@
+#ifndef ANDROIDIMGUI_TEXTURELOADER_H
+#define ANDROIDIMGUI_TEXTURELOADER_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "AndroidImgui.h"
+
+class ThreadPool;
+
+// Handle of a texture being decoded on the pool and uploaded by NewFrame
+class AsyncTexture {
+public:
+    // Uploaded, or failed
+    bool IsReady() const { return m_State.load(std::memory_order_acquire) >= READY; }
+
+    bool IsFailed() const { return m_State.load(std::memory_order_acquire) == FAILED; }
+
+    // The texture once uploaded, the shared placeholder until then and after a failure; nullptr once the loader
+    // was shut down, which frees both. UI thread
+    BaseTexData *Get() const {
+        if (!*m_LoaderAlive)
+            return nullptr;
+        return m_Texture ? m_Texture : m_Placeholder;
+    }
+
+    const std::string &GetPath() const { return m_Path; }
+
+private:
+    friend class TextureLoader;
+
+    enum State {
+        DECODING,
+        DECODED,
+        READY,
+        FAILED
+    };
+
+    std::string m_Path;
+    TextureCallback m_Callback;
+    std::atomic<int> m_State{DECODING};
+    BaseTexData *m_Texture = nullptr;
+    BaseTexData *m_Placeholder = nullptr;
+    std::shared_ptr<const bool> m_LoaderAlive;
+    int m_Width = 0;
+    int m_Height = 0;
+    unsigned char *m_Pixels = nullptr;
+};
+
+// Decodes image files on a worker pool and uploads them a few per frame, within a time budget
+class TextureLoader {
+public:
+    explicit TextureLoader(AndroidImgui &owner);
+
+    ~TextureLoader();
+
+    // After Init, UI thread
+    std::shared_ptr<AsyncTexture> Load(const std::string &path, TextureCallback callback);
+
+    void SetUploadBudget(float milliseconds) { m_UploadBudgetMs = milliseconds; }
+
+    // Requested and not uploaded yet
+    int GetPendingCount() const { return m_Pending.load(std::memory_order_relaxed); }
+
+    bool IsPlaceholder(const BaseTexData *texture) const { return texture && texture == m_Placeholder; }
+
+    // NewFrame: uploads decoded textures until the budget is spent, at least one
+    void Upload();
+
+    // Shutdown, before the backend's textures go: skips what wasn't decoded yet, fails everything pending. Handles
+    // given out so far return nullptr from then on
+    void Cancel();
+
+private:
+    BaseTexData *GetPlaceholder();
+
+    void Finish(const std::shared_ptr<AsyncTexture> &texture, BaseTexData *result);
+
+    AndroidImgui &m_Owner;
+    std::unique_ptr<ThreadPool> m_Pool;
+    std::atomic<bool> m_Cancelled{false};
+    std::atomic<int> m_Pending{0};
+    float m_UploadBudgetMs = 2.0f;
+    BaseTexData *m_Placeholder = nullptr;
+    // Shared with the handles of the current Init, cleared by Cancel
+    std::shared_ptr<bool> m_Alive = std::make_shared<bool>(true);
+
+    std::mutex m_Lock;
+    std::deque<std::shared_ptr<AsyncTexture>> m_Decoded;
+};
+
+#endif //ANDROIDIMGUI_TEXTURELOADER_H
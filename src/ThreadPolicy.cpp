@@ -0,0 +1,104 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "ThreadPolicy.h"
+
+static constexpr int kMaxCpus = 64;
+
+int ThreadTuning::CurrentThreadId() {
+    return (int) syscall(SYS_gettid);
+}
+
+bool ThreadTuning::Apply(int tid, const ThreadPolicy &policy) {
+    bool applied = true;
+    if (policy.CpuMask) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < kMaxCpus; cpu++) {
+            if (policy.CpuMask & (1ull << cpu))
+                CPU_SET(cpu, &set);
+        }
+        if (sched_setaffinity(tid, sizeof(set), &set) != 0) {
+            fprintf(stderr, "ThreadTuning: affinity %llx for %d: %s\n", (unsigned long long) policy.CpuMask, tid,
+                    strerror(errno));
+            applied = false;
+        }
+    }
+
+    sched_param param = {};
+    if (policy.Fifo) {
+        param.sched_priority = policy.FifoPriority;
+        if (sched_setscheduler(tid, SCHED_FIFO, &param) == 0)
+            return applied;
+        fprintf(stderr, "ThreadTuning: SCHED_FIFO for %d: %s, using nice %d\n", tid, strerror(errno), policy.Nice);
+        applied = false;
+        param.sched_priority = 0;
+    }
+    // Back from SCHED_FIFO if an earlier policy set it
+    if (sched_getscheduler(tid) != SCHED_OTHER)
+        sched_setscheduler(tid, SCHED_OTHER, &param);
+    // Per thread on Linux, despite the name
+    if (setpriority(PRIO_PROCESS, (id_t) tid, policy.Nice) != 0) {
+        fprintf(stderr, "ThreadTuning: nice %d for %d: %s\n", policy.Nice, tid, strerror(errno));
+        applied = false;
+    }
+    return applied;
+}
+
+uint64_t ThreadTuning::GetAffinity(int tid) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(tid, sizeof(set), &set) != 0)
+        return 0;
+    uint64_t mask = 0;
+    for (int cpu = 0; cpu < kMaxCpus; cpu++) {
+        if (CPU_ISSET(cpu, &set))
+            mask |= 1ull << cpu;
+    }
+    return mask;
+}
+
+bool ThreadTuning::IsFifo(int tid) {
+    return sched_getscheduler(tid) == SCHED_FIFO;
+}
+
+// Cores whose cpufreq maximum is the highest (big) or lowest (!big)
+static uint64_t CoresByFrequency(bool big) {
+    long frequencies[kMaxCpus] = {};
+    long best = 0;
+    uint64_t all = 0;
+    const long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    for (int cpu = 0; cpu < cpus && cpu < kMaxCpus; cpu++) {
+        all |= 1ull << cpu;
+        char path[96];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+        FILE *file = fopen(path, "r");
+        if (!file)
+            continue;
+        if (fscanf(file, "%ld", &frequencies[cpu]) != 1)
+            frequencies[cpu] = 0;
+        fclose(file);
+        if (frequencies[cpu] > 0 && (best == 0 || (big ? frequencies[cpu] > best : frequencies[cpu] < best)))
+            best = frequencies[cpu];
+    }
+    if (best == 0)
+        return all;
+    uint64_t mask = 0;
+    for (int cpu = 0; cpu < cpus && cpu < kMaxCpus; cpu++) {
+        if (frequencies[cpu] == best)
+            mask |= 1ull << cpu;
+    }
+    return mask;
+}
+
+uint64_t ThreadTuning::BigCores() {
+    return CoresByFrequency(true);
+}
+
+uint64_t ThreadTuning::LittleCores() {
+    return CoresByFrequency(false);
+}
@@ -0,0 +1,33 @@
+#ifndef ANDROIDIMGUI_THREADPOLICY_H
+#define ANDROIDIMGUI_THREADPOLICY_H
+
+#include <cstdint>
+
+// Where a thread may run and how the scheduler treats it
+struct ThreadPolicy {
+    uint64_t CpuMask = 0;  // one bit per CPU, 0 keeps the current affinity
+    int Nice = 0;          // -20 (most CPU) .. 19, negative values need CAP_SYS_NICE or root
+    bool Fifo = false;     // SCHED_FIFO at FifoPriority; where that's not permitted the thread keeps Nice
+    int FifoPriority = 1;
+};
+
+class ThreadTuning {
+public:
+    // Linux thread id of the calling thread
+    static int CurrentThreadId();
+
+    // tid 0 = the calling thread. Applies what it may; false when any part was refused
+    static bool Apply(int tid, const ThreadPolicy &policy);
+
+    static uint64_t GetAffinity(int tid);
+
+    // true when the thread runs under SCHED_FIFO
+    static bool IsFifo(int tid);
+
+    // Cores with the highest / lowest cpufreq maximum; every core when they're all alike or unknown
+    static uint64_t BigCores();
+
+    static uint64_t LittleCores();
+};
+
+#endif //ANDROIDIMGUI_THREADPOLICY_H
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include "ThreadPool.h"
+
+// Live pools for SetDefaultPolicy
+static std::mutex s_PoolsLock;
+static std::vector<ThreadPool *> s_Pools;
+static ThreadPolicy s_DefaultPolicy;
+static bool s_HasDefaultPolicy = false;
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads <= 0)
+        threads = std::max((int) std::thread::hardware_concurrency() - 1, 1);
+    {
+        std::lock_guard<std::mutex> lock(s_PoolsLock);
+        m_Policy = s_DefaultPolicy;
+        m_HasPolicy = s_HasDefaultPolicy;
+        s_Pools.push_back(this);
+    }
+    for (int i = 0; i < threads; i++)
+        m_Threads.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(s_PoolsLock);
+        s_Pools.erase(std::find(s_Pools.begin(), s_Pools.end(), this));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Stop = true;
+    }
+    m_Wake.notify_all();
+    for (std::thread &thread: m_Threads)
+        thread.join();
+}
+
+void ThreadPool::WorkerLoop() {
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_ThreadIds.push_back(ThreadTuning::CurrentThreadId());
+        if (m_HasPolicy)
+            ThreadTuning::Apply(0, m_Policy);
+    }
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_Lock);
+            m_Wake.wait(lock, [this] { return m_Stop || !m_Tasks.empty(); });
+            if (m_Tasks.empty())
+                return;
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::Post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Tasks.push_back(std::move(task));
+    }
+    m_Wake.notify_one();
+}
+
+bool ThreadPool::SetPolicy(const ThreadPolicy &policy) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    m_Policy = policy;
+    m_HasPolicy = true;
+    bool applied = true;
+    for (int tid: m_ThreadIds)
+        applied &= ThreadTuning::Apply(tid, policy);
+    return applied;
+}
+
+bool ThreadPool::SetDefaultPolicy(const ThreadPolicy &policy) {
+    std::lock_guard<std::mutex> lock(s_PoolsLock);
+    s_DefaultPolicy = policy;
+    s_HasDefaultPolicy = true;
+    bool applied = true;
+    for (ThreadPool *pool: s_Pools)
+        applied &= pool->SetPolicy(policy);
+    return applied;
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)> &task) {
+    if (count <= 0)
+        return;
+
+    struct Job {
+        const std::function<void(int)> *Task;
+        int Count;
+        std::atomic<int> Next{0};
+        std::atomic<int> Done{0};
+        std::mutex Lock;
+        std::condition_variable Finished;
+
+        void Work() {
+            for (int i; (i = Next.fetch_add(1)) < Count;) {
+                (*Task)(i);
+                if (Done.fetch_add(1) + 1 == Count) {
+                    std::lock_guard<std::mutex> lock(Lock);
+                    Finished.notify_all();
+                }
+            }
+        }
+    };
+    // Helpers that start after the last index only touch the job, which they keep alive
+    auto job = std::make_shared<Job>();
+    job->Task = &task;
+    job->Count = count;
+    int helpers = std::min(count - 1, GetThreadCount());
+    for (int i = 0; i < helpers; i++)
+        Post([job] { job->Work(); });
+    job->Work();
+
+    std::unique_lock<std::mutex> lock(job->Lock);
+    job->Finished.wait(lock, [&job] { return job->Done.load() == job->Count; });
+}
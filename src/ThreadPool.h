@@ -0,0 +1,47 @@
+#ifndef ANDROIDIMGUI_THREADPOOL_H
+#define ANDROIDIMGUI_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ThreadPolicy.h"
+
+// Fixed set of worker threads for the library's background and fan-out work
+class ThreadPool {
+public:
+    // 0 = one thread per core but the calling one
+    explicit ThreadPool(int threads = 0);
+
+    ~ThreadPool();
+
+    int GetThreadCount() const { return (int) m_Threads.size(); }
+
+    // Runs task(0) .. task(count - 1) on the workers and the calling thread, returns once all have finished.
+    // Indices are handed out dynamically, so any index may run on any thread.
+    void ParallelFor(int count, const std::function<void(int)> &task);
+
+    void Post(std::function<void()> task);
+
+    // Applies to this pool's workers, including ones still starting
+    bool SetPolicy(const ThreadPolicy &policy);
+
+    // Sets the policy of every pool, existing and future
+    static bool SetDefaultPolicy(const ThreadPolicy &policy);
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_Threads;
+    std::mutex m_Lock;
+    std::condition_variable m_Wake;
+    std::deque<std::function<void()>> m_Tasks;
+    bool m_Stop = false;
+    std::vector<int> m_ThreadIds;
+    ThreadPolicy m_Policy;
+    bool m_HasPolicy = false;
+};
+
+#endif //ANDROIDIMGUI_THREADPOOL_H
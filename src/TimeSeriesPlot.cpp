@@ -0,0 +1,178 @@
+#include "imgui_internal.h"
+#include <cmath>
+#include "TimeSeriesPlot.h"
+
+TimeSeriesPlot::TimeSeriesPlot(int capacity) : m_Samples(ImMax(capacity, 2)) {
+}
+
+void TimeSeriesPlot::AddSample(double x, float y) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    m_Samples[m_Written++ % m_Samples.size()] = {x, y};
+}
+
+void TimeSeriesPlot::AddSamples(const double *x, const float *y, int count) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    for (int i = 0; i < count; i++)
+        m_Samples[m_Written++ % m_Samples.size()] = {x[i], y[i]};
+}
+
+void TimeSeriesPlot::Clear() {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    m_Written = 0;
+    m_Cleared = true;
+}
+
+uint64_t TimeSeriesPlot::GetSampleCount() {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return m_Written;
+}
+
+void TimeSeriesPlot::SetTimeWindow(double window) {
+    if (window > 0.0 && window != m_Window) {
+        m_Window = window;
+        m_Rebuild = true;
+    }
+}
+
+void TimeSeriesPlot::SetRange(float min, float max) {
+    m_RangeMin = min;
+    m_RangeMax = max;
+}
+
+void TimeSeriesPlot::SetColors(ImU32 line, ImU32 fill) {
+    m_LineCol = line;
+    m_FillCol = fill;
+}
+
+void TimeSeriesPlot::AddToColumns(const Sample &sample) {
+    // Columns sit at fixed multiples of the column width, so scrolling never moves samples between them
+    const auto index = (int64_t) std::floor(sample.X / m_ColumnWidth);
+    if (m_Columns.empty() || index > m_Columns.back().Index) {
+        m_Columns.push_back({index, sample.Y, sample.Y, true});
+    } else {
+        Column &column = m_Columns.back();
+        if (sample.Y < column.Min) {
+            column.Min = sample.Y;
+            column.MinFirst = false;
+        } else if (sample.Y > column.Max) {
+            column.Max = sample.Y;
+            column.MinFirst = true;
+        }
+    }
+}
+
+void TimeSeriesPlot::Update(int columns) {
+    if (columns != m_ColumnCount) {
+        m_ColumnCount = columns;
+        m_Rebuild = true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Lock);
+    const uint64_t capacity = m_Samples.size();
+    const uint64_t oldest = m_Written > capacity ? m_Written - capacity : 0;
+    if (m_Consumed < oldest || m_Cleared)
+        m_Rebuild = true; // samples were overwritten before we saw them, or dropped
+    m_Cleared = false;
+    if (m_Rebuild) {
+        m_Columns.clear();
+        m_ColumnWidth = m_Window / m_ColumnCount;
+        m_Consumed = oldest;
+        if (m_Written > oldest) {
+            // Start at the first sample inside the window
+            const double start = m_Samples[(m_Written - 1) % capacity].X - m_Window;
+            uint64_t low = oldest, high = m_Written - 1;
+            while (low < high) {
+                uint64_t mid = (low + high) / 2;
+                if (m_Samples[mid % capacity].X < start)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            m_Consumed = low;
+        }
+        m_Rebuild = false;
+    }
+    for (; m_Consumed < m_Written; m_Consumed++)
+        AddToColumns(m_Samples[m_Consumed % capacity]);
+
+    if (!m_Columns.empty()) {
+        const int64_t first = m_Columns.back().Index - m_ColumnCount + 1;
+        while (m_Columns.front().Index < first)
+            m_Columns.pop_front();
+    }
+}
+
+void TimeSeriesPlot::Draw(ImDrawList *drawList, const ImVec2 &pMin, const ImVec2 &pMax) {
+    const int columns = (int) (pMax.x - pMin.x);
+    if (columns < 2 || pMax.y <= pMin.y)
+        return;
+    Update(columns);
+    if (m_Columns.empty())
+        return;
+
+    float low = m_RangeMin, high = m_RangeMax;
+    if (low >= high) {
+        low = m_Columns.front().Min;
+        high = m_Columns.front().Max;
+        for (const Column &column: m_Columns) {
+            low = ImMin(low, column.Min);
+            high = ImMax(high, column.Max);
+        }
+        if (low == high) {
+            low -= 0.5f;
+            high += 0.5f;
+        }
+    }
+    const float scale = (pMax.y - pMin.y) / (high - low);
+    auto toY = [&](float value) { return ImClamp(pMax.y - (value - low) * scale, pMin.y, pMax.y); };
+
+    // Newest column at the right edge, one pixel per column
+    const int64_t last = m_Columns.back().Index;
+    auto toX = [&](int64_t index) { return pMax.x - (float) (last - index) - 0.5f; };
+
+    drawList->PushClipRect(pMin, pMax, true);
+    if (m_FillCol & IM_COL32_A_MASK) {
+        // Strip from the baseline up to each column's max
+        const int count = (int) m_Columns.size();
+        if (count >= 2) {
+            const ImVec2 uv = drawList->_Data->TexUvWhitePixel;
+            drawList->PrimReserve((count - 1) * 6, count * 2);
+            const unsigned int base = drawList->_VtxCurrentIdx;
+            for (const Column &column: m_Columns) {
+                float x = toX(column.Index);
+                drawList->PrimWriteVtx(ImVec2(x, toY(column.Max)), uv, m_FillCol);
+                drawList->PrimWriteVtx(ImVec2(x, pMax.y), uv, m_FillCol);
+            }
+            for (unsigned int i = 0; i + 1 < (unsigned int) count; i++) {
+                unsigned int v = base + i * 2;
+                drawList->PrimWriteIdx((ImDrawIdx) v);
+                drawList->PrimWriteIdx((ImDrawIdx) (v + 2));
+                drawList->PrimWriteIdx((ImDrawIdx) (v + 3));
+                drawList->PrimWriteIdx((ImDrawIdx) v);
+                drawList->PrimWriteIdx((ImDrawIdx) (v + 3));
+                drawList->PrimWriteIdx((ImDrawIdx) (v + 1));
+            }
+        }
+    }
+
+    // At most two points per column, in the order the samples had
+    m_Points.clear();
+    for (const Column &column: m_Columns) {
+        float x = toX(column.Index);
+        float a = column.MinFirst ? column.Min : column.Max;
+        float b = column.MinFirst ? column.Max : column.Min;
+        m_Points.emplace_back(x, toY(a));
+        if (b != a)
+            m_Points.emplace_back(x, toY(b));
+    }
+    if (m_Points.size() >= 2)
+        drawList->AddPolyline(m_Points.data(), (int) m_Points.size(), m_LineCol, ImDrawFlags_None, m_Thickness);
+    drawList->PopClipRect();
+}
+
+void TimeSeriesPlot::Widget(const char *label, const ImVec2 &size) {
+    ImVec2 itemSize(size.x > 0.0f ? size.x : ImGui::GetContentRegionAvail().x, size.y);
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+    ImGui::InvisibleButton(label, itemSize);
+    Draw(ImGui::GetWindowDrawList(), pos, ImVec2(pos.x + itemSize.x, pos.y + itemSize.y));
+}
@@ -0,0 +1,82 @@
+#ifndef ANDROIDIMGUI_TIMESERIESPLOT_H
+#define ANDROIDIMGUI_TIMESERIESPLOT_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "imgui.h"
+
+// Scrolling plot of the last SetTimeWindow x units of a series kept in a ring buffer. Samples are reduced to the
+// min and max of each pixel column as they arrive, so drawing costs the plot's width, not the sample count.
+// Samples may come from any thread; drawing happens on the UI thread.
+class TimeSeriesPlot {
+public:
+    // Samples kept, 16 bytes each: at least what the time window holds, older ones are dropped
+    explicit TimeSeriesPlot(int capacity = 1 << 14);
+
+    // x (e.g. seconds) must not decrease
+    void AddSample(double x, float y);
+
+    void AddSamples(const double *x, const float *y, int count);
+
+    // Any thread, the columns go with the next Draw
+    void Clear();
+
+    // Visible x span, ending at the newest sample
+    void SetTimeWindow(double window);
+
+    // Fixed y range; min >= max fits the visible samples
+    void SetRange(float min, float max);
+
+    // fill 0 draws the line only, otherwise the area below it too
+    void SetColors(ImU32 line, ImU32 fill = 0);
+
+    void SetThickness(float thickness) { m_Thickness = thickness; }
+
+    void Draw(ImDrawList *drawList, const ImVec2 &pMin, const ImVec2 &pMax);
+
+    // As an item of the current window; size.x <= 0 takes the available width
+    void Widget(const char *label, const ImVec2 &size = ImVec2(0.0f, 120.0f));
+
+    uint64_t GetSampleCount();
+
+private:
+    struct Sample {
+        double X;
+        float Y;
+    };
+
+    // Min and max of the samples in one pixel column
+    struct Column {
+        int64_t Index;
+        float Min;
+        float Max;
+        bool MinFirst;
+    };
+
+    void Update(int columns);
+
+    void AddToColumns(const Sample &sample);
+
+    std::mutex m_Lock;
+    std::vector<Sample> m_Samples;
+    uint64_t m_Written = 0;
+    bool m_Cleared = false;
+
+    // UI thread
+    uint64_t m_Consumed = 0;
+    bool m_Rebuild = true;
+    std::deque<Column> m_Columns;
+    int m_ColumnCount = 0;
+    double m_ColumnWidth = 0.0;
+    double m_Window = 10.0;
+    float m_RangeMin = 0.0f;
+    float m_RangeMax = 0.0f;
+    ImU32 m_LineCol = IM_COL32(0, 200, 255, 255);
+    ImU32 m_FillCol = 0;
+    float m_Thickness = 1.0f;
+    std::vector<ImVec2> m_Points;
+};
+
+#endif //ANDROIDIMGUI_TIMESERIESPLOT_H
@@ -1,10 +1,27 @@
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <dlfcn.h>
 #include "VulkanGraphics.h"
 #include "imgui_impl_vulkan.h"
 #include <vulkan/vulkan_android.h>
 #include <android/native_window.h>
 #include <unistd.h>
+#include "AnalyticShapes.h"
+
+// SPIR-V built from src/shaders by glslc -mfmt=c
+static const uint32_t kShapeVertSpv[] =
+#include "sdf_shape.vert.inc"
+;
+static const uint32_t kShapeFragSpv[] =
+#include "sdf_shape.frag.inc"
+;
+static const uint32_t kPremultipliedVertSpv[] =
+#include "premultiplied.vert.inc"
+;
+static const uint32_t kPremultipliedFragSpv[] =
+#include "premultiplied.frag.inc"
+;
 
 #ifndef NDEBUG
 
@@ -29,9 +46,8 @@ VkPhysicalDevice VulkanGraphics::SetupVulkan_SelectPhysicalDevice() {
     check_vk_result(err);
     IM_ASSERT(gpu_count > 0);
 
-    ImVector<VkPhysicalDevice> gpus;
-    gpus.resize(gpu_count);
-    err = vkEnumeratePhysicalDevices(m_Instance, &gpu_count, gpus.Data);
+    std::vector<VkPhysicalDevice> gpus(gpu_count);
+    err = vkEnumeratePhysicalDevices(m_Instance, &gpu_count, gpus.data());
     check_vk_result(err);
 
     // If a number >1 of GPUs got reported, find discrete GPU if present, or use first one available. This covers
@@ -50,10 +66,11 @@ VkPhysicalDevice VulkanGraphics::SetupVulkan_SelectPhysicalDevice() {
     return VK_NULL_HANDLE;
 }
 
-bool VulkanGraphics::Create() {
+// No ImGui calls in here (ImVector allocations included), it may run on a worker thread while another backend renders
+bool VulkanGraphics::CreateDevice() {
     if (InitVulkan() != 1) {
         fprintf(stderr, "Vulkan is not supported %s\n", dlerror());
-        abort();
+        return false;
     }
 
     wd = std::make_unique<ImGui_ImplVulkanH_Window>();
@@ -145,15 +162,15 @@ bool VulkanGraphics::Create() {
 
     // Create Logical Device (with 1 queue)
     {
-        ImVector<const char*> device_extensions;
+        std::vector<const char*> device_extensions;
         device_extensions.push_back("VK_KHR_swapchain");
 
         // Enumerate physical device extension
         uint32_t properties_count;
-        ImVector<VkExtensionProperties> properties;
+        std::vector<VkExtensionProperties> properties;
         vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &properties_count, nullptr);
         properties.resize(properties_count);
-        vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &properties_count, properties.Data);
+        vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &properties_count, properties.data());
 #ifdef VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME
         if (IsExtensionAvailable(properties, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME))
             device_extensions.push_back(VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME);
@@ -169,8 +186,8 @@ bool VulkanGraphics::Create() {
         create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         create_info.queueCreateInfoCount = sizeof(queue_info) / sizeof(queue_info[0]);
         create_info.pQueueCreateInfos = queue_info;
-        create_info.enabledExtensionCount = (uint32_t)device_extensions.Size;
-        create_info.ppEnabledExtensionNames = device_extensions.Data;
+        create_info.enabledExtensionCount = (uint32_t)device_extensions.size();
+        create_info.ppEnabledExtensionNames = device_extensions.data();
         err = vkCreateDevice(m_PhysicalDevice, &create_info, m_Allocator, &m_Device);
         check_vk_result(err);
         vkGetDeviceQueue(m_Device, m_QueueFamily, 0, &m_Queue);
@@ -199,7 +216,17 @@ bool VulkanGraphics::Create() {
         pool_info.pPoolSizes = pool_sizes;
         err = vkCreateDescriptorPool(m_Device, &pool_info, m_Allocator, &m_DescriptorPool);
         check_vk_result(err);
+        for (const VkDescriptorPoolSize& pool_size : pool_sizes)
+            m_DescriptorCount += pool_size.descriptorCount;
     }
+    return true;
+}
+
+bool VulkanGraphics::Create() {
+    if (m_Device == VK_NULL_HANDLE && !CreateDevice())
+        return false;
+
+    VkResult err;
     {
         // Create Window Surface
         VkSurfaceKHR surface;
@@ -213,6 +240,8 @@ bool VulkanGraphics::Create() {
         err = vkCreateAndroidSurfaceKHR(m_Instance, &createInfo, m_Allocator,
                                         &surface);
         check_vk_result(err);
+        if (err != VK_SUCCESS)
+            return false;
         wd->Surface = surface;
 
         // Check for WSI support
@@ -220,7 +249,7 @@ bool VulkanGraphics::Create() {
         vkGetPhysicalDeviceSurfaceSupportKHR(m_PhysicalDevice, m_QueueFamily, wd->Surface, &res);
         if (res != VK_TRUE) {
             fprintf(stderr, "Error no WSI support on physical device 0\n");
-            exit(-1);
+            return false;
         }
         // Select Surface Format
         const VkFormat requestSurfaceImageFormat[] = {
@@ -268,7 +297,7 @@ void VulkanGraphics::Setup() {
     init_info.PipelineInfoMain.Subpass = 0;
     init_info.PipelineInfoMain.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
     init_info.MinImageCount = m_MinImageCount;
-    init_info.ImageCount = wd->ImageCount;
+    init_info.ImageCount = wd->ImageCount * kRenderPassesPerFrame;
     init_info.Allocator = m_Allocator;
     init_info.CheckVkResultFn = check_vk_result;
     ImGui_ImplVulkan_Init(&init_info);
@@ -299,16 +328,15 @@ void VulkanGraphics::PrepareFrame(bool resize) {
     ImGui_ImplVulkan_NewFrame();
 }
 
-void VulkanGraphics::Render(ImDrawData* drawData) {
+bool VulkanGraphics::BeginFrameCommands() {
     VkResult err;
 
     VkSemaphore image_acquired_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].ImageAcquiredSemaphore;
-    VkSemaphore render_complete_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].RenderCompleteSemaphore;
     err = vkAcquireNextImageKHR(m_Device, wd->Swapchain, UINT64_MAX, image_acquired_semaphore, VK_NULL_HANDLE,
                                 &wd->FrameIndex);
     if (err == VK_ERROR_OUT_OF_DATE_KHR /*|| err == VK_SUBOPTIMAL_KHR*/) {
         m_SwapChainRebuild = true;
-        return;
+        return false;
     }
     //check_vk_result(err);
 
@@ -321,6 +349,12 @@ void VulkanGraphics::Render(ImDrawData* drawData) {
         err = vkResetFences(m_Device, 1, &fd->Fence);
         check_vk_result(err);
     }
+    // The fence also covers everything submitted before this image's last frame
+    if (wd->FrameIndex < m_FrameSerials.size())
+        m_CompletedSerial = std::max(m_CompletedSerial, m_FrameSerials[wd->FrameIndex]);
+    ReleaseRetired(false);
+    if (wd->FrameIndex < m_Uploads.size())
+        m_Uploads[wd->FrameIndex].Used = 0;
     {
         err = vkResetCommandPool(m_Device, fd->CommandPool, 0);
         check_vk_result(err);
@@ -330,6 +364,24 @@ void VulkanGraphics::Render(ImDrawData* drawData) {
         err = vkBeginCommandBuffer(fd->CommandBuffer, &info);
         check_vk_result(err);
     }
+    m_FrameBegun = true;
+    return true;
+}
+
+void VulkanGraphics::Render(ImDrawData* drawData) {
+    VkResult err;
+
+    CollectReadbacks(false);
+
+    // Offscreen passes may already have started this frame's command buffer
+    if (!m_FrameBegun && !BeginFrameCommands())
+        return;
+    const bool readback = IsCaptureRequested() && RecordReadback(drawData);
+    m_FrameBegun = false;
+
+    VkSemaphore image_acquired_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].ImageAcquiredSemaphore;
+    VkSemaphore render_complete_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].RenderCompleteSemaphore;
+    ImGui_ImplVulkanH_Frame* fd = &wd->Frames[wd->FrameIndex];
     {
         //透明 默认已经是0了
         //memset(wd->ClearValue.color.float32, 0, sizeof(wd->ClearValue.color.float32));
@@ -345,7 +397,9 @@ void VulkanGraphics::Render(ImDrawData* drawData) {
     }
 
     // Record dear imgui primitives into command buffer
+    m_CurrentDrawData = drawData;
     ImGui_ImplVulkan_RenderDrawData(drawData, fd->CommandBuffer);
+    m_CurrentDrawData = nullptr;
 
     // Submit command buffer
     vkCmdEndRenderPass(fd->CommandBuffer);
@@ -363,7 +417,12 @@ void VulkanGraphics::Render(ImDrawData* drawData) {
 
         err = vkEndCommandBuffer(fd->CommandBuffer);
         check_vk_result(err);
-        err = vkQueueSubmit(m_Queue, 1, &info, fd->Fence);
+        SubmitFrame(fd->Fence, info);
+    }
+    if (readback) {
+        // An empty submission signals its fence once everything before it completed
+        Readback &last = m_Readbacks[(m_ReadbackHead + m_ReadbackCount - 1) % kMaxReadbacks];
+        err = vkQueueSubmit(m_Queue, 0, nullptr, last.Fence);
         check_vk_result(err);
     }
 
@@ -388,13 +447,161 @@ void VulkanGraphics::Render(ImDrawData* drawData) {
     }
 }
 
+bool VulkanGraphics::RecordReadback(ImDrawData* drawData) {
+    if (m_ReadbackCount == kMaxReadbacks)
+        return false;
+    VkResult err;
+    Readback& readback = m_Readbacks[(m_ReadbackHead + m_ReadbackCount) % kMaxReadbacks];
+    const int width = wd->Width, height = wd->Height;
+    if (readback.Target && (readback.Target->Width != width || readback.Target->Height != height)) {
+        RemoveRenderTarget(readback.Target);
+        readback.Target = nullptr;
+    }
+    if (!readback.Target)
+        readback.Target = (VulkanTextureData*)CreateRenderTarget(width, height);
+
+    const VkDeviceSize size = (VkDeviceSize)width * height * 4;
+    if (readback.Size != size) {
+        if (readback.Buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(m_Device, readback.Buffer, m_Allocator);
+            vkFreeMemory(m_Device, readback.Memory, m_Allocator);
+        }
+        VkBufferCreateInfo buffer_info = {};
+        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size = size;
+        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        err = vkCreateBuffer(m_Device, &buffer_info, m_Allocator, &readback.Buffer);
+        check_vk_result(err);
+        VkMemoryRequirements req;
+        vkGetBufferMemoryRequirements(m_Device, readback.Buffer, &req);
+        // Cached memory reads much faster from the CPU where there is some
+        uint32_t memory_type = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                                                  VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        if (memory_type == 0xFFFFFFFF)
+            memory_type = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        VkMemoryAllocateInfo alloc_info = {};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = req.size;
+        alloc_info.memoryTypeIndex = memory_type;
+        err = vkAllocateMemory(m_Device, &alloc_info, m_Allocator, &readback.Memory);
+        check_vk_result(err);
+        err = vkBindBufferMemory(m_Device, readback.Buffer, readback.Memory, 0);
+        check_vk_result(err);
+        err = vkMapMemory(m_Device, readback.Memory, 0, size, 0, &readback.Mapped);
+        check_vk_result(err);
+        readback.Size = size;
+    }
+    if (readback.Fence == VK_NULL_HANDLE) {
+        VkFenceCreateInfo fence_info = {};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        err = vkCreateFence(m_Device, &fence_info, m_Allocator, &readback.Fence);
+        check_vk_result(err);
+    }
+
+    RenderToTarget(readback.Target, drawData);
+    VkCommandBuffer command_buffer = wd->Frames[wd->FrameIndex].CommandBuffer;
+    VkImageMemoryBarrier image_barrier = {};
+    image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    image_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    image_barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.image = readback.Target->Image;
+    image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_barrier.subresourceRange.levelCount = 1;
+    image_barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+
+    VkBufferImageCopy region = {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = width;
+    region.imageExtent.height = height;
+    region.imageExtent.depth = 1;
+    vkCmdCopyImageToBuffer(command_buffer, readback.Target->Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           readback.Buffer, 1, &region);
+
+    VkBufferMemoryBarrier buffer_barrier = {};
+    buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.buffer = readback.Buffer;
+    buffer_barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr,
+                         1, &buffer_barrier, 0, nullptr);
+
+    m_ReadbackCount++;
+    BeginCapture();
+    return true;
+}
+
+void VulkanGraphics::CollectReadbacks(bool wait) {
+    while (m_ReadbackCount > 0) {
+        Readback& readback = m_Readbacks[m_ReadbackHead];
+        VkResult err = wait ? vkWaitForFences(m_Device, 1, &readback.Fence, VK_TRUE, UINT64_MAX)
+                            : vkGetFenceStatus(m_Device, readback.Fence);
+        if (err == VK_NOT_READY)
+            return;
+        vkResetFences(m_Device, 1, &readback.Fence);
+
+        CapturedImage image;
+        if (err == VK_SUCCESS) {
+            image.Width = readback.Target->Width;
+            image.Height = readback.Target->Height;
+            image.Pixels.resize((size_t)image.Width * image.Height);
+            memcpy(image.Pixels.data(), readback.Mapped, (size_t)readback.Size);
+        }
+        m_ReadbackHead = (m_ReadbackHead + 1) % kMaxReadbacks;
+        m_ReadbackCount--;
+        FinishCapture(std::move(image), false, wd->SurfaceFormat.format == VK_FORMAT_B8G8R8A8_UNORM);
+    }
+}
+
+void VulkanGraphics::DestroyReadbacks() {
+    CollectReadbacks(true);
+    for (Readback& readback : m_Readbacks) {
+        if (readback.Target)
+            RemoveRenderTarget(readback.Target);
+        if (readback.Buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(m_Device, readback.Buffer, m_Allocator);
+            vkFreeMemory(m_Device, readback.Memory, m_Allocator);
+        }
+        if (readback.Fence != VK_NULL_HANDLE)
+            vkDestroyFence(m_Device, readback.Fence, m_Allocator);
+        readback = Readback();
+    }
+}
+
 void VulkanGraphics::PrepareShutdown() {
     VkResult err = vkDeviceWaitIdle(m_Device);
     check_vk_result(err);
+    DestroyReadbacks();
+    ReleaseRetired(true);
+    DestroyShapeObjects();
+    DestroyUploads();
+    DestroyPremultipliedPipeline();
     ImGui_ImplVulkan_Shutdown();
 }
 
 void VulkanGraphics::Cleanup() {
+    // CreateDevice failed or never ran
+    if (m_Device == VK_NULL_HANDLE) {
+        if (m_Instance != VK_NULL_HANDLE)
+            vkDestroyInstance(m_Instance, m_Allocator);
+        return;
+    }
+    if (m_TargetRenderPass != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(m_Device, m_TargetRenderPass, m_Allocator);
+        m_TargetRenderPass = VK_NULL_HANDLE;
+    }
     ImGui_ImplVulkanH_DestroyWindow(m_Instance, m_Device, wd.get(), m_Allocator);
     vkDestroyDescriptorPool(m_Device, m_DescriptorPool, m_Allocator);
 
@@ -421,23 +628,15 @@ uint32_t VulkanGraphics::findMemoryType(uint32_t type_filter, VkMemoryPropertyFl
     return 0xFFFFFFFF; // Unable to find memoryType
 }
 
-BaseTexData* VulkanGraphics::LoadTexture(BaseTexData* tex, void* pixel_data) {
-    auto* tex_data = new VulkanTextureData();
-    tex_data->Width = tex->Width;
-    tex_data->Height = tex->Height;
-    tex_data->Channels = tex->Channels;
-
-    // tex_data->UserData=
-    // Calculate allocation size (in number of bytes)
-    size_t image_size = tex_data->Width * tex_data->Height * tex_data->Channels;
-
+void VulkanGraphics::CreateTextureImage(VulkanTextureData* tex_data, VkFormat format, VkImageUsageFlags usage,
+                                        VkSamplerAddressMode address_mode) {
     VkResult err;
     // Create the Vulkan image.
     {
         VkImageCreateInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         info.imageType = VK_IMAGE_TYPE_2D;
-        info.format = VK_FORMAT_R8G8B8A8_UNORM;
+        info.format = format;
         info.extent.width = tex_data->Width;
         info.extent.height = tex_data->Height;
         info.extent.depth = 1;
@@ -445,7 +644,7 @@ BaseTexData* VulkanGraphics::LoadTexture(BaseTexData* tex, void* pixel_data) {
         info.arrayLayers = 1;
         info.samples = VK_SAMPLE_COUNT_1_BIT;
         info.tiling = VK_IMAGE_TILING_OPTIMAL;
-        info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        info.usage = usage;
         info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         err = vkCreateImage(m_Device, &info, m_Allocator, &tex_data->Image);
@@ -458,6 +657,7 @@ BaseTexData* VulkanGraphics::LoadTexture(BaseTexData* tex, void* pixel_data) {
         alloc_info.memoryTypeIndex = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
         err = vkAllocateMemory(m_Device, &alloc_info, m_Allocator, &tex_data->ImageMemory);
         check_vk_result(err);
+        tex_data->ImageMemorySize = req.size;
         err = vkBindImageMemory(m_Device, tex_data->Image, tex_data->ImageMemory, 0);
         check_vk_result(err);
     }
@@ -468,7 +668,7 @@ BaseTexData* VulkanGraphics::LoadTexture(BaseTexData* tex, void* pixel_data) {
         info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         info.image = tex_data->Image;
         info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        info.format = VK_FORMAT_R8G8B8A8_UNORM;
+        info.format = format;
         info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         info.subresourceRange.levelCount = 1;
         info.subresourceRange.layerCount = 1;
@@ -483,9 +683,9 @@ BaseTexData* VulkanGraphics::LoadTexture(BaseTexData* tex, void* pixel_data) {
         sampler_info.magFilter = VK_FILTER_LINEAR;
         sampler_info.minFilter = VK_FILTER_LINEAR;
         sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-        sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT; // outside image bounds just use border color
-        sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        sampler_info.addressModeU = address_mode; // outside image bounds just use border color
+        sampler_info.addressModeV = address_mode;
+        sampler_info.addressModeW = address_mode;
         sampler_info.minLod = -1000;
         sampler_info.maxLod = 1000;
         sampler_info.maxAnisotropy = 1.0f;
@@ -496,9 +696,98 @@ BaseTexData* VulkanGraphics::LoadTexture(BaseTexData* tex, void* pixel_data) {
     // Create Descriptor Set using ImGUI's implementation
     tex_data->DS = (void*)ImGui_ImplVulkan_AddTexture(tex_data->Sampler, tex_data->ImageView,
                                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
 
-    // Create Upload Buffer
-    {
+BaseTexData* VulkanGraphics::LoadTexture(BaseTexData* tex, void* pixel_data) {
+    auto* tex_data = new VulkanTextureData();
+    tex_data->Width = tex->Width;
+    tex_data->Height = tex->Height;
+    tex_data->Channels = tex->Channels;
+
+    CreateTextureImage(tex_data, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                       VK_SAMPLER_ADDRESS_MODE_REPEAT);
+
+    UploadPixels(tex_data, pixel_data);
+    return tex_data;
+}
+
+bool VulkanGraphics::UpdateTexture(BaseTexData* tex, const void* pixel_data, int x, int y, int width, int height) {
+    auto* tex_data = (VulkanTextureData*)tex;
+    VkResult err;
+    // Recorded ahead of the main pass like RenderToTarget, the frame's fence covers the copy and its staging
+    if (!m_FrameBegun && !BeginFrameCommands()) {
+        err = vkDeviceWaitIdle(m_Device);
+        check_vk_result(err);
+        UploadPixels(tex_data, pixel_data);
+        return true;
+    }
+    if (m_Uploads.size() < wd->ImageCount)
+        m_Uploads.resize(wd->ImageCount);
+    UploadRing& upload = m_Uploads[wd->FrameIndex];
+    const VkDeviceSize row_size = (VkDeviceSize)width * 4;
+    const VkDeviceSize size = row_size * height;
+    if (upload.Used + size > upload.Staging.Size) {
+        // Copies recorded from the old buffer have to run before it goes
+        if (upload.Used != 0)
+            WaitIdle();
+        CreateShapeBuffer(upload.Staging, std::max(upload.Staging.Size * 2, size), VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+        upload.Used = 0;
+    }
+
+    unsigned char* map = nullptr;
+    err = vkMapMemory(m_Device, upload.Staging.Memory, upload.Used, size, 0, (void**)&map);
+    check_vk_result(err);
+    const size_t stride = (size_t)tex_data->Width * 4;
+    for (int row = 0; row < height; row++)
+        memcpy(map + row * row_size, (const unsigned char*)pixel_data + (y + row) * stride + (size_t)x * 4, row_size);
+    vkUnmapMemory(m_Device, upload.Staging.Memory);
+
+    // Queue order keeps the copy behind earlier frames sampling the image, the barrier makes them finish first
+    VkCommandBuffer command_buffer = wd->Frames[wd->FrameIndex].CommandBuffer;
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = tex_data->Image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region = {};
+    region.bufferOffset = upload.Used;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset.x = x;
+    region.imageOffset.y = y;
+    region.imageExtent.width = width;
+    region.imageExtent.height = height;
+    region.imageExtent.depth = 1;
+    vkCmdCopyBufferToImage(command_buffer, upload.Staging.Buffer, tex_data->Image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+    // Copy offsets stay texel aligned
+    upload.Used += (size + 15) & ~(VkDeviceSize)15;
+    return true;
+}
+
+void VulkanGraphics::UploadPixels(VulkanTextureData* tex_data, const void* pixel_data) {
+    size_t image_size = tex_data->Width * tex_data->Height * tex_data->Channels;
+    VkResult err;
+
+    // Create Upload Buffer, again after TrimMemory released it
+    if (tex_data->UploadBuffer == VK_NULL_HANDLE) {
         VkBufferCreateInfo buffer_info = {};
         buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         buffer_info.size = image_size;
@@ -514,6 +803,7 @@ BaseTexData* VulkanGraphics::LoadTexture(BaseTexData* tex, void* pixel_data) {
         alloc_info.memoryTypeIndex = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
         err = vkAllocateMemory(m_Device, &alloc_info, m_Allocator, &tex_data->UploadBufferMemory);
         check_vk_result(err);
+        tex_data->UploadMemorySize = req.size;
         err = vkBindBufferMemory(m_Device, tex_data->UploadBuffer, tex_data->UploadBufferMemory, 0);
         check_vk_result(err);
     }
@@ -559,6 +849,7 @@ BaseTexData* VulkanGraphics::LoadTexture(BaseTexData* tex, void* pixel_data) {
         VkImageMemoryBarrier copy_barrier[1] = {};
         copy_barrier[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         copy_barrier[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        // The whole image is written, its old contents can go
         copy_barrier[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         copy_barrier[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         copy_barrier[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
@@ -610,12 +901,16 @@ BaseTexData* VulkanGraphics::LoadTexture(BaseTexData* tex, void* pixel_data) {
         err = vkDeviceWaitIdle(m_Device);
         check_vk_result(err);
     }
-
-    return tex_data;
 }
 
 void VulkanGraphics::RemoveTexture(BaseTexData* tex) {
-    auto* tex_data = (VulkanTextureData*)(tex);
+    // The frame being recorded may use it as well
+    m_Retired.push_back({(VulkanTextureData*)tex, m_SubmitSerial + 1});
+}
+
+void VulkanGraphics::DestroyTexture(VulkanTextureData* tex_data) {
+    if (tex_data->Framebuffer != VK_NULL_HANDLE)
+        vkDestroyFramebuffer(m_Device, tex_data->Framebuffer, m_Allocator);
     vkFreeMemory(m_Device, tex_data->UploadBufferMemory, nullptr);
     vkDestroyBuffer(m_Device, tex_data->UploadBuffer, nullptr);
     vkDestroySampler(m_Device, tex_data->Sampler, nullptr);
@@ -625,3 +920,550 @@ void VulkanGraphics::RemoveTexture(BaseTexData* tex) {
     ImGui_ImplVulkan_RemoveTexture((VkDescriptorSet)tex_data->DS);
     delete tex_data;
 }
+
+void VulkanGraphics::SubmitFrame(VkFence fence, const VkSubmitInfo& info) {
+    if (m_FrameSerials.size() < wd->ImageCount)
+        m_FrameSerials.resize(wd->ImageCount);
+    m_FrameSerials[wd->FrameIndex] = ++m_SubmitSerial;
+    VkResult err = vkQueueSubmit(m_Queue, 1, &info, fence);
+    check_vk_result(err);
+}
+
+void VulkanGraphics::ReleaseRetired(bool all) {
+    if (all)
+        m_CompletedSerial = m_SubmitSerial;
+    size_t kept = 0;
+    for (RetiredTexture& retired : m_Retired) {
+        if (all || retired.Serial <= m_CompletedSerial)
+            DestroyTexture(retired.Texture);
+        else
+            m_Retired[kept++] = retired;
+    }
+    m_Retired.resize(kept);
+}
+
+
+BaseTexData* VulkanGraphics::CreateRenderTarget(int width, int height) {
+    VkResult err;
+    if (m_TargetRenderPass == VK_NULL_HANDLE) {
+        // Compatible with wd->RenderPass so the ImGui pipeline can be reused, but ends in a sampleable layout
+        VkAttachmentDescription attachment = {};
+        attachment.format = wd->SurfaceFormat.format;
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        VkAttachmentReference color_attachment = {};
+        color_attachment.attachment = 0;
+        color_attachment.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        VkSubpassDescription subpass = {};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &color_attachment;
+        VkSubpassDependency dependencies[2] = {};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        VkRenderPassCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        info.attachmentCount = 1;
+        info.pAttachments = &attachment;
+        info.subpassCount = 1;
+        info.pSubpasses = &subpass;
+        info.dependencyCount = 2;
+        info.pDependencies = dependencies;
+        err = vkCreateRenderPass(m_Device, &info, m_Allocator, &m_TargetRenderPass);
+        check_vk_result(err);
+    }
+
+    auto* tex_data = new VulkanTextureData();
+    tex_data->Width = width;
+    tex_data->Height = height;
+    tex_data->Channels = 4;
+    CreateTextureImage(tex_data, wd->SurfaceFormat.format,
+                       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                       VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                       VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+
+    VkFramebufferCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    info.renderPass = m_TargetRenderPass;
+    info.attachmentCount = 1;
+    info.pAttachments = &tex_data->ImageView;
+    info.width = width;
+    info.height = height;
+    info.layers = 1;
+    err = vkCreateFramebuffer(m_Device, &info, m_Allocator, &tex_data->Framebuffer);
+    check_vk_result(err);
+    return tex_data;
+}
+
+bool VulkanGraphics::RenderToTarget(BaseTexData* target, ImDrawData* drawData) {
+    auto* tex_data = (VulkanTextureData*)target;
+    if (!m_FrameBegun && !BeginFrameCommands())
+        return false;
+
+    // Recorded ahead of the main pass in the same command buffer
+    ImGui_ImplVulkanH_Frame* fd = &wd->Frames[wd->FrameIndex];
+    VkClearValue clear_value = {};
+    VkRenderPassBeginInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    info.renderPass = m_TargetRenderPass;
+    info.framebuffer = tex_data->Framebuffer;
+    info.renderArea.extent.width = tex_data->Width;
+    info.renderArea.extent.height = tex_data->Height;
+    info.clearValueCount = 1;
+    info.pClearValues = &clear_value;
+    vkCmdBeginRenderPass(fd->CommandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
+    m_CurrentDrawData = drawData;
+    ImGui_ImplVulkan_RenderDrawData(drawData, fd->CommandBuffer);
+    m_CurrentDrawData = nullptr;
+    vkCmdEndRenderPass(fd->CommandBuffer);
+    return true;
+}
+
+void VulkanGraphics::RemoveRenderTarget(BaseTexData* target) {
+    // Retired with its framebuffer, WindowRenderCache releases targets of windows hidden for a while
+    RemoveTexture(target);
+}
+
+TextureMemory VulkanGraphics::GetTextureMemory(BaseTexData* tex) {
+    auto* tex_data = (VulkanTextureData*)tex;
+    TextureMemory memory;
+    memory.Gpu = (size_t)tex_data->ImageMemorySize;
+    memory.Staging = (size_t)tex_data->UploadMemorySize;
+    return memory;
+}
+
+void VulkanGraphics::ReportMemory(MemoryReport& report) {
+    // Drivers don't expose pool sizes, a descriptor is assumed to take 64 bytes
+    report.Bytes[MemoryReport::DESCRIPTOR_POOL] += (size_t)m_DescriptorCount * 64;
+    if (!wd)
+        return;
+    report.Bytes[MemoryReport::FRAMEBUFFER] += (size_t)wd->ImageCount * wd->Width * wd->Height * 4;
+    // ImGui_ImplVulkan keeps one vertex/index buffer pair per ImageCount, each grown to the largest frame
+    if (ImDrawData* drawData = ImGui::GetDrawData())
+        report.Bytes[MemoryReport::GEOMETRY] += (size_t)wd->ImageCount * kRenderPassesPerFrame *
+                                                ((size_t)drawData->TotalVtxCount * sizeof(ImDrawVert) +
+                                                 (size_t)drawData->TotalIdxCount * sizeof(ImDrawIdx));
+    report.Bytes[MemoryReport::GEOMETRY] += (size_t)m_ShapeIndexBuffer.Size;
+    for (const ShapeBuffer& buffer : m_ShapeVertexBuffers)
+        report.Bytes[MemoryReport::GEOMETRY] += (size_t)buffer.Size;
+    for (const UploadRing& upload : m_Uploads)
+        report.Bytes[MemoryReport::STAGING] += (size_t)upload.Staging.Size;
+    for (const Readback& readback : m_Readbacks) {
+        report.Bytes[MemoryReport::STAGING] += (size_t)readback.Size;
+        if (readback.Target)
+            report.Bytes[MemoryReport::FRAMEBUFFER] += (size_t)readback.Target->ImageMemorySize;
+    }
+}
+
+void VulkanGraphics::TrimMemory(TrimLevel level, const std::vector<BaseTexData*>& textures) {
+    VkResult err = vkDeviceWaitIdle(m_Device);
+    check_vk_result(err);
+    ReleaseRetired(true);
+    // Only read by the copy LoadTexture submits, which has completed by now
+    for (BaseTexData* tex : textures) {
+        auto* tex_data = (VulkanTextureData*)tex;
+        if (tex_data->UploadBuffer == VK_NULL_HANDLE)
+            continue;
+        vkDestroyBuffer(m_Device, tex_data->UploadBuffer, m_Allocator);
+        vkFreeMemory(m_Device, tex_data->UploadBufferMemory, m_Allocator);
+        tex_data->UploadBuffer = VK_NULL_HANDLE;
+        tex_data->UploadBufferMemory = VK_NULL_HANDLE;
+        tex_data->UploadMemorySize = 0;
+    }
+    if (level == TRIM_COMPLETE) {
+        DestroyShapeObjects();
+        DestroyUploads();
+        DestroyPremultipliedPipeline();
+        DestroyReadbacks();
+    }
+}
+
+void VulkanGraphics::WaitIdle() {
+    VkResult err;
+    if (!m_FrameBegun) {
+        err = vkQueueWaitIdle(m_Queue);
+        check_vk_result(err);
+        ReleaseRetired(true);
+        return;
+    }
+
+    // Offscreen passes recorded so far go in their own submission, the swapchain image stays acquired for Render
+    ImGui_ImplVulkanH_Frame* fd = &wd->Frames[wd->FrameIndex];
+    err = vkEndCommandBuffer(fd->CommandBuffer);
+    check_vk_result(err);
+    VkSubmitInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    info.commandBufferCount = 1;
+    info.pCommandBuffers = &fd->CommandBuffer;
+    SubmitFrame(fd->Fence, info);
+    err = vkWaitForFences(m_Device, 1, &fd->Fence, VK_TRUE, UINT64_MAX);
+    check_vk_result(err);
+    err = vkResetFences(m_Device, 1, &fd->Fence);
+    check_vk_result(err);
+    m_CompletedSerial = m_SubmitSerial;
+    ReleaseRetired(false);
+
+    err = vkResetCommandPool(m_Device, fd->CommandPool, 0);
+    check_vk_result(err);
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    err = vkBeginCommandBuffer(fd->CommandBuffer, &begin_info);
+    check_vk_result(err);
+}
+// Pipelines drawn between ImGui's own: same dynamic viewport/scissor, no depth, one sample. The colour blend source
+// factor picks straight or premultiplied alpha
+VkPipeline VulkanGraphics::CreatePipeline(const uint32_t *vert_spv, size_t vert_size, const uint32_t *frag_spv,
+                                          size_t frag_size, const VkPipelineVertexInputStateCreateInfo &vertex_info,
+                                          VkPipelineLayout layout, VkBlendFactor src_color_factor) {
+    VkResult err;
+    VkShaderModule vert_module, frag_module;
+    {
+        VkShaderModuleCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        info.codeSize = vert_size;
+        info.pCode = vert_spv;
+        err = vkCreateShaderModule(m_Device, &info, m_Allocator, &vert_module);
+        check_vk_result(err);
+        info.codeSize = frag_size;
+        info.pCode = frag_spv;
+        err = vkCreateShaderModule(m_Device, &info, m_Allocator, &frag_module);
+        check_vk_result(err);
+    }
+
+    VkPipelineShaderStageCreateInfo stages[2] = {};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vert_module;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = frag_module;
+    stages[1].pName = "main";
+
+    VkPipelineInputAssemblyStateCreateInfo ia_info = {};
+    ia_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    ia_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewport_info = {};
+    viewport_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_info.viewportCount = 1;
+    viewport_info.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo raster_info = {};
+    raster_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    raster_info.polygonMode = VK_POLYGON_MODE_FILL;
+    raster_info.cullMode = VK_CULL_MODE_NONE;
+    raster_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    raster_info.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo ms_info = {};
+    ms_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    ms_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // Alpha accumulates like in the ImGui pipeline
+    VkPipelineColorBlendAttachmentState color_attachment = {};
+    color_attachment.blendEnable = VK_TRUE;
+    color_attachment.srcColorBlendFactor = src_color_factor;
+    color_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    color_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+    color_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    color_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    color_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    color_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                      VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo blend_info = {};
+    blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    blend_info.attachmentCount = 1;
+    blend_info.pAttachments = &color_attachment;
+
+    VkPipelineDepthStencilStateCreateInfo depth_info = {};
+    depth_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+    VkDynamicState dynamic_states[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamic_state = {};
+    dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic_state.dynamicStateCount = 2;
+    dynamic_state.pDynamicStates = dynamic_states;
+
+    // wd->RenderPass and m_TargetRenderPass are compatible, one pipeline serves both
+    VkGraphicsPipelineCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    info.stageCount = 2;
+    info.pStages = stages;
+    info.pVertexInputState = &vertex_info;
+    info.pInputAssemblyState = &ia_info;
+    info.pViewportState = &viewport_info;
+    info.pRasterizationState = &raster_info;
+    info.pMultisampleState = &ms_info;
+    info.pDepthStencilState = &depth_info;
+    info.pColorBlendState = &blend_info;
+    info.pDynamicState = &dynamic_state;
+    info.layout = layout;
+    info.renderPass = wd->RenderPass;
+    info.subpass = 0;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    err = vkCreateGraphicsPipelines(m_Device, m_PipelineCache, 1, &info, m_Allocator, &pipeline);
+    check_vk_result(err);
+
+    vkDestroyShaderModule(m_Device, vert_module, m_Allocator);
+    vkDestroyShaderModule(m_Device, frag_module, m_Allocator);
+    return err == VK_SUCCESS ? pipeline : VK_NULL_HANDLE;
+}
+
+bool VulkanGraphics::CreateShapePipeline() {
+    VkResult err;
+    VkPushConstantRange push_constants = {};
+    push_constants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    push_constants.offset = 0;
+    push_constants.size = sizeof(float) * 4;
+    VkPipelineLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_constants;
+    err = vkCreatePipelineLayout(m_Device, &layout_info, m_Allocator, &m_ShapePipelineLayout);
+    check_vk_result(err);
+
+    VkVertexInputBindingDescription binding_desc = {};
+    binding_desc.stride = sizeof(ShapeVertex);
+    binding_desc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    VkVertexInputAttributeDescription attribute_desc[5] = {};
+    attribute_desc[0] = {0, 0, VK_FORMAT_R32G32_SFLOAT, (uint32_t) offsetof(ShapeVertex, X)};
+    attribute_desc[1] = {1, 0, VK_FORMAT_R32G32_SFLOAT, (uint32_t) offsetof(ShapeVertex, LocalX)};
+    attribute_desc[2] = {2, 0, VK_FORMAT_R32G32_SFLOAT, (uint32_t) offsetof(ShapeVertex, HalfWidth)};
+    attribute_desc[3] = {3, 0, VK_FORMAT_R32G32_SFLOAT, (uint32_t) offsetof(ShapeVertex, Radius)};
+    attribute_desc[4] = {4, 0, VK_FORMAT_R8G8B8A8_UNORM, (uint32_t) offsetof(ShapeVertex, Col)};
+    VkPipelineVertexInputStateCreateInfo vertex_info = {};
+    vertex_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertex_info.vertexBindingDescriptionCount = 1;
+    vertex_info.pVertexBindingDescriptions = &binding_desc;
+    vertex_info.vertexAttributeDescriptionCount = 5;
+    vertex_info.pVertexAttributeDescriptions = attribute_desc;
+
+    m_ShapePipeline = CreatePipeline(kShapeVertSpv, sizeof(kShapeVertSpv), kShapeFragSpv, sizeof(kShapeFragSpv),
+                                     vertex_info, m_ShapePipelineLayout, VK_BLEND_FACTOR_SRC_ALPHA);
+    return m_ShapePipeline != VK_NULL_HANDLE;
+}
+
+// Set 0 and the push constants are defined as in ImGui_ImplVulkan's pipeline layout, so the texture descriptor
+// sets and the transform it binds stay valid for this pipeline
+bool VulkanGraphics::CreatePremultipliedPipeline() {
+    VkResult err;
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    VkDescriptorSetLayoutCreateInfo set_info = {};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_info.bindingCount = 1;
+    set_info.pBindings = &binding;
+    err = vkCreateDescriptorSetLayout(m_Device, &set_info, m_Allocator, &m_PremultipliedSetLayout);
+    check_vk_result(err);
+
+    VkPushConstantRange push_constants = {};
+    push_constants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    push_constants.offset = 0;
+    push_constants.size = sizeof(float) * 4;
+    VkPipelineLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.setLayoutCount = 1;
+    layout_info.pSetLayouts = &m_PremultipliedSetLayout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_constants;
+    err = vkCreatePipelineLayout(m_Device, &layout_info, m_Allocator, &m_PremultipliedPipelineLayout);
+    check_vk_result(err);
+
+    VkVertexInputBindingDescription binding_desc = {};
+    binding_desc.stride = sizeof(ImDrawVert);
+    binding_desc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    VkVertexInputAttributeDescription attribute_desc[3] = {};
+    attribute_desc[0] = {0, 0, VK_FORMAT_R32G32_SFLOAT, (uint32_t) offsetof(ImDrawVert, pos)};
+    attribute_desc[1] = {1, 0, VK_FORMAT_R32G32_SFLOAT, (uint32_t) offsetof(ImDrawVert, uv)};
+    attribute_desc[2] = {2, 0, VK_FORMAT_R8G8B8A8_UNORM, (uint32_t) offsetof(ImDrawVert, col)};
+    VkPipelineVertexInputStateCreateInfo vertex_info = {};
+    vertex_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertex_info.vertexBindingDescriptionCount = 1;
+    vertex_info.pVertexBindingDescriptions = &binding_desc;
+    vertex_info.vertexAttributeDescriptionCount = 3;
+    vertex_info.pVertexAttributeDescriptions = attribute_desc;
+
+    m_PremultipliedPipeline = CreatePipeline(kPremultipliedVertSpv, sizeof(kPremultipliedVertSpv),
+                                             kPremultipliedFragSpv, sizeof(kPremultipliedFragSpv), vertex_info,
+                                             m_PremultipliedPipelineLayout, VK_BLEND_FACTOR_ONE);
+    return m_PremultipliedPipeline != VK_NULL_HANDLE;
+}
+
+void VulkanGraphics::DestroyPremultipliedPipeline() {
+    if (m_PremultipliedPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_Device, m_PremultipliedPipeline, m_Allocator);
+        m_PremultipliedPipeline = VK_NULL_HANDLE;
+    }
+    if (m_PremultipliedPipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(m_Device, m_PremultipliedPipelineLayout, m_Allocator);
+        m_PremultipliedPipelineLayout = VK_NULL_HANDLE;
+    }
+    if (m_PremultipliedSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(m_Device, m_PremultipliedSetLayout, m_Allocator);
+        m_PremultipliedSetLayout = VK_NULL_HANDLE;
+    }
+}
+
+// ImGui_ImplVulkan_RenderDrawData binds its pipeline only in SetupRenderState, which the reset callback runs
+void VulkanGraphics::BlendPremultiplied() {
+    if (!m_CurrentDrawData || (m_PremultipliedPipeline == VK_NULL_HANDLE && !CreatePremultipliedPipeline()))
+        return;
+    ImGui_ImplVulkanH_Frame *fd = &wd->Frames[wd->FrameIndex];
+    vkCmdBindPipeline(fd->CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PremultipliedPipeline);
+}
+
+void VulkanGraphics::CreateShapeBuffer(ShapeBuffer &buffer, VkDeviceSize size, VkBufferUsageFlags usage) {
+    VkResult err;
+    DestroyShapeBuffer(buffer);
+    VkBufferCreateInfo buffer_info = {};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = size;
+    buffer_info.usage = usage;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    err = vkCreateBuffer(m_Device, &buffer_info, m_Allocator, &buffer.Buffer);
+    check_vk_result(err);
+    VkMemoryRequirements req;
+    vkGetBufferMemoryRequirements(m_Device, buffer.Buffer, &req);
+    VkMemoryAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = req.size;
+    alloc_info.memoryTypeIndex = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    err = vkAllocateMemory(m_Device, &alloc_info, m_Allocator, &buffer.Memory);
+    check_vk_result(err);
+    err = vkBindBufferMemory(m_Device, buffer.Buffer, buffer.Memory, 0);
+    check_vk_result(err);
+    buffer.Size = size;
+    buffer.Generation = 0;
+}
+
+void VulkanGraphics::DestroyShapeBuffer(ShapeBuffer &buffer) {
+    if (buffer.Buffer != VK_NULL_HANDLE)
+        vkDestroyBuffer(m_Device, buffer.Buffer, m_Allocator);
+    if (buffer.Memory != VK_NULL_HANDLE)
+        vkFreeMemory(m_Device, buffer.Memory, m_Allocator);
+    buffer = ShapeBuffer();
+}
+
+void VulkanGraphics::DestroyUploads() {
+    for (UploadRing& upload : m_Uploads)
+        DestroyShapeBuffer(upload.Staging);
+    m_Uploads.clear();
+}
+
+void VulkanGraphics::DestroyShapeObjects() {
+    for (ShapeBuffer &buffer: m_ShapeVertexBuffers)
+        DestroyShapeBuffer(buffer);
+    m_ShapeVertexBuffers.clear();
+    DestroyShapeBuffer(m_ShapeIndexBuffer);
+    if (m_ShapePipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_Device, m_ShapePipeline, m_Allocator);
+        m_ShapePipeline = VK_NULL_HANDLE;
+    }
+    if (m_ShapePipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(m_Device, m_ShapePipelineLayout, m_Allocator);
+        m_ShapePipelineLayout = VK_NULL_HANDLE;
+    }
+}
+
+void VulkanGraphics::RenderShapes(const ShapeFrame &frame, int firstShape, int shapeCount, const ImVec4 &clipRect) {
+    VkResult err;
+    ImDrawData *drawData = m_CurrentDrawData;
+    if (!drawData || !m_Shapes->IsSupported())
+        return;
+    // Shapes from here on are drawn as ImDrawList geometry
+    if (m_ShapePipeline == VK_NULL_HANDLE && !CreateShapePipeline()) {
+        m_Shapes->SetSupported(false);
+        return;
+    }
+
+    ImGui_ImplVulkanH_Frame *fd = &wd->Frames[wd->FrameIndex];
+    if (m_ShapeVertexBuffers.size() < wd->ImageCount)
+        m_ShapeVertexBuffers.resize(wd->ImageCount);
+
+    // First batch of the frame uploads every shape; this image's previous submission is already fenced
+    ShapeBuffer &vertex_buffer = m_ShapeVertexBuffers[wd->FrameIndex];
+    if (vertex_buffer.Generation != frame.Generation) {
+        VkDeviceSize vertex_size = frame.Vertices.size() * sizeof(ShapeVertex);
+        if (vertex_buffer.Size < vertex_size)
+            CreateShapeBuffer(vertex_buffer, vertex_size * 2, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        void *map = nullptr;
+        err = vkMapMemory(m_Device, vertex_buffer.Memory, 0, vertex_size, 0, &map);
+        check_vk_result(err);
+        memcpy(map, frame.Vertices.data(), vertex_size);
+        vkUnmapMemory(m_Device, vertex_buffer.Memory);
+        vertex_buffer.Generation = frame.Generation;
+
+        VkDeviceSize frame_shapes = frame.Vertices.size() / 4;
+        if (m_ShapeIndexBuffer.Size < frame_shapes * 6 * sizeof(uint32_t)) {
+            // Other frames in flight may still read the index buffer
+            err = vkDeviceWaitIdle(m_Device);
+            check_vk_result(err);
+            CreateShapeBuffer(m_ShapeIndexBuffer, frame_shapes * 2 * 6 * sizeof(uint32_t),
+                              VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+            uint32_t *idx = nullptr;
+            err = vkMapMemory(m_Device, m_ShapeIndexBuffer.Memory, 0, m_ShapeIndexBuffer.Size, 0, (void **) &idx);
+            check_vk_result(err);
+            for (uint32_t v = 0; v < frame_shapes * 2 * 4; v += 4, idx += 6) {
+                idx[0] = v; idx[1] = v + 1; idx[2] = v + 2;
+                idx[3] = v; idx[4] = v + 2; idx[5] = v + 3;
+            }
+            vkUnmapMemory(m_Device, m_ShapeIndexBuffer.Memory);
+        }
+    }
+
+    VkCommandBuffer command_buffer = fd->CommandBuffer;
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ShapePipeline);
+    VkDeviceSize vertex_offset = 0;
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer.Buffer, &vertex_offset);
+    vkCmdBindIndexBuffer(command_buffer, m_ShapeIndexBuffer.Buffer, 0, VK_INDEX_TYPE_UINT32);
+
+    // Same transform and scissor mapping as ImGui_ImplVulkan_SetupRenderState; the viewport is left as set there
+    float constants[4];
+    constants[0] = 2.0f / drawData->DisplaySize.x;
+    constants[1] = 2.0f / drawData->DisplaySize.y;
+    constants[2] = -1.0f - drawData->DisplayPos.x * constants[0];
+    constants[3] = -1.0f - drawData->DisplayPos.y * constants[1];
+    vkCmdPushConstants(command_buffer, m_ShapePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants),
+                       constants);
+
+    const float fb_width = drawData->DisplaySize.x * drawData->FramebufferScale.x;
+    const float fb_height = drawData->DisplaySize.y * drawData->FramebufferScale.y;
+    float clip_min_x = (clipRect.x - drawData->DisplayPos.x) * drawData->FramebufferScale.x;
+    float clip_min_y = (clipRect.y - drawData->DisplayPos.y) * drawData->FramebufferScale.y;
+    float clip_max_x = (clipRect.z - drawData->DisplayPos.x) * drawData->FramebufferScale.x;
+    float clip_max_y = (clipRect.w - drawData->DisplayPos.y) * drawData->FramebufferScale.y;
+    if (clip_min_x < 0.0f) clip_min_x = 0.0f;
+    if (clip_min_y < 0.0f) clip_min_y = 0.0f;
+    if (clip_max_x > fb_width) clip_max_x = fb_width;
+    if (clip_max_y > fb_height) clip_max_y = fb_height;
+    if (clip_max_x <= clip_min_x || clip_max_y <= clip_min_y)
+        return;
+    VkRect2D scissor;
+    scissor.offset.x = (int32_t) clip_min_x;
+    scissor.offset.y = (int32_t) clip_min_y;
+    scissor.extent.width = (uint32_t) (clip_max_x - clip_min_x);
+    scissor.extent.height = (uint32_t) (clip_max_y - clip_min_y);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+    vkCmdDrawIndexed(command_buffer, shapeCount * 6, 1, firstShape * 6, 0, 0);
+}
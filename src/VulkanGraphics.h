@@ -7,6 +7,7 @@
 
 
 #include <memory>
+#include <vector>
 #include "vulkan_wrapper.h"
 #include "AndroidImgui.h"
 #include "imgui_impl_vulkan.h"
@@ -20,8 +21,47 @@ private:
         VkSampler Sampler = VK_NULL_HANDLE;
         VkBuffer UploadBuffer = VK_NULL_HANDLE;
         VkDeviceMemory UploadBufferMemory = VK_NULL_HANDLE;
+        VkFramebuffer Framebuffer = VK_NULL_HANDLE;
+        VkDeviceSize ImageMemorySize = 0;
+        VkDeviceSize UploadMemorySize = 0;
     };
 
+    struct ShapeBuffer {
+        VkBuffer Buffer = VK_NULL_HANDLE;
+        VkDeviceMemory Memory = VK_NULL_HANDLE;
+        VkDeviceSize Size = 0;
+        uint32_t Generation = 0;
+    };
+
+    // Staging of the UpdateTexture copies recorded into one frame, reused once that frame's fence signalled
+    struct UploadRing {
+        ShapeBuffer Staging;
+        VkDeviceSize Used = 0;
+    };
+
+    // Removed while submitted frames may still sample it, destroyed once a fence covers Serial
+    struct RetiredTexture {
+        VulkanTextureData *Texture;
+        uint64_t Serial;
+    };
+
+    // Swapchain images can't be copied from, a capture renders the frame once more into Target and copies that
+    struct Readback {
+        VulkanTextureData *Target = nullptr;
+        VkBuffer Buffer = VK_NULL_HANDLE;
+        VkDeviceMemory Memory = VK_NULL_HANDLE;
+        VkDeviceSize Size = 0;
+        void *Mapped = nullptr;
+        VkFence Fence = VK_NULL_HANDLE;
+    };
+
+    static constexpr int kMaxReadbacks = 2;
+
+    // ImGui_ImplVulkan_RenderDrawData calls per frame: the main pass, one WindowRenderCache pass, a capture and the
+    // untimed and timed pass of a SwitchableGraphics probe frame. Each call takes the next vertex/index buffer pair
+    // of a ring of ImageCount * kRenderPassesPerFrame, more calls would overwrite buffers of frames in flight
+    static constexpr int kRenderPassesPerFrame = 5;
+
     VkAllocationCallbacks *m_Allocator = nullptr;
     VkInstance m_Instance = VK_NULL_HANDLE;
     VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
@@ -31,14 +71,43 @@ private:
     VkDebugReportCallbackEXT m_DebugReport = VK_NULL_HANDLE;
     VkPipelineCache m_PipelineCache = VK_NULL_HANDLE;
     VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    uint32_t m_DescriptorCount = 0;
+    VkRenderPass m_TargetRenderPass = VK_NULL_HANDLE;
+
+    // Analytic shapes: shared quad index buffer, one vertex buffer per swapchain image
+    VkPipelineLayout m_ShapePipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_ShapePipeline = VK_NULL_HANDLE;
+    ShapeBuffer m_ShapeIndexBuffer;
+    std::vector<ShapeBuffer> m_ShapeVertexBuffers;
+    // WindowRenderCache quads, bound by BlendPremultiplied in place of ImGui's pipeline
+    VkDescriptorSetLayout m_PremultipliedSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_PremultipliedPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_PremultipliedPipeline = VK_NULL_HANDLE;
+    ImDrawData *m_CurrentDrawData = nullptr;
+    // One per swapchain image
+    std::vector<UploadRing> m_Uploads;
+
+    // Fenced submissions so far, the last one per swapchain image and the last known complete
+    uint64_t m_SubmitSerial = 0;
+    std::vector<uint64_t> m_FrameSerials;
+    uint64_t m_CompletedSerial = 0;
+    std::vector<RetiredTexture> m_Retired;
+
+    // Ring of readbacks, m_ReadbackCount in flight from m_ReadbackHead on
+    Readback m_Readbacks[kMaxReadbacks];
+    int m_ReadbackHead = 0;
+    int m_ReadbackCount = 0;
 
     std::unique_ptr<ImGui_ImplVulkanH_Window> wd{};
     int m_MinImageCount = 2;
     bool m_SwapChainRebuild = false;
+    bool m_FrameBegun = false;
 
     int m_LastWidth = 0;
     int m_LastHeight = 0;
 public:
+    bool CreateDevice() override;
+
     bool Create() override;
 
     void Setup() override;
@@ -53,11 +122,75 @@ public:
 
     BaseTexData *LoadTexture(BaseTexData *tex_data, void *pixel_data) override;
 
+    bool UpdateTexture(BaseTexData *tex_data, const void *pixel_data, int x, int y, int width, int height) override;
+
     void RemoveTexture(BaseTexData *tex_data) override;
 
+    BaseTexData *CreateRenderTarget(int width, int height) override;
+
+    bool RenderToTarget(BaseTexData *target, ImDrawData *drawData) override;
+
+    void RemoveRenderTarget(BaseTexData *target) override;
+
+    void WaitIdle() override;
+
+    TextureMemory GetTextureMemory(BaseTexData *tex_data) override;
+
+    void ReportMemory(MemoryReport &report) override;
+
+    void TrimMemory(TrimLevel level, const std::vector<BaseTexData *> &textures) override;
+
+    void RenderShapes(const ShapeFrame &frame, int firstShape, int shapeCount, const ImVec4 &clipRect) override;
+
+    void BlendPremultiplied() override;
+
+    bool CanCapture() override { return true; }
+
 private:
     VkPhysicalDevice SetupVulkan_SelectPhysicalDevice();
 
+    bool BeginFrameCommands();
+
+    void CreateTextureImage(VulkanTextureData *tex_data, VkFormat format, VkImageUsageFlags usage,
+                            VkSamplerAddressMode address_mode);
+
+    void DestroyTexture(VulkanTextureData *tex_data);
+
+    // Submits the frame's commands under the next serial
+    void SubmitFrame(VkFence fence, const VkSubmitInfo &info);
+
+    // Destroys retired textures the GPU is done with, all of them once the device is idle
+    void ReleaseRetired(bool all);
+
+    // Copies the pixels through the texture's upload buffer and waits for the copy
+    void UploadPixels(VulkanTextureData *tex_data, const void *pixel_data);
+
+    VkPipeline CreatePipeline(const uint32_t *vert_spv, size_t vert_size, const uint32_t *frag_spv, size_t frag_size,
+                              const VkPipelineVertexInputStateCreateInfo &vertex_info, VkPipelineLayout layout,
+                              VkBlendFactor src_color_factor);
+
+    bool CreateShapePipeline();
+
+    bool CreatePremultipliedPipeline();
+
+    void DestroyPremultipliedPipeline();
+
+    void CreateShapeBuffer(ShapeBuffer &buffer, VkDeviceSize size, VkBufferUsageFlags usage);
+
+    void DestroyShapeBuffer(ShapeBuffer &buffer);
+
+    void DestroyShapeObjects();
+
+    void DestroyUploads();
+
+    // Records the offscreen pass and the copy into the frame's command buffer; false when no readback is free
+    bool RecordReadback(ImDrawData *drawData);
+
+    // Hands finished readbacks to their captures; wait blocks until all are done
+    void CollectReadbacks(bool wait);
+
+    void DestroyReadbacks();
+
     uint32_t findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties);
 };
 
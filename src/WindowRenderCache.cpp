@@ -0,0 +1,216 @@
+#include "imgui_internal.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include "WindowRenderCache.h"
+#include "AndroidImgui.h"
+
+static uint64_t HashBytes(const void *data, size_t size, uint64_t seed) {
+    auto p = (const uint8_t *) data;
+    uint64_t h = seed ^ (size * 0x9E3779B97F4A7C15ull);
+    while (size >= 8) {
+        uint64_t k;
+        memcpy(&k, p, 8);
+        h = (h ^ k) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+        p += 8;
+        size -= 8;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p, size);
+    h = (h ^ tail) * 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 29);
+}
+
+void WindowRenderCache::BlendCallback(const ImDrawList *parentList, const ImDrawCmd *cmd) {
+    ((AndroidImgui *) cmd->UserCallbackData)->BlendPremultiplied();
+}
+
+void WindowRenderCache::ReplaceWithQuad(ImDrawList *drawList, const Entry &entry) {
+    const BaseTexData *tex = entry.Target;
+    const float x = entry.X;
+    const float y = entry.Y;
+    const float w = (float) entry.Width;
+    const float h = (float) entry.Height;
+    drawList->CmdBuffer.resize(3);
+    drawList->VtxBuffer.resize(4);
+    drawList->IdxBuffer.resize(6);
+
+    // The quad between a blend switch and ImGui's own state
+    ImDrawCmd *cmds = drawList->CmdBuffer.Data;
+    for (int i = 0; i < 3; i++) {
+        cmds[i] = ImDrawCmd();
+        cmds[i].ClipRect = ImVec4(x, y, x + w, y + h);
+    }
+    cmds[0].UserCallback = BlendCallback;
+    cmds[0].UserCallbackData = &m_Owner;
+    cmds[1].TexRef = ImTextureRef((ImTextureID) (intptr_t) tex->DS);
+    cmds[1].ElemCount = 6;
+    cmds[2].UserCallback = ImDrawCallback_ResetRenderState;
+
+    ImDrawVert *vtx = drawList->VtxBuffer.Data;
+    vtx[0] = {ImVec2(x, y), ImVec2(tex->U0, tex->V0), IM_COL32_WHITE};
+    vtx[1] = {ImVec2(x + w, y), ImVec2(tex->U1, tex->V0), IM_COL32_WHITE};
+    vtx[2] = {ImVec2(x + w, y + h), ImVec2(tex->U1, tex->V1), IM_COL32_WHITE};
+    vtx[3] = {ImVec2(x, y + h), ImVec2(tex->U0, tex->V1), IM_COL32_WHITE};
+
+    ImDrawIdx *idx = drawList->IdxBuffer.Data;
+    idx[0] = 0;
+    idx[1] = 1;
+    idx[2] = 2;
+    idx[3] = 0;
+    idx[4] = 2;
+    idx[5] = 3;
+}
+
+void WindowRenderCache::SetCached(const char *name, bool cached) {
+    auto it = std::find_if(m_Entries.begin(), m_Entries.end(), [name](const Entry &entry) {
+        return entry.Name == name;
+    });
+    if (cached) {
+        if (it == m_Entries.end()) {
+            m_Entries.emplace_back().Name = name;
+        }
+    } else if (it != m_Entries.end()) {
+        ReleaseTarget(*it);
+        m_Entries.erase(it);
+    }
+}
+
+void WindowRenderCache::Update(ImDrawData *drawData) {
+    if (m_Entries.empty() || drawData == nullptr || !drawData->Valid)
+        return;
+
+    int renders = 0;
+    bool modified = false;
+    for (auto &entry: m_Entries) {
+        ImGuiWindow *window = ImGui::FindWindowByName(entry.Name.c_str());
+        ImDrawList *drawList = window ? window->DrawList : nullptr;
+        if (drawList == nullptr || !drawData->CmdLists.contains(drawList) || drawList->CmdBuffer.Size == 0) {
+            entry.StableFrames = 0;
+            entry.Valid = false;
+            if (entry.HiddenFrames < kReleaseHiddenFrames && ++entry.HiddenFrames == kReleaseHiddenFrames)
+                ReleaseTarget(entry);
+            continue;
+        }
+        entry.HiddenFrames = 0;
+
+        uint64_t hash = HashBytes(drawList->VtxBuffer.Data, drawList->VtxBuffer.size_in_bytes(), 0);
+        hash = HashBytes(drawList->IdxBuffer.Data, drawList->IdxBuffer.size_in_bytes(), hash);
+        bool cacheable = true;
+        ImVec4 clip(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (const ImDrawCmd &cmd: drawList->CmdBuffer) {
+            if (cmd.UserCallback != nullptr) {
+                cacheable = false;
+                break;
+            }
+            const uint32_t counts[] = {cmd.VtxOffset, cmd.IdxOffset, cmd.ElemCount};
+            hash = HashBytes(&cmd.ClipRect, sizeof(cmd.ClipRect), hash);
+            hash = HashBytes(&cmd.TexRef, sizeof(cmd.TexRef), hash);
+            hash = HashBytes(counts, sizeof(counts), hash);
+            clip.x = std::min(clip.x, cmd.ClipRect.x);
+            clip.y = std::min(clip.y, cmd.ClipRect.y);
+            clip.z = std::max(clip.z, cmd.ClipRect.z);
+            clip.w = std::max(clip.w, cmd.ClipRect.w);
+        }
+        if (!cacheable) {
+            entry.StableFrames = 0;
+            entry.Valid = false;
+            continue;
+        }
+        if (hash != entry.Hash) {
+            entry.Hash = hash;
+            entry.StableFrames = 0;
+            entry.Valid = false;
+            continue;
+        }
+
+        if (!entry.Valid) {
+            if (++entry.StableFrames < kStableFrames || renders >= kMaxRendersPerFrame)
+                continue;
+
+            // Captured rect: vertex bounds limited by the clip rects and the display
+            ImVec4 bounds(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+            for (const ImDrawVert &vtx: drawList->VtxBuffer) {
+                bounds.x = std::min(bounds.x, vtx.pos.x);
+                bounds.y = std::min(bounds.y, vtx.pos.y);
+                bounds.z = std::max(bounds.z, vtx.pos.x);
+                bounds.w = std::max(bounds.w, vtx.pos.y);
+            }
+            float x0 = std::floor(std::max({bounds.x, clip.x, drawData->DisplayPos.x}));
+            float y0 = std::floor(std::max({bounds.y, clip.y, drawData->DisplayPos.y}));
+            float x1 = std::ceil(std::min({bounds.z, clip.z, drawData->DisplayPos.x + drawData->DisplaySize.x}));
+            float y1 = std::ceil(std::min({bounds.w, clip.w, drawData->DisplayPos.y + drawData->DisplaySize.y}));
+            if (x1 <= x0 || y1 <= y0)
+                continue;
+            entry.X = x0;
+            entry.Y = y0;
+            entry.Width = (int) (x1 - x0);
+            entry.Height = (int) (y1 - y0);
+
+            renders++;
+            entry.Valid = RenderEntry(entry, drawList, drawData);
+            if (!entry.Valid)
+                continue;
+        }
+
+        ReplaceWithQuad(drawList, entry);
+        modified = true;
+    }
+
+    if (modified) {
+        drawData->TotalVtxCount = 0;
+        drawData->TotalIdxCount = 0;
+        for (ImDrawList *drawList: drawData->CmdLists) {
+            drawData->TotalVtxCount += drawList->VtxBuffer.Size;
+            drawData->TotalIdxCount += drawList->IdxBuffer.Size;
+        }
+    }
+}
+
+bool WindowRenderCache::RenderEntry(Entry &entry, ImDrawList *drawList, ImDrawData *drawData) {
+    if (entry.Target && (entry.Target->Width != entry.Width || entry.Target->Height != entry.Height)) {
+        ReleaseTarget(entry);
+    }
+    if (entry.Target == nullptr) {
+        entry.Target = m_Owner.CreateRenderTarget(entry.Width, entry.Height);
+        if (entry.Target == nullptr)
+            return false;
+    }
+
+    ImDrawData windowData;
+    windowData.Valid = true;
+    windowData.CmdLists.push_back(drawList);
+    windowData.CmdListsCount = 1;
+    windowData.TotalVtxCount = drawList->VtxBuffer.Size;
+    windowData.TotalIdxCount = drawList->IdxBuffer.Size;
+    windowData.DisplayPos = ImVec2(entry.X, entry.Y);
+    windowData.DisplaySize = ImVec2((float) entry.Width, (float) entry.Height);
+    windowData.FramebufferScale = ImVec2(1.0f, 1.0f);
+    windowData.OwnerViewport = drawData->OwnerViewport;
+    windowData.Textures = drawData->Textures;
+    return m_Owner.RenderToTarget(entry.Target, &windowData);
+}
+
+void WindowRenderCache::ReleaseTarget(Entry &entry) {
+    if (entry.Target) {
+        m_Owner.RemoveRenderTarget(entry.Target);
+        entry.Target = nullptr;
+    }
+    entry.Valid = false;
+}
+
+void WindowRenderCache::Clear() {
+    for (auto &entry: m_Entries) {
+        ReleaseTarget(entry);
+        entry.StableFrames = 0;
+    }
+}
+
+void WindowRenderCache::CollectTargets(std::vector<BaseTexData *> &targets) const {
+    for (auto &entry: m_Entries) {
+        if (entry.Target)
+            targets.push_back(entry.Target);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef ANDROIDIMGUI_WINDOWRENDERCACHE_H
+#define ANDROIDIMGUI_WINDOWRENDERCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class AndroidImgui;
+struct BaseTexData;
+struct ImDrawData;
+struct ImDrawList;
+struct ImDrawCmd;
+
+// Keeps opted-in windows in offscreen textures. A window whose draw list hash (geometry, clip rects, textures,
+// position) stays the same for a few frames is rendered once into a target and then composited as one quad.
+// ImGui's blending leaves premultiplied colour in the cleared target, the quad is blended with ONE,
+// ONE_MINUS_SRC_ALPHA so translucent windows look as uncached. Windows using draw callbacks are skipped.
+class WindowRenderCache {
+public:
+    explicit WindowRenderCache(AndroidImgui &owner) : m_Owner(owner) {}
+
+    void SetCached(const char *name, bool cached);
+
+    void Update(ImDrawData *drawData);
+
+    // Releases every render target, entries stay registered
+    void Clear();
+
+    void CollectTargets(std::vector<BaseTexData *> &targets) const;
+
+private:
+    struct Entry {
+        std::string Name;
+        uint64_t Hash = 0;
+        int StableFrames = 0;
+        bool Valid = false;
+        int HiddenFrames = 0;
+        BaseTexData *Target = nullptr;
+        float X = 0.0f;
+        float Y = 0.0f;
+        int Width = 0;
+        int Height = 0;
+    };
+
+    static constexpr int kStableFrames = 3;
+    static constexpr int kMaxRendersPerFrame = 1;
+    // A window hidden this long gives its target back
+    static constexpr int kReleaseHiddenFrames = 120;
+
+    static void BlendCallback(const ImDrawList *parentList, const ImDrawCmd *cmd);
+
+    void ReplaceWithQuad(ImDrawList *drawList, const Entry &entry);
+
+    bool RenderEntry(Entry &entry, ImDrawList *drawList, ImDrawData *drawData);
+
+    void ReleaseTarget(Entry &entry);
+
+    AndroidImgui &m_Owner;
+    std::vector<Entry> m_Entries;
+};
+
+#endif //ANDROIDIMGUI_WINDOWRENDERCACHE_H
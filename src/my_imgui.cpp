@@ -1,4 +1,6 @@
 #include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
 #include "my_imgui.h"
 
 namespace ImGui {
@@ -992,8 +994,7 @@ namespace ImGui {
     }
 
 
-    bool Android_LoadSystemFont(float SizePixels) {
-        char path[64]{0};
+    static bool FindSystemFont(char (&path)[64]) {
         char* filename = nullptr;
         const char* fontPath[] = {
             "/system/fonts", "/system/font", "/data/fonts"
@@ -1016,9 +1017,49 @@ namespace ImGui {
                 return false;
             }
         }
+        return true;
+    }
+
+    bool Android_LoadSystemFont(float SizePixels) {
+        char path[64]{0};
+        if (!FindSystemFont(path)) {
+            return false;
+        }
         ImFontConfig config;
         config.FontDataOwnedByAtlas = false;
         config.SizePixels = SizePixels;
         return ImGui::GetIO().Fonts->AddFontFromFileTTF(path, 0, &config);
     }
+
+    void* Android_ReadSystemFont(size_t* size) {
+        char path[64]{0};
+        if (!FindSystemFont(path)) {
+            return nullptr;
+        }
+        FILE* file = fopen(path, "rb");
+        if (!file) {
+            return nullptr;
+        }
+        void* data = nullptr;
+        long length = 0;
+        if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data = malloc((size_t)length);
+            if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+                free(data);
+                data = nullptr;
+            }
+        }
+        fclose(file);
+        if (data) {
+            *size = (size_t)length;
+        }
+        return data;
+    }
+
+    ImFont* Android_AddSystemFont(void* data, size_t size, float SizePixels) {
+        ImFontConfig config;
+        config.FontDataOwnedByAtlas = false;
+        config.SizePixels = SizePixels;
+        return ImGui::GetIO().Fonts->AddFontFromMemoryTTF(data, (int)size, 0, &config);
+    }
 }
@@ -5,7 +5,23 @@
 namespace ImGui {
     bool Android_LoadSystemFont(float SizePixels);
 
+    // Reads the system CJK font into malloc'ed memory without touching ImGui state, so it can run on any thread
+    void *Android_ReadSystemFont(size_t *size);
+
+    // Adds font data from Android_ReadSystemFont, the caller keeps it alive until the context is destroyed
+    ImFont *Android_AddSystemFont(void *data, size_t size, float SizePixels);
+
     const ImWchar *GetGlyphRangesChineseTraditionalOfficial();
 
     const ImWchar *GetGlyphRangesChineseSimplifiedOfficial();
+
+    // Analytic shapes: one quad per shape, edges evaluated per pixel by the backend. thickness 0 = filled. UI thread
+    void Android_AddRectSDF(ImDrawList *drawList, const ImVec2 &pMin, const ImVec2 &pMax, ImU32 col,
+                            float rounding = 0.0f, float thickness = 0.0f);
+
+    void Android_AddCircleSDF(ImDrawList *drawList, const ImVec2 &center, float radius, ImU32 col,
+                              float thickness = 0.0f);
+
+    void Android_AddLineSDF(ImDrawList *drawList, const ImVec2 &p1, const ImVec2 &p2, ImU32 col,
+                            float thickness = 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "my_imgui_impl_host.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+struct HostInputEvent {
+    enum Type {
+        MousePos,
+        MouseButton,
+        MouseWheel,
+        Text
+    };
+
+    int Frame;
+    Type EventType;
+    float X;
+    float Y;
+    int Button;
+    bool Down;
+    std::string Chars;
+};
+
+static double g_Time = 0.0;
+static float g_FixedDeltaTime = 0.0f;
+static int g_FrameCount = 0;
+static std::vector<HostInputEvent> g_Events;
+static size_t g_NextEvent = 0;
+
+static void QueueEvent(HostInputEvent event) {
+    // Keep the queue ordered by frame, events of the same frame stay in submission order
+    auto it = std::upper_bound(g_Events.begin() + (long) g_NextEvent, g_Events.end(), event.Frame,
+                               [](int frame, const HostInputEvent &e) { return frame < e.Frame; });
+    g_Events.insert(it, std::move(event));
+}
+
+bool My_ImGui_ImplHost_Init(float width, float height) {
+    g_Time = 0.0;
+    g_FrameCount = 0;
+
+    ImGuiIO &io = ImGui::GetIO();
+    io.BackendPlatformName = "imgui_impl_host";
+    io.DisplaySize = ImVec2(width, height);
+    io.DisplayFramebufferScale = ImVec2(1.0f, 1.0f);
+    return true;
+}
+
+void My_ImGui_ImplHost_Shutdown() {
+    ImGuiIO &io = ImGui::GetIO();
+    io.BackendPlatformName = nullptr;
+    g_Events.clear();
+    g_NextEvent = 0;
+}
+
+void My_ImGui_ImplHost_NewFrame() {
+    ImGuiIO &io = ImGui::GetIO();
+
+    if (g_FixedDeltaTime > 0.0f) {
+        io.DeltaTime = g_FixedDeltaTime;
+    } else {
+        struct timespec current_timespec;
+        clock_gettime(CLOCK_MONOTONIC, &current_timespec);
+        double current_time = (double) (current_timespec.tv_sec) + (current_timespec.tv_nsec / 1000000000.0);
+        io.DeltaTime = g_Time > 0.0 ? (float) (current_time - g_Time) : (float) (1.0f / 60.0f);
+        g_Time = current_time;
+    }
+
+    for (; g_NextEvent < g_Events.size() && g_Events[g_NextEvent].Frame <= g_FrameCount; g_NextEvent++) {
+        const HostInputEvent &event = g_Events[g_NextEvent];
+        switch (event.EventType) {
+            case HostInputEvent::MousePos:
+                io.AddMouseSourceEvent(ImGuiMouseSource_TouchScreen);
+                io.AddMousePosEvent(event.X, event.Y);
+                break;
+            case HostInputEvent::MouseButton:
+                io.AddMouseSourceEvent(ImGuiMouseSource_TouchScreen);
+                io.AddMouseButtonEvent(event.Button, event.Down);
+                break;
+            case HostInputEvent::MouseWheel:
+                io.AddMouseWheelEvent(event.X, event.Y);
+                break;
+            case HostInputEvent::Text:
+                io.AddInputCharactersUTF8(event.Chars.c_str());
+                break;
+        }
+    }
+    g_FrameCount++;
+}
+
+void My_ImGui_ImplHost_SetFixedDeltaTime(float dt) {
+    g_FixedDeltaTime = dt;
+}
+
+int My_ImGui_ImplHost_GetFrameCount() {
+    return g_FrameCount;
+}
+
+void My_ImGui_ImplHost_QueueMousePos(int frame, float x, float y) {
+    QueueEvent({frame, HostInputEvent::MousePos, x, y, 0, false, {}});
+}
+
+void My_ImGui_ImplHost_QueueMouseButton(int frame, int button, bool down) {
+    QueueEvent({frame, HostInputEvent::MouseButton, 0.0f, 0.0f, button, down, {}});
+}
+
+void My_ImGui_ImplHost_QueueMouseWheel(int frame, float wheel_x, float wheel_y) {
+    QueueEvent({frame, HostInputEvent::MouseWheel, wheel_x, wheel_y, 0, false, {}});
+}
+
+void My_ImGui_ImplHost_QueueText(int frame, const char *text) {
+    QueueEvent({frame, HostInputEvent::Text, 0.0f, 0.0f, 0, false, text});
+}
+
+bool My_ImGui_ImplHost_LoadScript(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open input script %s\n", path);
+        return false;
+    }
+
+    char line[512];
+    int line_number = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        int frame = 0;
+        char action[16] = {};
+        int consumed = 0;
+        if (line[0] == '#' || sscanf(line, "%d %15s %n", &frame, action, &consumed) < 2)
+            continue;
+
+        const char *args = line + consumed;
+        float x = 0.0f, y = 0.0f;
+        int button = 0;
+        if (strcmp(action, "move") == 0 && sscanf(args, "%f %f", &x, &y) == 2) {
+            My_ImGui_ImplHost_QueueMousePos(frame, x, y);
+        } else if (strcmp(action, "down") == 0 || strcmp(action, "up") == 0) {
+            sscanf(args, "%d", &button);
+            My_ImGui_ImplHost_QueueMouseButton(frame, button, action[0] == 'd');
+        } else if (strcmp(action, "wheel") == 0 && sscanf(args, "%f %f", &x, &y) == 2) {
+            My_ImGui_ImplHost_QueueMouseWheel(frame, x, y);
+        } else if (strcmp(action, "text") == 0) {
+            My_ImGui_ImplHost_QueueText(frame, args);
+        } else {
+            fprintf(stderr, "%s:%d: unrecognized event '%s'\n", path, line_number, line);
+            ok = false;
+        }
+    }
+    fclose(file);
+    return ok;
+}
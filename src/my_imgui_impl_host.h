@@ -0,0 +1,29 @@
+#pragma once
+
+#include "imgui.h"
+
+// Platform layer without a window: display size is fixed at Init, time is the host clock or a fixed step,
+// input comes from events scheduled on frame numbers (frame 0 is the first NewFrame after Init).
+
+bool My_ImGui_ImplHost_Init(float width, float height);
+
+void My_ImGui_ImplHost_Shutdown();
+
+void My_ImGui_ImplHost_NewFrame();
+
+// 0 uses the monotonic clock, anything else advances time by exactly dt per frame
+void My_ImGui_ImplHost_SetFixedDeltaTime(float dt);
+
+int My_ImGui_ImplHost_GetFrameCount();
+
+void My_ImGui_ImplHost_QueueMousePos(int frame, float x, float y);
+
+void My_ImGui_ImplHost_QueueMouseButton(int frame, int button, bool down);
+
+void My_ImGui_ImplHost_QueueMouseWheel(int frame, float wheel_x, float wheel_y);
+
+void My_ImGui_ImplHost_QueueText(int frame, const char *text);
+
+// One event per line: "<frame> move <x> <y>", "<frame> down|up [button]", "<frame> wheel <x> <y>",
+// "<frame> text <utf8...>". Empty lines and lines starting with '#' are ignored.
+bool My_ImGui_ImplHost_LoadScript(const char *path);
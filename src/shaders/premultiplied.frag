@@ -0,0 +1,13 @@
+#version 450 core
+layout(location = 0) out vec4 fColor;
+
+layout(set = 0, binding = 0) uniform sampler2D sTexture;
+
+layout(location = 0) in vec4 Color;
+layout(location = 1) in vec2 UV;
+
+void main()
+{
+    // The texture's colour is premultiplied, the vertex colour is too once scaled by its alpha
+    fColor = texture(sTexture, UV) * vec4(Color.rgb * Color.a, Color.a);
+}
@@ -0,0 +1,17 @@
+#version 450 core
+layout(location = 0) out vec4 fColor;
+
+layout(location = 0) in vec4 Color;
+layout(location = 1) in vec2 Local;
+layout(location = 2) in vec2 Half;
+layout(location = 3) in vec2 Shape; // radius, stroke
+
+void main()
+{
+    float radius = Shape.x;
+    vec2 q = abs(Local) - Half + radius;
+    float d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+    if (Shape.y > 0.0)
+        d = abs(d) - Shape.y * 0.5;
+    fColor = vec4(Color.rgb, Color.a * clamp(0.5 - d, 0.0, 1.0));
+}
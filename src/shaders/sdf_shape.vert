@@ -0,0 +1,23 @@
+#version 450 core
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec2 aLocal;
+layout(location = 2) in vec2 aHalf;
+layout(location = 3) in vec2 aShape;
+layout(location = 4) in vec4 aColor;
+
+layout(push_constant) uniform uPushConstant { vec2 uScale; vec2 uTranslate; } pc;
+
+out gl_PerVertex { vec4 gl_Position; };
+layout(location = 0) out vec4 Color;
+layout(location = 1) out vec2 Local;
+layout(location = 2) out vec2 Half;
+layout(location = 3) out vec2 Shape;
+
+void main()
+{
+    Color = aColor;
+    Local = aLocal;
+    Half = aHalf;
+    Shape = aShape;
+    gl_Position = vec4(aPos * pc.uScale + pc.uTranslate, 0, 1);
+}
@@ -5,6 +5,7 @@
 #include <linux/input.h>
 #include <linux/uinput.h>
 #include <vector>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
 #include "spinlock.h"
@@ -48,6 +49,14 @@ namespace Touch {
 
     static spinlock lock;
 
+    static std::mutex policyLock;
+
+    static ThreadPolicy threadPolicy;
+
+    static bool hasThreadPolicy = false;
+
+    static std::vector<int> readerThreads;
+
     void Upload() {
         static bool isFirstDown = true;
         int tmpCnt = 0, tmpCnt2 = 0;
@@ -183,6 +192,12 @@ namespace Touch {
         int latest = 0;
         input_event inputEvent[64]{0};
 
+        {
+            std::lock_guard<std::mutex> guard(policyLock);
+            readerThreads.push_back(ThreadTuning::CurrentThreadId());
+            if (hasThreadPolicy)
+                ThreadTuning::Apply(0, threadPolicy);
+        }
         while (initialized) {
             auto readSize = (int32_t) read(device.fd, inputEvent, sizeof(inputEvent));
             if (readSize <= 0 || (readSize % sizeof(input_event)) != 0) {
@@ -450,9 +465,21 @@ namespace Touch {
             memset(input.event, 0, sizeof(input.event));
             initialized = false;
             devices.clear();
+            std::lock_guard<std::mutex> guard(policyLock);
+            readerThreads.clear();
         }
     }
 
+    bool SetThreadPolicy(const ThreadPolicy &policy) {
+        std::lock_guard<std::mutex> guard(policyLock);
+        threadPolicy = policy;
+        hasThreadPolicy = true;
+        bool applied = true;
+        for (int tid: readerThreads)
+            applied &= ThreadTuning::Apply(tid, policy);
+        return applied;
+    }
+
     void Down(float x, float y) {
         lock.lock();
         touchObj &touch = devices[0].Finger[9];
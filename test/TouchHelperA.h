@@ -3,6 +3,7 @@
 #include <linux/input.h>
 #include <vector>
 #include <functional>
+#include "ThreadPolicy.h"
 #include "VectorStruct.h"
 
 namespace Touch {
@@ -45,4 +46,7 @@ namespace Touch {
     void setOrientation(int orientation);
 
     void setOtherTouch(bool p_otherTouch);
+
+    // Reader threads, the ones running and those started by later Inits
+    bool SetThreadPolicy(const ThreadPolicy &policy);
 }
@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <semaphore>
+#include <thread>
+
+#include "GraphicsManager.h"
+#include "DrawCommandQueue.h"
+
+// A thread releases its DrawCommandQueue slot, a second thread claims it, then the first thread draws again: both
+// threads' commands have to reach the frame. Then more threads than there are slots draw one after another and
+// exit without ReleaseThread, the last one still has to get a slot. Exits with 1 when commands got lost.
+// usage: AndroidImguiDrawQueueRelease
+static bool HasColor(const ImDrawList *drawList, ImU32 col) {
+    for (const ImDrawVert &vert: drawList->VtxBuffer) {
+        if (vert.col == col)
+            return true;
+    }
+    return false;
+}
+
+int main() {
+    auto graphics = GraphicsManager::getGraphicsInterface(GraphicsManager::HEADLESS);
+    graphics->Init(nullptr, 640.0f, 480.0f);
+    DrawCommandQueue &queue = graphics->GetDrawQueue();
+
+    const ImU32 first = IM_COL32(255, 0, 0, 255);
+    const ImU32 second = IM_COL32(0, 255, 0, 255);
+    std::binary_semaphore firstGo{0}, firstDone{0}, secondGo{0}, secondDone{0};
+
+    std::thread a([&] {
+        queue.AddRectFilled(ImVec2(0.0f, 0.0f), ImVec2(10.0f, 10.0f), IM_COL32(0, 0, 255, 255));
+        queue.Submit();
+        queue.ReleaseThread();
+        firstDone.release();
+        firstGo.acquire();
+        // Claims a free slot again instead of writing into the one the second thread holds now
+        queue.AddRectFilled(ImVec2(20.0f, 0.0f), ImVec2(30.0f, 10.0f), first);
+        queue.Submit();
+        firstDone.release();
+        firstGo.acquire();
+        queue.ReleaseThread();
+    });
+    firstDone.acquire();
+
+    std::thread b([&] {
+        queue.AddRectFilled(ImVec2(40.0f, 0.0f), ImVec2(50.0f, 10.0f), second);
+        secondDone.release();
+        secondGo.acquire();
+        queue.Submit();
+        secondDone.release();
+        secondGo.acquire();
+        queue.ReleaseThread();
+    });
+    secondDone.acquire();
+    firstGo.release();
+    firstDone.acquire();
+    secondGo.release();
+    secondDone.acquire();
+
+    graphics->NewFrame();
+    ImDrawList *drawList = ImGui::GetBackgroundDrawList();
+    bool ok = HasColor(drawList, first) && HasColor(drawList, second);
+    graphics->EndFrame();
+
+    firstGo.release();
+    secondGo.release();
+    a.join();
+    b.join();
+
+    for (int i = 0; i < DrawCommandQueue::kMaxThreads; i++) {
+        std::thread([&] {
+            queue.AddRectFilled(ImVec2(0.0f, 20.0f), ImVec2(10.0f, 30.0f), IM_COL32(0, 0, 255, 255));
+            queue.Submit();
+        }).join();
+    }
+    const ImU32 last = IM_COL32(255, 255, 0, 255);
+    std::binary_semaphore lastGo{0}, lastDone{0};
+    std::thread c([&] {
+        queue.AddRectFilled(ImVec2(60.0f, 0.0f), ImVec2(70.0f, 10.0f), last);
+        queue.Submit();
+        lastDone.release();
+        lastGo.acquire();
+    });
+    lastDone.acquire();
+    graphics->NewFrame();
+    bool reclaimed = HasColor(ImGui::GetBackgroundDrawList(), last);
+    graphics->EndFrame();
+    lastGo.release();
+    c.join();
+    graphics->Shutdown();
+
+    if (!ok)
+        printf("commands lost after ReleaseThread\n");
+    if (!reclaimed)
+        printf("slots of exited threads weren't released\n");
+    if (ok && reclaimed)
+        printf("ok\n");
+    return ok && reclaimed ? 0 : 1;
+}
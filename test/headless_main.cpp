@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "GraphicsManager.h"
+#include "HeadlessGraphics.h"
+#include "my_imgui.h"
+#include "my_imgui_impl_host.h"
+
+// Runs the demo window headless and reports per-frame CPU time.
+// usage: AndroidImguiHeadless [-n frames] [-s WxH] [-i script] [-t image] [-c capture] [-d frame:path]...
+int main(int argc, char **argv) {
+    int frames = 600;
+    int width = 1920;
+    int height = 1080;
+    const char *script = nullptr;
+    const char *image = nullptr;
+    const char *capture = nullptr;
+
+    auto graphics = GraphicsManager::getGraphicsInterface(GraphicsManager::HEADLESS);
+    auto headless = (HeadlessGraphics *) graphics.get();
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0) {
+            frames = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            sscanf(argv[i + 1], "%dx%d", &width, &height);
+        } else if (strcmp(argv[i], "-i") == 0) {
+            script = argv[i + 1];
+        } else if (strcmp(argv[i], "-t") == 0) {
+            image = argv[i + 1];
+        } else if (strcmp(argv[i], "-c") == 0) {
+            capture = argv[i + 1];
+        } else if (strcmp(argv[i], "-d") == 0) {
+            const char *sep = strchr(argv[i + 1], ':');
+            if (sep)
+                headless->DumpFrame(atoi(argv[i + 1]), sep + 1);
+        }
+    }
+
+    graphics->Init(nullptr, (float) width, (float) height);
+    // Same step every frame so runs with a script are reproducible
+    My_ImGui_ImplHost_SetFixedDeltaTime(1.0f / 60.0f);
+    if (script && !My_ImGui_ImplHost_LoadScript(script))
+        return 1;
+    if (capture && !graphics->StartCapture(capture))
+        return 1;
+
+    BaseTexData *texture = nullptr;
+    if (image) {
+        auto start = std::chrono::steady_clock::now();
+        texture = graphics->LoadTextureFromFile(image);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("texture %s: %s in %.3f ms\n", image, texture ? "loaded" : "failed", ms);
+    }
+
+    double buildTotal = 0.0, renderTotal = 0.0, worst = 0.0;
+    for (int frame = 0; frame < frames; frame++) {
+        auto start = std::chrono::steady_clock::now();
+        graphics->NewFrame();
+        ImGui::ShowDemoWindow();
+        if (texture) {
+            ImGui::Begin("texture");
+            ImGui::Image((ImTextureID) (intptr_t) texture->DS, {(float) texture->Width, (float) texture->Height},
+                         {texture->U0, texture->V0}, {texture->U1, texture->V1});
+            ImGui::End();
+        }
+        auto built = std::chrono::steady_clock::now();
+        graphics->EndFrame();
+        auto end = std::chrono::steady_clock::now();
+
+        double buildMs = std::chrono::duration<double, std::milli>(built - start).count();
+        double renderMs = std::chrono::duration<double, std::milli>(end - built).count();
+        buildTotal += buildMs;
+        renderTotal += renderMs;
+        worst = std::max(worst, buildMs + renderMs);
+    }
+
+    int counted = std::max(frames, 1);
+    printf("%d frames at %dx%d: build %.3f ms, render %.3f ms, worst frame %.3f ms\n", frames, width, height,
+           buildTotal / counted, renderTotal / counted, worst);
+    const DrawCallStats &stats = graphics->GetDrawCallStats();
+    printf("last frame draw calls: %d\n", stats.Before);
+    MemoryReport memory = graphics->GetMemoryReport(4);
+    for (int i = 0; i < MemoryReport::CATEGORY_COUNT; i++)
+        printf("memory %s: %zu KiB\n", MemoryReport::CategoryName((MemoryReport::Category) i), memory.Bytes[i] / 1024);
+    for (auto &largest: memory.LargestTextures)
+        printf("texture %s: %zu KiB\n", largest.Source.c_str(), largest.Bytes / 1024);
+
+    if (texture)
+        graphics->DeleteTexture(texture);
+    graphics->Shutdown();
+    return 0;
+}
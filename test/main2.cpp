@@ -1,10 +1,17 @@
 #include <android/native_window_jni.h>
 #include "Jenv/JavaFunc.h"
 #include "GraphicsManager.h"
+#include "StartupPipeline.h"
 #include "my_imgui.h"
 #include "TouchHelperA.h"
 
 int main() {
+    // Device and font atlas come up on workers while JNI and the window are set up here
+    auto graphics = GraphicsManager::getGraphicsInterface(GraphicsManager::VULKAN);
+    StartupOptions startup;
+    startup.FontSize = 26;
+    startup.PrebakeRanges = ImGui::GetGlyphRangesChineseSimplifiedOfficial();
+    graphics->StartInit(startup);
     if (JavaFunc::init() < 0) {
         printf("JavaFunc init failed\n");
         return -1;
@@ -15,9 +22,7 @@ int main() {
     }
     auto jwindow = JavaFunc::createNativeWindow(display.width, display.width, true, false);
     auto window = ANativeWindow_fromSurface(JavaFunc::GetJavaEnv(), jwindow);
-    auto graphics = GraphicsManager::getGraphicsInterface(GraphicsManager::VULKAN);
     graphics->Init(window, display.width, display.width);
-    ImGui::Android_LoadSystemFont(26);
     Touch::Init({(float)display.width, (float)display.height}, true);
 
     static bool flag = true;
@@ -32,6 +37,16 @@ int main() {
         ImGui::End();
 
         graphics->EndFrame();
+
+        static bool reported = false;
+        if (!reported) {
+            reported = true;
+            const StartupTimings &timings = graphics->GetStartupTimings();
+            printf("startup %.1f ms (%.1f ms one after another): device %.1f, font %.1f, jni %.1f, surface %.1f, "
+                   "context %.1f, setup %.1f, waited %.1f + %.1f\n", timings.TotalMs, timings.SerialMs(),
+                   timings.DeviceMs, timings.FontMs, timings.CallerMs, timings.SurfaceMs, timings.ContextMs,
+                   timings.SetupMs, timings.InitWaitMs, timings.FrameWaitMs);
+        }
     }
     graphics->Shutdown();
     JavaFunc::destroyNativeWindow(jwindow);
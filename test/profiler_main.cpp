@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "GraphicsManager.h"
+#include "imgui.h"
+#include "SamplingProfiler.h"
+
+// Profiles headless frames of the demo window plus the profiler's own flame graph and writes folded stacks,
+// e.g. for flamegraph.pl. With --check, profiles a known busy function past the sample ring's capacity and exits
+// with 1 unless samples were dropped, lost or not symbolized to it.
+// usage: AndroidImguiProfile [-n frames] [-o out.folded]
+//        AndroidImguiProfile --check <out.folded>
+extern "C" __attribute__((noinline)) unsigned ProfilerCheckSpin(unsigned value) {
+    for (int i = 0; i < 1000000; i++)
+        value = value * 1664525u + 1013904223u;
+    return value;
+}
+
+static int Check(const char *output) {
+    SamplingProfiler &profiler = SamplingProfiler::Get();
+    if (!profiler.Start(2000)) {
+        printf("profiler didn't start\n");
+        return 1;
+    }
+    // Past the 2048 samples the ring holds, collected often enough that none are dropped
+    volatile unsigned value = 1;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (profiler.GetSampleCount() < 3000 && std::chrono::steady_clock::now() < deadline) {
+        auto collect = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        while (std::chrono::steady_clock::now() < collect)
+            value = ProfilerCheckSpin(value);
+        profiler.Collect();
+    }
+    profiler.Stop();
+    bool ok = profiler.ExportCollapsed(output);
+
+    uint64_t total = 0, spin = 0;
+    if (FILE *file = fopen(output, "r")) {
+        char line[4096];
+        while (fgets(line, sizeof(line), file)) {
+            const char *count = strrchr(line, ' ');
+            if (!count)
+                continue;
+            uint64_t samples = strtoull(count + 1, nullptr, 10);
+            total += samples;
+            if (strstr(line, "ProfilerCheckSpin"))
+                spin += samples;
+        }
+        fclose(file);
+    }
+    printf("%llu samples (%s), %llu dropped, %llu exported, %llu in ProfilerCheckSpin\n",
+           (unsigned long long) profiler.GetSampleCount(), profiler.GetSource(),
+           (unsigned long long) profiler.GetDroppedCount(), (unsigned long long) total, (unsigned long long) spin);
+    if (profiler.GetSampleCount() < 3000) {
+        printf("too few samples to wrap the ring\n");
+        ok = false;
+    }
+    if (profiler.GetDroppedCount() != 0 || total != profiler.GetSampleCount()) {
+        printf("samples were dropped or lost\n");
+        ok = false;
+    }
+    if (spin * 2 < total) {
+        printf("most samples weren't symbolized to ProfilerCheckSpin\n");
+        ok = false;
+    }
+    if (ok)
+        printf("ok\n");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 2 && strcmp(argv[1], "--check") == 0)
+        return Check(argv[2]);
+    int frames = 600;
+    const char *output = "profile.folded";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0)
+            frames = std::max(atoi(argv[i + 1]), 1);
+        else if (strcmp(argv[i], "-o") == 0)
+            output = argv[i + 1];
+    }
+
+    auto graphics = GraphicsManager::getGraphicsInterface(GraphicsManager::HEADLESS);
+    graphics->Init(nullptr, 1920.0f, 1080.0f);
+
+    SamplingProfiler &profiler = SamplingProfiler::Get();
+    if (!profiler.Start(1000)) {
+        fprintf(stderr, "profiler didn't start\n");
+        return 1;
+    }
+    for (int frame = 0; frame < frames; frame++) {
+        graphics->NewFrame();
+        ImGui::ShowDemoWindow();
+        profiler.ShowWindow();
+        graphics->EndFrame();
+    }
+    profiler.Stop();
+
+    bool written = profiler.ExportCollapsed(output);
+    printf("%llu samples (%s), %llu dropped%s%s\n", (unsigned long long) profiler.GetSampleCount(),
+           profiler.GetSource(), (unsigned long long) profiler.GetDroppedCount(), written ? " -> " : "",
+           written ? output : "");
+    graphics->Shutdown();
+    return written ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef __ANDROID__
+#include "ANativeWindowCreator.h"
+#endif
+#include "GraphicsManager.h"
+#include "DrawDataCapture.h"
+#include "my_imgui_impl_host.h"
+
+// Feeds a capture (AndroidImgui::StartCapture) into a backend as fast as it goes and reports frame times.
+// With --check, records a few headless frames into path, replays them and exits with 1 when the geometry differs.
+// usage: AndroidImguiReplay <capture> [-b headless|software|opengl|vulkan] [-l loops]
+//        AndroidImguiReplay --check <path>
+static std::string Snapshot(const ImDrawData *drawData) {
+    std::string out;
+    for (const ImDrawList *list: drawData->CmdLists) {
+        out.append((const char *) list->VtxBuffer.Data, list->VtxBuffer.size_in_bytes());
+        out.append((const char *) list->IdxBuffer.Data, list->IdxBuffer.size_in_bytes());
+        for (const ImDrawCmd &cmd: list->CmdBuffer) {
+            if (cmd.UserCallback)
+                continue;
+            out.append((const char *) &cmd.ClipRect, sizeof(cmd.ClipRect));
+            out.append((const char *) &cmd.VtxOffset, sizeof(cmd.VtxOffset));
+            out.append((const char *) &cmd.IdxOffset, sizeof(cmd.IdxOffset));
+            out.append((const char *) &cmd.ElemCount, sizeof(cmd.ElemCount));
+        }
+    }
+    return out;
+}
+
+static int Check(const char *path) {
+    const int frames = 8;
+    auto graphics = GraphicsManager::getGraphicsInterface(GraphicsManager::HEADLESS);
+    graphics->Init(nullptr, 640.0f, 480.0f);
+    My_ImGui_ImplHost_SetFixedDeltaTime(1.0f / 60.0f);
+    if (!graphics->StartCapture(path)) {
+        printf("can't write %s\n", path);
+        return 1;
+    }
+    std::vector<std::string> recorded;
+    for (int frame = 0; frame < frames; frame++) {
+        graphics->NewFrame();
+        ImGui::ShowDemoWindow();
+        ImGui::GetBackgroundDrawList()->AddRectFilled(ImVec2(10.0f * (float) frame, 0.0f),
+                                                      ImVec2(10.0f * (float) frame + 50.0f, 50.0f),
+                                                      IM_COL32(255, 0, 0, 255));
+        graphics->EndFrame();
+        recorded.push_back(Snapshot(ImGui::GetDrawData()));
+    }
+    graphics->StopCapture();
+
+    DrawDataReplay replay;
+    bool ok = replay.Open(path) && replay.GetFrameCount() == frames;
+    if (!ok)
+        printf("capture has %d frames, expected %d\n", replay.GetFrameCount(), frames);
+    // One frame past the end checks the wrap back to the first frame
+    for (int frame = 0; ok && frame <= frames; frame++) {
+        ImDrawData *drawData = replay.NextFrame();
+        if (Snapshot(drawData) != recorded[frame % frames]) {
+            printf("frame %d differs after replay\n", frame);
+            ok = false;
+        }
+        graphics->RenderDrawData(drawData);
+        replay.FrameRendered();
+    }
+    if (replay.GetFrameCount() > 0) {
+        graphics->RenderDrawData(replay.ShutdownFrame());
+        replay.FrameRendered();
+    }
+    replay.Close();
+    graphics->Shutdown();
+    if (ok)
+        printf("ok\n");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 3 && strcmp(argv[1], "--check") == 0)
+        return Check(argv[2]);
+    if (argc < 2) {
+        printf("usage: %s <capture> [-b headless|software|opengl|vulkan] [-l loops]\n", argv[0]);
+        return 1;
+    }
+    const char *backend = "headless";
+    int loops = 1;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-b") == 0)
+            backend = argv[i + 1];
+        else if (strcmp(argv[i], "-l") == 0)
+            loops = std::max(atoi(argv[i + 1]), 1);
+    }
+
+    DrawDataReplay replay;
+    if (!replay.Open(argv[1]) || replay.GetFrameCount() == 0)
+        return 1;
+
+    GraphicsManager::GraphicsAPI api = GraphicsManager::HEADLESS;
+    if (strcmp(backend, "software") == 0)
+        api = GraphicsManager::SOFTWARE;
+    else if (strcmp(backend, "opengl") == 0)
+        api = GraphicsManager::OPENGL;
+    else if (strcmp(backend, "vulkan") == 0)
+        api = GraphicsManager::VULKAN;
+    auto graphics = GraphicsManager::getGraphicsInterface(api);
+    if (!graphics) {
+        printf("backend %s is not available in this build\n", backend);
+        return 1;
+    }
+
+    // The first frame decides the surface size
+    ImDrawData *first = replay.NextFrame();
+    int width = (int) (first->DisplaySize.x * first->FramebufferScale.x);
+    int height = (int) (first->DisplaySize.y * first->FramebufferScale.y);
+    ANativeWindow *window = nullptr;
+#ifdef __ANDROID__
+    if (api != GraphicsManager::HEADLESS)
+        window = android::ANativeWindowCreator::Create("replay", width, height);
+#endif
+    graphics->Init(window, (float) width, (float) height);
+
+    std::vector<double> times;
+    times.reserve((size_t) replay.GetFrameCount() * loops);
+    ImDrawData *drawData = first;
+    for (int frame = 0; frame < replay.GetFrameCount() * loops; frame++) {
+        if (frame > 0)
+            drawData = replay.NextFrame();
+        auto start = std::chrono::steady_clock::now();
+        graphics->RenderDrawData(drawData);
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        replay.FrameRendered();
+    }
+    graphics->RenderDrawData(replay.ShutdownFrame());
+    replay.FrameRendered();
+
+    double total = 0.0;
+    for (double t: times)
+        total += t;
+    std::sort(times.begin(), times.end());
+    printf("%s: %d frames, avg %.3f ms, p50 %.3f ms, p95 %.3f ms, max %.3f ms\n", backend, (int) times.size(),
+           total / (double) times.size(), times[times.size() / 2], times[times.size() * 95 / 100], times.back());
+
+    graphics->Shutdown();
+#ifdef __ANDROID__
+    if (window)
+        android::ANativeWindowCreator::Destroy(window);
+#endif
+    return 0;
+}
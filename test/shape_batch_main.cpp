@@ -0,0 +1,227 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "GraphicsManager.h"
+#include "ShapeBatch.h"
+#include "TextLayoutCache.h"
+
+// Builds the same markers through per-call ImDrawList functions and through ShapeBatch and compares CPU time.
+// With --check, verifies the batches instead (filled rects match the per-call ones, every index reaches a vertex
+// across the 16-bit chunks, every shape stays within its bounds) and exits with 1 on a mismatch.
+// usage: AndroidImguiShapeBench [-n shapes] [-l loops]
+//        AndroidImguiShapeBench --check
+static bool CheckIndices(const ImDrawList *drawList, const char *name) {
+    for (const ImDrawCmd &cmd: drawList->CmdBuffer) {
+        for (unsigned int i = cmd.IdxOffset; i < cmd.IdxOffset + cmd.ElemCount; i++) {
+            if (cmd.VtxOffset + drawList->IdxBuffer[(int) i] >= (unsigned int) drawList->VtxBuffer.Size) {
+                printf("%s: index %u points past the vertices\n", name, i);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The vertices of shape s lie in [min - margin, max + margin]; shapes take the same number of vertices each
+static bool CheckBounds(const ImDrawList *drawList, const char *name, int count,
+                        const std::function<void(int, ImVec2 &, ImVec2 &)> &bounds) {
+    if (drawList->VtxBuffer.Size % count != 0) {
+        printf("%s: %d vertices for %d shapes\n", name, drawList->VtxBuffer.Size, count);
+        return false;
+    }
+    const int perShape = drawList->VtxBuffer.Size / count;
+    const float margin = 1.0f + 1e-3f;
+    for (int s = 0; s < count; s++) {
+        ImVec2 min, max;
+        bounds(s, min, max);
+        for (int i = s * perShape; i < (s + 1) * perShape; i++) {
+            const ImVec2 &pos = drawList->VtxBuffer[i].pos;
+            if (pos.x < min.x - margin || pos.x > max.x + margin || pos.y < min.y - margin || pos.y > max.y + margin) {
+                printf("%s: shape %d has a vertex at %.2f,%.2f\n", name, s, pos.x, pos.y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool CheckBatches(ImDrawList *drawList, const ShapeSpans &shapes, const std::function<void()> &reset) {
+    bool ok = true;
+    const int count = shapes.Count;
+    std::function<void(int, ImVec2 &, ImVec2 &)> rectBounds = [&](int s, ImVec2 &min, ImVec2 &max) {
+        min = ImVec2(shapes.X[s], shapes.Y[s]);
+        max = ImVec2(shapes.X[s] + shapes.Width[s], shapes.Y[s] + shapes.Height[s]);
+    };
+    std::function<void(int, ImVec2 &, ImVec2 &)> circleBounds = [&](int s, ImVec2 &min, ImVec2 &max) {
+        min = ImVec2(shapes.X[s] - shapes.Width[s], shapes.Y[s] - shapes.Width[s]);
+        max = ImVec2(shapes.X[s] + shapes.Width[s], shapes.Y[s] + shapes.Width[s]);
+    };
+
+    // Few enough that neither side splits the list at a 16-bit boundary
+    ShapeSpans few = shapes;
+    few.Count = std::min(count, 10000);
+    reset();
+    for (int i = 0; i < few.Count; i++) {
+        drawList->AddRectFilled(ImVec2(shapes.X[i], shapes.Y[i]),
+                                ImVec2(shapes.X[i] + shapes.Width[i], shapes.Y[i] + shapes.Height[i]), shapes.Col[i]);
+    }
+    ImVector<ImDrawVert> vertices = drawList->VtxBuffer;
+    ImVector<ImDrawIdx> indices = drawList->IdxBuffer;
+    reset();
+    ShapeBatch::AddRectsFilled(drawList, few);
+    bool same = vertices.Size == drawList->VtxBuffer.Size && indices.Size == drawList->IdxBuffer.Size;
+    for (int i = 0; same && i < vertices.Size; i++) {
+        const ImDrawVert &a = vertices[i], &b = drawList->VtxBuffer[i];
+        same = std::fabs(a.pos.x - b.pos.x) < 1e-3f && std::fabs(a.pos.y - b.pos.y) < 1e-3f && a.col == b.col;
+    }
+    for (int i = 0; same && i < indices.Size; i++)
+        same = indices[i] == drawList->IdxBuffer[i];
+    if (!same) {
+        printf("rect filled batch differs from the per-call rects\n");
+        ok = false;
+    }
+
+    struct Case {
+        const char *Name;
+        bool Rect;
+        std::function<void()> Build;
+    } cases[] = {
+            {"rect filled batch", true, [&] { ShapeBatch::AddRectsFilled(drawList, shapes); }},
+            {"rect batch", true, [&] { ShapeBatch::AddRects(drawList, shapes); }},
+            {"circle filled batch", false, [&] { ShapeBatch::AddCirclesFilled(drawList, shapes); }},
+            {"circle batch", false, [&] { ShapeBatch::AddCircles(drawList, shapes); }},
+    };
+    for (bool antiAliased: {false, true}) {
+        for (const Case &c: cases) {
+            std::string name = std::string(c.Name) + (antiAliased ? " (anti-aliased)" : "");
+            reset();
+            if (antiAliased)
+                drawList->Flags |= ImDrawListFlags_AntiAliasedLines | ImDrawListFlags_AntiAliasedFill;
+            c.Build();
+            ok &= CheckIndices(drawList, name.c_str());
+            ok &= CheckBounds(drawList, name.c_str(), count, c.Rect ? rectBounds : circleBounds);
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    int count = 20000;
+    int loops = 100;
+    bool check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0)
+            count = std::max(atoi(argv[i + 1]), 1);
+        else if (strcmp(argv[i], "-l") == 0)
+            loops = std::max(atoi(argv[i + 1]), 1);
+    }
+
+    auto graphics = GraphicsManager::getGraphicsInterface(GraphicsManager::HEADLESS);
+    graphics->Init(nullptr, 1920.0f, 1080.0f);
+    graphics->NewFrame();
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> x(0.0f, 1900.0f), y(0.0f, 1060.0f), size(4.0f, 16.0f);
+    std::vector<float> xs(count), ys(count), widths(count), heights(count);
+    std::vector<ImU32> cols(count);
+    std::vector<std::string> names(count);
+    std::vector<const char *> labels(count);
+    for (int i = 0; i < count; i++) {
+        xs[i] = x(random);
+        ys[i] = y(random);
+        widths[i] = size(random);
+        heights[i] = size(random);
+        cols[i] = IM_COL32(random() & 0xFF, random() & 0xFF, random() & 0xFF, 255);
+        // Names from a small set, like unit labels
+        names[i] = "unit " + std::to_string(i % 64);
+        labels[i] = names[i].c_str();
+    }
+
+    ShapeSpans shapes;
+    shapes.Count = count;
+    shapes.X = xs.data();
+    shapes.Y = ys.data();
+    shapes.Width = widths.data();
+    shapes.Height = heights.data();
+    shapes.Col = cols.data();
+
+    ImDrawList *drawList = IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData());
+    auto reset = [&] {
+        // Buffers keep their capacity from the previous loop, as from frame to frame
+        drawList->_ResetForNewFrame();
+        drawList->Flags = ImDrawListFlags_AllowVtxOffset;
+        drawList->PushClipRectFullScreen();
+        drawList->PushTexture(ImGui::GetIO().Fonts->TexRef);
+    };
+    if (check) {
+        bool ok = CheckBatches(drawList, shapes, reset);
+        IM_DELETE(drawList);
+        graphics->EndFrame();
+        graphics->Shutdown();
+        if (ok)
+            printf("ok\n");
+        return ok ? 0 : 1;
+    }
+
+    auto run = [&](const char *name, const std::function<void()> &build) {
+        double total = 0.0;
+        for (int loop = 0; loop < loops; loop++) {
+            reset();
+            auto start = std::chrono::steady_clock::now();
+            build();
+            total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            drawList->PopTexture();
+            drawList->PopClipRect();
+        }
+        printf("%-22s %8.3f ms  %8d vertices %8d indices\n", name, total / loops, drawList->VtxBuffer.Size,
+               drawList->IdxBuffer.Size);
+    };
+
+    printf("%d shapes, %d loops\n", count, loops);
+    run("rect filled per call", [&] {
+        for (int i = 0; i < count; i++)
+            drawList->AddRectFilled(ImVec2(xs[i], ys[i]), ImVec2(xs[i] + widths[i], ys[i] + heights[i]), cols[i]);
+    });
+    run("rect filled batch", [&] { ShapeBatch::AddRectsFilled(drawList, shapes); });
+    run("rect per call", [&] {
+        for (int i = 0; i < count; i++)
+            drawList->AddRect(ImVec2(xs[i], ys[i]), ImVec2(xs[i] + widths[i], ys[i] + heights[i]), cols[i]);
+    });
+    run("rect batch", [&] { ShapeBatch::AddRects(drawList, shapes); });
+    run("circle filled per call", [&] {
+        for (int i = 0; i < count; i++)
+            drawList->AddCircleFilled(ImVec2(xs[i], ys[i]), widths[i], cols[i]);
+    });
+    run("circle filled batch", [&] { ShapeBatch::AddCirclesFilled(drawList, shapes); });
+    run("circle per call", [&] {
+        for (int i = 0; i < count; i++)
+            drawList->AddCircle(ImVec2(xs[i], ys[i]), widths[i], cols[i]);
+    });
+    run("circle batch", [&] { ShapeBatch::AddCircles(drawList, shapes); });
+
+    run("labeled per call", [&] {
+        for (int i = 0; i < count; i++) {
+            drawList->AddCircleFilled(ImVec2(xs[i], ys[i]), widths[i], cols[i]);
+            drawList->AddText(ImVec2(xs[i] + 10.0f, ys[i] - 8.0f), IM_COL32_WHITE, labels[i]);
+        }
+    });
+    shapes.Labels = labels.data();
+    shapes.LabelOffset = ImVec2(10.0f, -8.0f);
+    shapes.LabelCache = &graphics->GetTextCache();
+    run("labeled batch", [&] { ShapeBatch::AddCirclesFilled(drawList, shapes); });
+    const TextCacheStats &stats = graphics->GetTextCache().GetStats();
+    printf("label cache: %.1f%% hits, %zu bytes\n", stats.HitRate() * 100.0f, stats.Bytes);
+
+    IM_DELETE(drawList);
+    graphics->EndFrame();
+    graphics->Shutdown();
+    return 0;
+}
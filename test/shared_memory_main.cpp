@@ -0,0 +1,181 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <unistd.h>
+
+#ifdef __ANDROID__
+#include "ANativeWindowCreator.h"
+#endif
+#include "GraphicsManager.h"
+#include "SharedFrameRing.h"
+#include "SharedMemoryGraphics.h"
+#include "my_imgui_impl_host.h"
+
+// Cross-process rendering between two local processes: one builds the demo window into a shared ring, the other
+// renders whatever arrives and reports how many frames it had to skip.
+// check fills a small ring until it refuses a record and drains it, over and over, so records wrap around the end;
+// exits with 1 when a record comes out changed, out of order or was written over unread ones.
+// usage: AndroidImguiShared produce <ring> [-n frames] [-s WxH]
+//        AndroidImguiShared consume <ring> [-b headless|software|opengl|vulkan]
+//        AndroidImguiShared check <ring>
+static int Produce(const char *path, int frames, int width, int height) {
+    SharedMemoryGraphics graphics(path);
+    if (!graphics.Init(nullptr, (float) width, (float) height))
+        return 1;
+    My_ImGui_ImplHost_SetFixedDeltaTime(1.0f / 60.0f);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        graphics.NewFrame();
+        ImGui::ShowDemoWindow();
+        graphics.EndFrame();
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("produced %d frames in %.1f ms, %llu dropped\n", frames, ms,
+           (unsigned long long) graphics.GetDroppedFrames());
+    graphics.Shutdown();
+    return 0;
+}
+
+static int Consume(const char *path, const char *backend) {
+    SharedFrameConsumer consumer;
+    if (!consumer.Open(path))
+        return 1;
+
+    GraphicsManager::GraphicsAPI api = GraphicsManager::HEADLESS;
+    if (strcmp(backend, "software") == 0)
+        api = GraphicsManager::SOFTWARE;
+    else if (strcmp(backend, "opengl") == 0)
+        api = GraphicsManager::OPENGL;
+    else if (strcmp(backend, "vulkan") == 0)
+        api = GraphicsManager::VULKAN;
+    auto graphics = GraphicsManager::getGraphicsInterface(api);
+    if (!graphics) {
+        printf("backend %s is not available in this build\n", backend);
+        return 1;
+    }
+
+    ImDrawData *drawData = consumer.Acquire(5000);
+    if (!drawData) {
+        printf("no frame from the producer\n");
+        return 1;
+    }
+    // The first frame decides the surface size
+    int width = (int) (drawData->DisplaySize.x * drawData->FramebufferScale.x);
+    int height = (int) (drawData->DisplaySize.y * drawData->FramebufferScale.y);
+    ANativeWindow *window = nullptr;
+#ifdef __ANDROID__
+    if (api != GraphicsManager::HEADLESS)
+        window = android::ANativeWindowCreator::Create("shared", width, height);
+#endif
+    graphics->Init(window, (float) width, (float) height);
+
+    int rendered = 0;
+    while (drawData) {
+        graphics->RenderDrawData(drawData);
+        consumer.Release();
+        rendered++;
+        drawData = consumer.Acquire(1000);
+    }
+    graphics->RenderDrawData(consumer.ShutdownFrame());
+    consumer.Release();
+    printf("rendered %d frames, skipped %llu, producer dropped %llu\n", rendered,
+           (unsigned long long) consumer.GetSkippedFrames(), (unsigned long long) consumer.GetDroppedFrames());
+
+    consumer.Close();
+    graphics->Shutdown();
+#ifdef __ANDROID__
+    if (window)
+        android::ANativeWindowCreator::Destroy(window);
+#endif
+    return 0;
+}
+
+static uint8_t Pattern(uint32_t record, size_t offset) {
+    return (uint8_t) (record * 31 + offset);
+}
+
+static int Check(const char *path) {
+    const size_t capacity = 4096;
+    SharedFrameRing producer, consumer;
+    if (!producer.Create(path, capacity) || !consumer.Open(path))
+        return 1;
+    uint64_t position = consumer.GetReadPosition();
+    bool ok = producer.Reserve(capacity, 0) == nullptr;
+    if (!ok)
+        printf("a record as large as the ring was accepted\n");
+
+    uint32_t written = 0, read = 0;
+    for (int round = 0; ok && round < 200; round++) {
+        std::vector<size_t> sizes;
+        for (;;) {
+            size_t size = 1 + (written * 193) % 1200;
+            uint8_t *out = producer.Reserve(size, 0);
+            if (!out)
+                break;
+            for (size_t i = 0; i < size; i++)
+                out[i] = Pattern(written, i);
+            producer.Commit();
+            sizes.push_back(size);
+            written++;
+        }
+        if (sizes.empty()) {
+            printf("round %d: a drained ring refused a record\n", round);
+            ok = false;
+        }
+        for (size_t expected: sizes) {
+            size_t size = 0;
+            const uint8_t *in = consumer.Next(position, size);
+            bool same = in && size >= expected;
+            for (size_t i = 0; same && i < expected; i++)
+                same = in[i] == Pattern(read, i);
+            if (!same) {
+                printf("round %d: record %u came out wrong\n", round, read);
+                ok = false;
+                break;
+            }
+            read++;
+        }
+        size_t size = 0;
+        if (ok && consumer.Next(position, size)) {
+            printf("round %d: more records than were written\n", round);
+            ok = false;
+        }
+        consumer.Release(position);
+    }
+    consumer.Close();
+    producer.Close();
+    unlink(path);
+    if (ok)
+        printf("ok, %u records through a %zu byte ring\n", read, capacity);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        printf("usage: %s produce <ring> [-n frames] [-s WxH]\n"
+               "       %s consume <ring> [-b headless|software|opengl|vulkan]\n"
+               "       %s check <ring>\n", argv[0], argv[0], argv[0]);
+        return 1;
+    }
+    int frames = 600;
+    int width = 1920;
+    int height = 1080;
+    const char *backend = "headless";
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0)
+            frames = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-s") == 0)
+            sscanf(argv[i + 1], "%dx%d", &width, &height);
+        else if (strcmp(argv[i], "-b") == 0)
+            backend = argv[i + 1];
+    }
+    if (strcmp(argv[1], "produce") == 0)
+        return Produce(argv[2], frames, width, height);
+    if (strcmp(argv[1], "check") == 0)
+        return Check(argv[2]);
+    return Consume(argv[2], backend);
+}
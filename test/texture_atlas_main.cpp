@@ -0,0 +1,212 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+#include "GraphicsManager.h"
+#include "imgui.h"
+#include "SoftwareGraphics.h"
+#include "TextureAtlas.h"
+
+// Draws a grid of small icons with and without the texture atlas and compares draw calls, texture objects and
+// frame time. With --check, packs patterned icons headless, removes most of them, lets Compact repack and adds them
+// back, checking after each step that every handle's UV rect shows its icon's pixels with extruded borders; exits
+// with 1 on a mismatch.
+// usage: AndroidImguiAtlasBench [-n icons] [-f frames]
+//        AndroidImguiAtlasBench --check
+static void IconPixel(int icon, int x, int y, unsigned char *rgb) {
+    // Unique per icon and texel for up to 512 icons of up to 64x64, so overlaps and offsets show
+    rgb[0] = (unsigned char) icon;
+    rgb[1] = (unsigned char) (x * 4);
+    rgb[2] = (unsigned char) ((icon >> 8) << 7 | (y * 2 & 0x7F));
+}
+
+static std::vector<std::string> MakeIcons(int count, bool patterned = false) {
+    // Binary PPM, which stb_image reads like any other format
+    std::mt19937 random(1234);
+    std::vector<std::string> icons(count);
+    for (int index = 0; index < count; index++) {
+        std::string &icon = icons[index];
+        int width = 16 + (int) (random() % 49);
+        int height = 16 + (int) (random() % 49);
+        char header[32];
+        snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+        icon = header;
+        unsigned char rgb[3] = {(unsigned char) random(), (unsigned char) random(), (unsigned char) random()};
+        for (int i = 0; i < width * height; i++) {
+            if (patterned)
+                IconPixel(index, i % width, i / width, rgb);
+            icon.append((const char *) rgb, 3);
+        }
+    }
+    return icons;
+}
+
+static bool CheckPixels(const std::vector<BaseTexData *> &textures, const char *step) {
+    for (int index = 0; index < (int) textures.size(); index++) {
+        const BaseTexData *texture = textures[index];
+        if (!texture)
+            continue;
+        auto *page = (const SoftwareGraphics::SoftwareTextureData *) texture->DS;
+        auto *pixels = (const unsigned char *) page->Pixels.data();
+        int x0 = (int) std::lround(texture->U0 * (float) page->Width);
+        int y0 = (int) std::lround(texture->V0 * (float) page->Height);
+        if ((int) std::lround(texture->U1 * (float) page->Width) - x0 != texture->Width ||
+            (int) std::lround(texture->V1 * (float) page->Height) - y0 != texture->Height) {
+            printf("%s: icon %d has a %.4f,%.4f-%.4f,%.4f UV rect for %dx%d\n", step, index, texture->U0, texture->V0,
+                   texture->U1, texture->V1, texture->Width, texture->Height);
+            return false;
+        }
+        // One texel further on each side for the border
+        for (int y = -1; y <= texture->Height; y++) {
+            for (int x = -1; x <= texture->Width; x++) {
+                unsigned char expected[3];
+                IconPixel(index, std::clamp(x, 0, texture->Width - 1), std::clamp(y, 0, texture->Height - 1), expected);
+                const unsigned char *actual = pixels + ((size_t) (y0 + y) * page->Width + x0 + x) * 4;
+                if (memcmp(actual, expected, 3) != 0) {
+                    printf("%s: icon %d texel %d,%d doesn't match the source\n", step, index, x, y);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static int Check() {
+    const int count = 200;
+    std::vector<std::string> icons = MakeIcons(count, true);
+    auto graphics = GraphicsManager::getGraphicsInterface(GraphicsManager::HEADLESS);
+    graphics->Init(nullptr, 640.0f, 480.0f);
+    // Small pages, so the icons take several of them and pages grow on the way
+    graphics->SetTextureAtlas(true, 64, 512);
+
+    std::vector<BaseTexData *> textures;
+    for (std::string &icon: icons)
+        textures.push_back(graphics->LoadTextureFromMemory(icon.data(), (int) icon.size()));
+    graphics->NewFrame();
+    graphics->EndFrame();
+    TextureAtlasStats stats = graphics->GetTextureAtlasStats();
+    bool ok = stats.Images == count && stats.Pages > 1;
+    if (!ok)
+        printf("added: %d images on %d pages\n", stats.Images, stats.Pages);
+    ok = ok && CheckPixels(textures, "added");
+
+    std::vector<std::pair<float, float>> before(count);
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (i % 3 == 0) {
+            before[i] = {textures[i]->U0, textures[i]->V0};
+            kept++;
+        } else {
+            graphics->DeleteTexture(textures[i]);
+            textures[i] = nullptr;
+        }
+    }
+    // Compact runs in NewFrame, the repacked pages upload in the same NewFrame
+    graphics->NewFrame();
+    graphics->EndFrame();
+    stats = graphics->GetTextureAtlasStats();
+    bool moved = false;
+    for (int i = 0; i < count; i += 3)
+        moved |= textures[i]->U0 != before[i].first || textures[i]->V0 != before[i].second;
+    if (ok && (stats.Images != kept || !moved)) {
+        printf("removed: %d images, expected %d%s\n", stats.Images, kept, moved ? "" : ", nothing was repacked");
+        ok = false;
+    }
+    ok = ok && CheckPixels(textures, "repacked");
+
+    for (int i = 0; i < count; i++) {
+        if (!textures[i])
+            textures[i] = graphics->LoadTextureFromMemory(icons[i].data(), (int) icons[i].size());
+    }
+    graphics->NewFrame();
+    graphics->EndFrame();
+    if (ok && graphics->GetTextureAtlasStats().Images != count) {
+        printf("added again: %d images\n", graphics->GetTextureAtlasStats().Images);
+        ok = false;
+    }
+    ok = ok && CheckPixels(textures, "added again");
+
+    for (BaseTexData *texture: textures) {
+        if (texture)
+            graphics->DeleteTexture(texture);
+    }
+    graphics->Shutdown();
+    if (ok)
+        printf("ok\n");
+    return ok ? 0 : 1;
+}
+
+static void Run(bool atlas, std::vector<std::string> &icons, int frames) {
+    auto graphics = GraphicsManager::getGraphicsInterface(GraphicsManager::HEADLESS);
+    graphics->Init(nullptr, 1920.0f, 1080.0f);
+    graphics->SetTextureAtlas(atlas);
+
+    std::vector<BaseTexData *> textures;
+    auto start = std::chrono::steady_clock::now();
+    for (std::string &icon: icons)
+        textures.push_back(graphics->LoadTextureFromMemory(icon.data(), (int) icon.size()));
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    double total = 0.0;
+    for (int frame = 0; frame < frames; frame++) {
+        auto frameStart = std::chrono::steady_clock::now();
+        graphics->NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+        ImGui::SetNextWindowSize(ImVec2(1920.0f, 1080.0f));
+        ImGui::Begin("icons");
+        for (size_t i = 0; i < textures.size(); i++) {
+            BaseTexData *texture = textures[i];
+            if (!texture)
+                continue;
+            if (i % 24)
+                ImGui::SameLine();
+            ImGui::Image((ImTextureID) (intptr_t) texture->DS, {(float) texture->Width, (float) texture->Height},
+                         {texture->U0, texture->V0}, {texture->U1, texture->V1});
+        }
+        ImGui::End();
+        graphics->EndFrame();
+        total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    }
+
+    const DrawCallStats &calls = graphics->GetDrawCallStats();
+    TextureAtlasStats stats = graphics->GetTextureAtlasStats();
+    MemoryReport memory = graphics->GetMemoryReport(0);
+    int objects = (int) icons.size() - stats.Images + stats.Pages;
+    printf("atlas %-3s: %4d draw calls, %4d texture objects (%d pages, %.0f%% used), load %.3f ms, "
+           "frame %.3f ms, texture memory %zu KiB\n", atlas ? "on" : "off", calls.Before, objects, stats.Pages,
+           stats.Occupancy * 100.0f, loadMs, total / std::max(frames, 1),
+           (memory.Bytes[MemoryReport::TEXTURE_CPU] + memory.Bytes[MemoryReport::TEXTURE_GPU]) / 1024);
+
+    for (BaseTexData *texture: textures) {
+        if (texture)
+            graphics->DeleteTexture(texture);
+    }
+    graphics->Shutdown();
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--check") == 0)
+        return Check();
+    int count = 300;
+    int frames = 100;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0)
+            count = std::max(atoi(argv[i + 1]), 1);
+        else if (strcmp(argv[i], "-f") == 0)
+            frames = std::max(atoi(argv[i + 1]), 1);
+    }
+
+    std::vector<std::string> icons = MakeIcons(count);
+    printf("%d icons, %d frames\n", count, frames);
+    Run(false, icons, frames);
+    Run(true, icons, frames);
+    return 0;
+}
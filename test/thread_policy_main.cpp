@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "GraphicsManager.h"
+#include "ParallelDrawLists.h"
+#include "ThreadPolicy.h"
+
+struct PolicyCase {
+    const char *Name;
+    ThreadPolicy Render;
+    ThreadPolicy Workers;
+};
+
+// Renders headless frames under a few render/worker thread policies, optionally next to busy threads, and prints
+// the frame-time spread of each. Affinity is read back with sched_getaffinity.
+// With --check, pins the render thread and the workers to different CPUs, verifies where frames and draw list
+// builders actually ran and the frame count, and exits with 1 on a mismatch.
+// usage: AndroidImguiThreadPolicy [-n frames] [-l load threads]
+//        AndroidImguiThreadPolicy --check
+static int Check() {
+    const uint64_t all = ThreadTuning::GetAffinity(0);
+    if (!all) {
+        printf("can't read the affinity\n");
+        return 1;
+    }
+    const uint64_t renderMask = all & (~all + 1);
+    const uint64_t workerMask = 1ull << (63 - __builtin_clzll(all));
+    bool ok = true;
+
+    // On a thread of its own, so nothing it changes outlives the check
+    std::thread([&] {
+        ThreadPolicy pin;
+        pin.CpuMask = renderMask;
+        if (!ThreadTuning::Apply(0, pin) || ThreadTuning::GetAffinity(0) != renderMask) {
+            printf("Apply didn't pin the thread to %llx\n", (unsigned long long) renderMask);
+            ok = false;
+        }
+        ThreadPolicy fifo;
+        fifo.Fifo = true;
+        if (ThreadTuning::Apply(0, fifo) != ThreadTuning::IsFifo(0)) {
+            printf("Apply reported SCHED_FIFO wrong\n");
+            ok = false;
+        }
+    }).join();
+
+    auto graphics = GraphicsManager::getGraphicsInterface(GraphicsManager::HEADLESS);
+    graphics->Init(nullptr, 640.0f, 480.0f);
+    ThreadPolicy render, workers;
+    render.CpuMask = renderMask;
+    workers.CpuMask = workerMask;
+    graphics->SetRenderThreadPolicy(render);
+    graphics->SetWorkerThreadPolicy(workers);
+
+    const int frames = 10;
+    const int renderTid = ThreadTuning::CurrentThreadId();
+    std::atomic<int> misplaced{0};
+    for (int frame = 0; frame < frames; frame++) {
+        graphics->NewFrame();
+        if (frame == 0)
+            graphics->ResetFrameTimeStats();
+        graphics->GetParallelDrawLists().Build(8, [&](int index, ImDrawList *drawList) {
+            uint64_t expected = ThreadTuning::CurrentThreadId() == renderTid ? renderMask : workerMask;
+            if (ThreadTuning::GetAffinity(0) != expected)
+                misplaced++;
+            drawList->AddRectFilled(ImVec2(0.0f, 0.0f), ImVec2(8.0f, 8.0f), IM_COL32(index * 30, 0, 0, 255));
+        });
+        graphics->EndFrame();
+    }
+    if (ThreadTuning::GetAffinity(0) != renderMask) {
+        printf("render thread runs on %llx, expected %llx\n", (unsigned long long) ThreadTuning::GetAffinity(0),
+               (unsigned long long) renderMask);
+        ok = false;
+    }
+    if (misplaced) {
+        printf("%d draw list builders ran off their CPUs\n", misplaced.load());
+        ok = false;
+    }
+    FrameTimeStats stats = graphics->GetFrameTimeStats();
+    if (stats.Frames != frames - 1 || stats.MaxMs < stats.MeanMs) {
+        printf("frame stats: %d intervals, mean %.3f ms, max %.3f ms\n", stats.Frames, stats.MeanMs, stats.MaxMs);
+        ok = false;
+    }
+
+    render.CpuMask = all;
+    workers.CpuMask = all;
+    graphics->SetRenderThreadPolicy(render);
+    graphics->SetWorkerThreadPolicy(workers);
+    graphics->NewFrame();
+    graphics->EndFrame();
+    graphics->Shutdown();
+    if (ok)
+        printf("ok\n");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--check") == 0)
+        return Check();
+    int frames = 600;
+    int loadThreads = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0)
+            frames = std::max(atoi(argv[i + 1]), 2);
+        else if (strcmp(argv[i], "-l") == 0)
+            loadThreads = std::max(atoi(argv[i + 1]), 0);
+    }
+
+    const uint64_t big = ThreadTuning::BigCores();
+    const uint64_t little = ThreadTuning::LittleCores();
+    printf("big cores %llx, little cores %llx\n", (unsigned long long) big, (unsigned long long) little);
+
+    std::vector<PolicyCase> cases(4);
+    cases[0].Name = "default";
+    cases[1].Name = "little cores";
+    cases[1].Render.CpuMask = little;
+    cases[1].Workers.CpuMask = little;
+    cases[2].Name = "big cores, nice -10";
+    cases[2].Render.CpuMask = big;
+    cases[2].Render.Nice = -10;
+    cases[2].Workers.CpuMask = big;
+    cases[2].Workers.Nice = -5;
+    cases[3].Name = "big cores, SCHED_FIFO";
+    cases[3].Render.CpuMask = big;
+    cases[3].Render.Fifo = true;
+    cases[3].Render.Nice = -10;
+    cases[3].Workers.CpuMask = big;
+    cases[3].Workers.Nice = -5;
+
+    std::atomic<bool> loading{true};
+    std::vector<std::thread> load;
+    for (int i = 0; i < loadThreads; i++) {
+        load.emplace_back([&loading] {
+            volatile unsigned value = 0;
+            while (loading.load(std::memory_order_relaxed))
+                value = value * 1664525u + 1013904223u;
+        });
+    }
+
+    auto graphics = GraphicsManager::getGraphicsInterface(GraphicsManager::HEADLESS);
+    graphics->Init(nullptr, 1920.0f, 1080.0f);
+
+    for (const PolicyCase &policyCase: cases) {
+        graphics->SetRenderThreadPolicy(policyCase.Render);
+        graphics->SetWorkerThreadPolicy(policyCase.Workers);
+        for (int frame = 0; frame < frames; frame++) {
+            graphics->NewFrame();
+            // The policy took effect in the first NewFrame, measure from there
+            if (frame == 0)
+                graphics->ResetFrameTimeStats();
+            ImGui::ShowDemoWindow();
+            graphics->GetParallelDrawLists().Build(8, [](int index, ImDrawList *drawList) {
+                for (int i = 0; i < 2000; i++) {
+                    float x = (float) ((i * 37 + index * 101) % 1900);
+                    float y = (float) ((i * 53 + index * 67) % 1060);
+                    drawList->AddRectFilled(ImVec2(x, y), ImVec2(x + 8.0f, y + 8.0f), IM_COL32(index * 30, i & 0xFF, 128, 255));
+                }
+            });
+            graphics->EndFrame();
+        }
+        FrameTimeStats stats = graphics->GetFrameTimeStats();
+        uint64_t affinity = ThreadTuning::GetAffinity(0);
+        bool pinned = !policyCase.Render.CpuMask || affinity == policyCase.Render.CpuMask;
+        printf("%-24s mean %7.3f ms  stddev %7.3f ms  max %7.3f ms  affinity %llx%s%s\n", policyCase.Name,
+               stats.MeanMs, stats.StdDevMs, stats.MaxMs, (unsigned long long) affinity, pinned ? "" : " (not applied)",
+               ThreadTuning::IsFifo(0) ? "  fifo" : "");
+    }
+
+    // Back to normal before tearing down, a FIFO thread would starve the busy ones
+    graphics->SetRenderThreadPolicy(ThreadPolicy());
+    graphics->NewFrame();
+    graphics->EndFrame();
+    graphics->Shutdown();
+    loading = false;
+    for (std::thread &thread: load)
+        thread.join();
+    return 0;
+}